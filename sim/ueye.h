@@ -0,0 +1,352 @@
+/*
+ * Subset of the IDS uEye SDK interface, implemented by the simulated camera
+ * backend (ueye_sim.cpp). Only the types, constants and functions used by
+ * the ueye library are declared here; this header replaces the SDK ueye.h
+ * when building with UEYE_SIMULATION and must not be mixed with it.
+ */
+#ifndef UEYE_SIM_H
+#define UEYE_SIM_H
+
+#include <stdint.h>
+
+typedef int32_t INT;
+typedef uint32_t UINT;
+typedef uint32_t DWORD;
+typedef uint32_t ULONG;
+typedef uint16_t WORD;
+typedef uint8_t BYTE;
+typedef int32_t BOOL;
+typedef uint64_t UINT64;
+typedef char IS_CHAR;
+typedef DWORD HIDS;
+
+/* return values */
+#define IS_NO_SUCCESS                       -1
+#define IS_SUCCESS                          0
+#define IS_INVALID_CAMERA_HANDLE            1
+#define IS_IO_REQUEST_FAILED                2
+#define IS_CANT_OPEN_DEVICE                 3
+#define IS_INVALID_MEMORY_POINTER           49
+#define IS_NO_ACTIVE_IMG_MEM                112
+#define IS_TIMED_OUT                        122
+#define IS_INVALID_PARAMETER                125
+#define IS_CAPTURE_RUNNING                  140
+#define IS_NOT_SUPPORTED                    155
+#define IS_CAPTURE_STATUS                   177
+
+/* generic parameters */
+#define IS_IGNORE_PARAMETER                 -1
+#define IS_DONT_WAIT                        0x0000
+#define IS_WAIT                             0x0001
+#define IS_USE_DEVICE_ID                    0x8000L
+#define IS_ENABLE_ERR_REP                   1
+#define IS_DISABLE_ERR_REP                  0
+#define IS_GET_FRAMERATE                    0x8000
+#define IS_GET_COLOR_MODE                   0x8000
+
+/* sensor color mode (SENSORINFO::nColorMode) */
+#define IS_COLORMODE_INVALID                0
+#define IS_COLORMODE_MONOCHROME             1
+#define IS_COLORMODE_BAYER                  2
+#define IS_COLORMODE_CBYCRY                 4
+#define IS_COLORMODE_JPEG                   8
+
+/* upper left bayer pixel (SENSORINFO::nUpperLeftBayerPixel) */
+#define BAYER_PIXEL_RED                     0
+#define BAYER_PIXEL_GREEN                   1
+#define BAYER_PIXEL_BLUE                    2
+
+/* image color modes */
+#define IS_CM_ORDER_BGR                     0x0000
+#define IS_CM_ORDER_RGB                     0x0080
+#define IS_CM_ORDER_MASK                    0x0080
+#define IS_CM_FORMAT_PLANAR                 0x2000
+#define IS_CM_FORMAT_MASK                   0x2000
+#define IS_CM_PREFER_PACKED_SOURCE_FORMAT   0x4000
+#define IS_CM_MODE_MASK                     0x007F
+
+#define IS_CM_SENSOR_RAW8                   11
+#define IS_CM_SENSOR_RAW10                  33
+#define IS_CM_SENSOR_RAW12                  27
+#define IS_CM_SENSOR_RAW16                  29
+#define IS_CM_MONO8                         6
+#define IS_CM_MONO10                        34
+#define IS_CM_MONO12                        26
+#define IS_CM_MONO16                        28
+#define IS_CM_BGR5_PACKED                   (3  | IS_CM_ORDER_BGR)
+#define IS_CM_BGR565_PACKED                 (2  | IS_CM_ORDER_BGR)
+#define IS_CM_RGB8_PACKED                   (1  | IS_CM_ORDER_RGB)
+#define IS_CM_BGR8_PACKED                   (1  | IS_CM_ORDER_BGR)
+#define IS_CM_RGBA8_PACKED                  (0  | IS_CM_ORDER_RGB)
+#define IS_CM_BGRA8_PACKED                  (0  | IS_CM_ORDER_BGR)
+#define IS_CM_RGBY8_PACKED                  (24 | IS_CM_ORDER_RGB)
+#define IS_CM_BGRY8_PACKED                  (24 | IS_CM_ORDER_BGR)
+#define IS_CM_RGB10_PACKED                  (25 | IS_CM_ORDER_RGB)
+#define IS_CM_BGR10_PACKED                  (25 | IS_CM_ORDER_BGR)
+#define IS_CM_RGB10_UNPACKED                (35 | IS_CM_ORDER_RGB)
+#define IS_CM_BGR10_UNPACKED                (35 | IS_CM_ORDER_BGR)
+#define IS_CM_RGB12_UNPACKED                (30 | IS_CM_ORDER_RGB)
+#define IS_CM_BGR12_UNPACKED                (30 | IS_CM_ORDER_BGR)
+#define IS_CM_RGBA12_UNPACKED               (31 | IS_CM_ORDER_RGB)
+#define IS_CM_BGRA12_UNPACKED               (31 | IS_CM_ORDER_BGR)
+#define IS_CM_JPEG                          32
+#define IS_CM_UYVY_PACKED                   12
+#define IS_CM_UYVY_MONO_PACKED              13
+#define IS_CM_UYVY_BAYER_PACKED             14
+#define IS_CM_CBYCRY_PACKED                 23
+#define IS_CM_RGB8_PLANAR                   (1 | IS_CM_ORDER_RGB | IS_CM_FORMAT_PLANAR)
+
+/* is_EnableEvent */
+#define IS_SET_EVENT_ODD                    0
+#define IS_SET_EVENT_EVEN                   1
+#define IS_SET_EVENT_FRAME                  2
+#define IS_SET_EVENT_EXTTRIG                3
+#define IS_SET_EVENT_VSYNC                  4
+#define IS_SET_EVENT_SEQ                    5
+#define IS_SET_EVENT_STEAL                  6
+#define IS_SET_EVENT_VPRES                  7
+#define IS_SET_EVENT_CAPTURE_STATUS         8
+
+/* is_SetExternalTrigger */
+#define IS_GET_EXTERNALTRIGGER              0x8000
+#define IS_SET_TRIGGER_OFF                  0x0000
+#define IS_SET_TRIGGER_CONTINUOUS           0x1000
+#define IS_SET_TRIGGER_HI_LO                (IS_SET_TRIGGER_CONTINUOUS | 0x0001)
+#define IS_SET_TRIGGER_LO_HI                (IS_SET_TRIGGER_CONTINUOUS | 0x0002)
+#define IS_SET_TRIGGER_SOFTWARE             (IS_SET_TRIGGER_CONTINUOUS | 0x0008)
+
+/* is_SetTriggerDelay, in us */
+#define IS_GET_TRIGGER_DELAY                0x8000
+#define IS_GET_MIN_TRIGGER_DELAY            0x8001
+#define IS_GET_MAX_TRIGGER_DELAY            0x8002
+#define IS_GET_TRIGGER_DELAY_GRANULARITY    0x8003
+
+/* is_Trigger */
+#define IS_TRIGGER_CMD_GET_BURST_SIZE_SUPPORTED 1
+#define IS_TRIGGER_CMD_GET_BURST_SIZE_RANGE 2
+#define IS_TRIGGER_CMD_GET_BURST_SIZE       3
+#define IS_TRIGGER_CMD_SET_BURST_SIZE       4
+
+/* is_AOI */
+#define IS_AOI_IMAGE_SET_AOI                0x0001
+#define IS_AOI_IMAGE_GET_AOI                0x0002
+#define IS_AOI_IMAGE_SET_POS                0x0003
+#define IS_AOI_IMAGE_GET_POS                0x0004
+#define IS_AOI_IMAGE_SET_SIZE               0x0005
+#define IS_AOI_IMAGE_GET_SIZE               0x0006
+#define IS_AOI_IMAGE_GET_POS_MIN            0x0007
+#define IS_AOI_IMAGE_GET_SIZE_MIN           0x0008
+#define IS_AOI_IMAGE_GET_POS_MAX            0x0009
+#define IS_AOI_IMAGE_GET_SIZE_MAX           0x0010
+#define IS_AOI_IMAGE_GET_POS_INC            0x0011
+#define IS_AOI_IMAGE_GET_SIZE_INC           0x0012
+#define IS_AOI_IMAGE_SET_POS_FAST           0x0020
+#define IS_AOI_IMAGE_SET_POS_FAST_SUPPORTED 0x0021
+
+/* is_SetBinning */
+#define IS_GET_BINNING                      0x8000
+#define IS_GET_SUPPORTED_BINNING            0x8001
+#define IS_GET_BINNING_FACTOR_HORIZONTAL    0x8004
+#define IS_GET_BINNING_FACTOR_VERTICAL      0x8008
+#define IS_BINNING_DISABLE                  0x0000
+#define IS_BINNING_2X_VERTICAL              0x0001
+#define IS_BINNING_4X_VERTICAL              0x0002
+#define IS_BINNING_3X_VERTICAL              0x0004
+#define IS_BINNING_2X_HORIZONTAL            0x0020
+#define IS_BINNING_4X_HORIZONTAL            0x0040
+#define IS_BINNING_3X_HORIZONTAL            0x0080
+
+/* is_SetSubSampling */
+#define IS_GET_SUBSAMPLING                  0x8000
+#define IS_GET_SUPPORTED_SUBSAMPLING        0x8001
+#define IS_GET_SUBSAMPLING_FACTOR_HORIZONTAL 0x8004
+#define IS_GET_SUBSAMPLING_FACTOR_VERTICAL  0x8008
+#define IS_SUBSAMPLING_DISABLE              0x0000
+#define IS_SUBSAMPLING_2X_VERTICAL          0x0001
+#define IS_SUBSAMPLING_2X_HORIZONTAL        0x0002
+#define IS_SUBSAMPLING_4X_VERTICAL          0x0004
+#define IS_SUBSAMPLING_4X_HORIZONTAL        0x0008
+#define IS_SUBSAMPLING_3X_VERTICAL          0x0010
+#define IS_SUBSAMPLING_3X_HORIZONTAL        0x0020
+
+/* is_PixelClock */
+#define IS_PIXELCLOCK_CMD_GET_NUMBER        1
+#define IS_PIXELCLOCK_CMD_GET_LIST          2
+#define IS_PIXELCLOCK_CMD_GET_RANGE         3
+#define IS_PIXELCLOCK_CMD_GET_DEFAULT       4
+#define IS_PIXELCLOCK_CMD_GET               5
+#define IS_PIXELCLOCK_CMD_SET               6
+
+/* is_Exposure */
+#define IS_EXPOSURE_CMD_GET_CAPS                    1
+#define IS_EXPOSURE_CMD_GET_EXPOSURE_DEFAULT        2
+#define IS_EXPOSURE_CMD_GET_EXPOSURE                3
+#define IS_EXPOSURE_CMD_GET_EXPOSURE_RANGE_MIN      4
+#define IS_EXPOSURE_CMD_GET_EXPOSURE_RANGE_MAX      5
+#define IS_EXPOSURE_CMD_GET_EXPOSURE_RANGE_INC      6
+#define IS_EXPOSURE_CMD_GET_EXPOSURE_RANGE          7
+#define IS_EXPOSURE_CMD_SET_EXPOSURE                12
+
+/* is_CaptureStatus */
+#define IS_CAPTURE_STATUS_INFO_CMD_RESET    1
+#define IS_CAPTURE_STATUS_INFO_CMD_GET      2
+
+#define IS_CAP_STATUS_API_NO_DEST_MEM       0xa2
+#define IS_CAP_STATUS_API_CONVERSION_FAILED 0xa3
+#define IS_CAP_STATUS_API_IMAGE_LOCKED      0xa5
+#define IS_CAP_STATUS_DRV_OUT_OF_BUFFERS    0xb2
+#define IS_CAP_STATUS_DRV_DEVICE_NOT_READY  0xb4
+#define IS_CAP_STATUS_USB_TRANSFER_FAILED   0xc7
+#define IS_CAP_STATUS_DEV_TIMEOUT           0xd6
+
+typedef struct _IS_RECT
+{
+	INT s32X;
+	INT s32Y;
+	INT s32Width;
+	INT s32Height;
+} IS_RECT;
+
+typedef struct _IS_POINT_2D
+{
+	INT s32X;
+	INT s32Y;
+} IS_POINT_2D;
+
+typedef struct _IS_SIZE_2D
+{
+	INT s32Width;
+	INT s32Height;
+} IS_SIZE_2D;
+
+typedef struct S_RANGE_OF_VALUES_U32
+{
+	UINT u32Minimum;
+	UINT u32Maximum;
+	UINT u32Increment;
+	UINT u32Default;
+	UINT u32Infinite;
+} RANGE_OF_VALUES_U32;
+
+typedef struct _SENSORINFO
+{
+	WORD SensorID;
+	IS_CHAR strSensorName[32];
+	char nColorMode;
+	DWORD nMaxWidth;
+	DWORD nMaxHeight;
+	BOOL bMasterGain;
+	BOOL bRGain;
+	BOOL bGGain;
+	BOOL bBGain;
+	BOOL bGlobShutter;
+	WORD wPixelSize;
+	char nUpperLeftBayerPixel;
+	char Reserved[13];
+} SENSORINFO, *PSENSORINFO;
+
+typedef struct _UEYE_CAMERA_INFO
+{
+	DWORD dwCameraID;
+	DWORD dwDeviceID;
+	DWORD dwSensorID;
+	DWORD dwInUse;
+	IS_CHAR SerNo[16];
+	IS_CHAR Model[16];
+	DWORD dwStatus;
+	DWORD dwReserved[2];
+	IS_CHAR FullModelName[32];
+	DWORD dwReserved2[5];
+} UEYE_CAMERA_INFO, *PUEYE_CAMERA_INFO;
+
+typedef struct _UEYE_CAMERA_LIST
+{
+	ULONG dwCount;
+	UEYE_CAMERA_INFO uci[1];
+} UEYE_CAMERA_LIST, *PUEYE_CAMERA_LIST;
+
+typedef struct _UEYETIME
+{
+	WORD wYear;
+	WORD wMonth;
+	WORD wDay;
+	WORD wHour;
+	WORD wMinute;
+	WORD wSecond;
+	WORD wMilliseconds;
+	BYTE byReserved[10];
+} UEYETIME;
+
+typedef struct _UEYEIMAGEINFO
+{
+	DWORD dwFlags;
+	BYTE byReserved1[4];
+	UINT64 u64TimestampDevice;
+	UEYETIME TimestampSystem;
+	DWORD dwIoStatus;
+	WORD wAOIIndex;
+	WORD wAOICycle;
+	UINT64 u64FrameNumber;
+	DWORD dwImageBuffers;
+	DWORD dwImageBuffersInUse;
+	DWORD dwReserved3;
+	DWORD dwImageHeight;
+	DWORD dwImageWidth;
+	DWORD dwHostProcessTime;
+	BYTE bySequencerIndex;
+	BYTE byReserved2[3];
+	DWORD dwReserved[4];
+} UEYEIMAGEINFO;
+
+typedef struct _UEYE_CAPTURE_STATUS_INFO
+{
+	DWORD dwCapStatusCnt_Total;
+	BYTE reserved[60];
+	DWORD adwCapStatusCnt_Detail[256];
+} UEYE_CAPTURE_STATUS_INFO;
+
+INT is_InitCamera(HIDS *phCam, void *hWnd);
+INT is_ExitCamera(HIDS hCam);
+INT is_GetNumberOfCameras(INT *pnNumCams);
+INT is_GetCameraList(PUEYE_CAMERA_LIST pucl);
+INT is_GetSensorInfo(HIDS hCam, PSENSORINFO pInfo);
+INT is_GetError(HIDS hCam, INT *pErr, IS_CHAR **ppcErr);
+INT is_SetErrorReport(HIDS hCam, INT Mode);
+
+INT is_AOI(HIDS hCam, UINT nCommand, void *pParam, UINT SizeOfParam);
+INT is_SetColorMode(HIDS hCam, INT Mode);
+INT is_SetBinning(HIDS hCam, INT mode);
+INT is_SetSubSampling(HIDS hCam, INT mode);
+INT is_PixelClock(HIDS hCam, UINT nCommand, void *pParam, UINT cbSizeOfParam);
+INT is_Exposure(HIDS hCam, UINT nCommand, void *pParam, UINT cbSizeOfParam);
+INT is_SetFrameRate(HIDS hCam, double FPS, double *newFPS);
+INT is_GetFrameTimeRange(HIDS hCam, double *min, double *max, double *intervall);
+
+INT is_AllocImageMem(HIDS hCam, INT width, INT height, INT bitspixel, char **ppcImgMem, int *pid);
+INT is_SetAllocatedImageMem(HIDS hCam, INT width, INT height, INT bitspixel, char *pcImgMem, int *pid);
+INT is_FreeImageMem(HIDS hCam, char *pcMem, int id);
+INT is_CopyImageMem(HIDS hCam, char *pcSource, int nID, char *pcDest);
+INT is_SetImageMem(HIDS hCam, char *pcMem, int id);
+INT is_InquireImageMem(HIDS hCam, char *pcMem, int nID, int *pnX, int *pnY, int *pnBits, int *pnPitch);
+INT is_GetImageMemPitch(HIDS hCam, INT *pPitch);
+
+INT is_FreezeVideo(HIDS hCam, INT Wait);
+INT is_CaptureVideo(HIDS hCam, INT Wait);
+INT is_StopLiveVideo(HIDS hCam, INT Wait);
+INT is_AddToSequence(HIDS hCam, char *pcMem, INT nID);
+INT is_ClearSequence(HIDS hCam);
+INT is_InitImageQueue(HIDS hCam, INT nMode);
+INT is_ExitImageQueue(HIDS hCam);
+INT is_WaitForNextImage(HIDS hCam, UINT timeout, char **ppcMem, INT *imageID);
+INT is_UnlockSeqBuf(HIDS hCam, INT nNum, char *pcMem);
+INT is_SetExternalTrigger(HIDS hCam, INT nTriggerMode);
+INT is_ForceTrigger(HIDS hCam);
+INT is_SetTriggerDelay(HIDS hCam, INT nTriggerDelay);
+INT is_Trigger(HIDS hCam, UINT nCommand, void *pParam, UINT cbSizeOfParam);
+INT is_CaptureStatus(HIDS hCam, UINT nCommand, void *pParam, UINT cbSizeOfParam);
+INT is_EnableEvent(HIDS hCam, INT which);
+INT is_DisableEvent(HIDS hCam, INT which);
+INT is_WaitEvent(HIDS hCam, INT which, INT nTimeout);
+INT is_GetImageInfo(HIDS hCam, INT nImageBufferID, UEYEIMAGEINFO *pImageInfo, INT nImageInfoSize);
+
+#endif
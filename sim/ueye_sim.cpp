@@ -0,0 +1,1352 @@
+/*
+ * Simulated uEye camera backend.
+ *
+ * Implements the SDK functions declared in sim/ueye.h on top of a software
+ * device: frames are generated by one thread per camera at the configured
+ * frame rate, written into the sequence buffers and delivered through the
+ * image queue and frame events, like the real driver does. The sensor
+ * model derives its timing limits from the pixel clock and the AOI, which
+ * binning and subsampling (2x and 4x) scale down, and emulates sequence buffer locking, missed frames when no buffer is free and
+ * transfer failures (IS_CAPTURE_STATUS).
+ *
+ * The simulation is configured with environment variables, read once :
+ *  UEYE_SIM_CAMERAS              number of cameras (1)
+ *  UEYE_SIM_WIDTH/HEIGHT         sensor size (1280x1024)
+ *  UEYE_SIM_COLOR_MODE           initial IS_CM_* color mode (IS_CM_BGR8_PACKED)
+ *  UEYE_SIM_PIXEL_CLOCK          initial pixel clock in MHz (100)
+ *  UEYE_SIM_PIXEL_CLOCK_MAX      highest pixel clock offered in MHz (1000)
+ *  UEYE_SIM_FRAME_RATE           initial frame rate (30)
+ *  UEYE_SIM_TRANSFER_FAILURE     probability for a frame to fail transfer (0)
+ */
+extern "C"{
+#include <ueye.h>
+}
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace{
+
+typedef std::chrono::steady_clock Clock;
+
+const int HORIZONTAL_BLANKING = 64;
+const int VERTICAL_BLANKING = 16;
+const double MAX_FRAME_TIME = 1.0;
+const int AOI_POS_INC = 2;
+const int AOI_WIDTH_INC = 8;
+const int AOI_HEIGHT_INC = 2;
+const int AOI_MIN_WIDTH = 32;
+const int AOI_MIN_HEIGHT = 4;
+// the simulated sensor bins and subsamples by 2 or 4 in each direction
+const INT SUPPORTED_BINNING = IS_BINNING_2X_HORIZONTAL | IS_BINNING_4X_HORIZONTAL | IS_BINNING_2X_VERTICAL | IS_BINNING_4X_VERTICAL;
+const INT SUPPORTED_SUBSAMPLING = IS_SUBSAMPLING_2X_HORIZONTAL | IS_SUBSAMPLING_4X_HORIZONTAL | IS_SUBSAMPLING_2X_VERTICAL | IS_SUBSAMPLING_4X_VERTICAL;
+const INT MAX_TRIGGER_DELAY = 4000000;
+const UINT MAX_TRIGGER_BURST = 64;
+const UINT PIXEL_CLOCK_LIST[] = {5, 10, 20, 30, 40, 50, 70, 86, 100, 150, 200, 250, 300, 400, 500, 600, 800, 1000};
+
+int envInt(const char *name, int default_value)
+{
+	const char *value = std::getenv(name);
+	return value ? std::atoi(value) : default_value;
+}
+
+double envDouble(const char *name, double default_value)
+{
+	const char *value = std::getenv(name);
+	return value ? std::atof(value) : default_value;
+}
+
+struct SimulationConfig
+{
+	SimulationConfig():
+		CameraCount(envInt("UEYE_SIM_CAMERAS", 1)),
+		Width(envInt("UEYE_SIM_WIDTH", 1280)),
+		Height(envInt("UEYE_SIM_HEIGHT", 1024)),
+		ColorMode(envInt("UEYE_SIM_COLOR_MODE", IS_CM_BGR8_PACKED)),
+		PixelClock(envInt("UEYE_SIM_PIXEL_CLOCK", 100)),
+		PixelClockMax(envInt("UEYE_SIM_PIXEL_CLOCK_MAX", 1000)),
+		FrameRate(envDouble("UEYE_SIM_FRAME_RATE", 30.0)),
+		TransferFailure(envDouble("UEYE_SIM_TRANSFER_FAILURE", 0.0))
+	{}
+
+	int CameraCount;
+	int Width;
+	int Height;
+	int ColorMode;
+	int PixelClock;
+	int PixelClockMax;
+	double FrameRate;
+	double TransferFailure;
+};
+
+const SimulationConfig& config()
+{
+	static SimulationConfig Config;
+	return Config;
+}
+
+// factor of the single flag of mode among the ones of a direction, 1 without
+// any, 0 when several are set
+int modeFactor(INT mode, INT factor2, INT factor3, INT factor4)
+{
+	int factor = 1;
+	int flags = 0;
+	if(mode & factor2)
+		factor = 2, ++flags;
+	if(mode & factor3)
+		factor = 3, ++flags;
+	if(mode & factor4)
+		factor = 4, ++flags;
+	return flags > 1 ? 0 : factor;
+}
+
+int binningFactor(INT mode, bool horizontal)
+{
+	return horizontal ? modeFactor(mode, IS_BINNING_2X_HORIZONTAL, IS_BINNING_3X_HORIZONTAL, IS_BINNING_4X_HORIZONTAL)
+		: modeFactor(mode, IS_BINNING_2X_VERTICAL, IS_BINNING_3X_VERTICAL, IS_BINNING_4X_VERTICAL);
+}
+
+int subsamplingFactor(INT mode, bool horizontal)
+{
+	return horizontal ? modeFactor(mode, IS_SUBSAMPLING_2X_HORIZONTAL, IS_SUBSAMPLING_3X_HORIZONTAL, IS_SUBSAMPLING_4X_HORIZONTAL)
+		: modeFactor(mode, IS_SUBSAMPLING_2X_VERTICAL, IS_SUBSAMPLING_3X_VERTICAL, IS_SUBSAMPLING_4X_VERTICAL);
+}
+
+bool isMonochrome(int color_mode)
+{
+	switch(color_mode & ~IS_CM_PREFER_PACKED_SOURCE_FORMAT)
+	{
+		case IS_CM_MONO8:
+		case IS_CM_MONO10:
+		case IS_CM_MONO12:
+		case IS_CM_MONO16:
+			return true;
+		default:
+			return false;
+	}
+}
+
+struct Memory
+{
+	char *Ptr;
+	INT Width;
+	INT Height;
+	INT Bits;
+	INT Pitch;
+	bool External; // user memory registered with is_SetAllocatedImageMem, not freed
+	// information on the last image written in the memory
+	UINT64 FrameNumber;
+	UINT64 Timestamp;
+	INT ImageWidth;
+	INT ImageHeight;
+	INT ImagePosX;
+	INT ImagePosY;
+};
+
+struct Pattern
+{
+	Pattern()
+	{
+		for(int i=0; i<512; ++i)
+			Data[i] = (char)i;
+	}
+	char Data[512];
+};
+
+enum BufferState{BUFFER_FREE, BUFFER_FILLING, BUFFER_QUEUED, BUFFER_LOCKED};
+
+struct SequenceBuffer
+{
+	char *Ptr;
+	INT Id;
+	BufferState State;
+	bool Failed;
+};
+
+class SimCamera
+{
+	public:
+	explicit SimCamera(DWORD camera_id);
+	~SimCamera();
+
+	INT fail(INT error, const char *text);
+
+	// sensor size after binning and subsampling
+	INT sensorWidth() const;
+	INT sensorHeight() const;
+	void setDecimation(INT binning, INT subsampling);
+	bool validAOI(INT x, INT y, INT width, INT height) const;
+	double lineTime() const;
+	double minFrameTime() const;
+	double minExposure() const;
+	double maxExposure() const;
+	void setFrameTime(double frame_time);
+	void setExposure(double exposure);
+
+	void startCapture();
+	void stopCapture();
+	void captureLoop();
+	void produceFrame(std::unique_lock<std::mutex> &lock, Clock::time_point start);
+	int nextFreeBuffer();
+	void countStatus(int status);
+	UINT64 deviceTimestamp(Clock::time_point time) const;
+	// start is the time the exposure started
+	void stamp(Memory &memory, uint64_t frame, Clock::time_point start) const;
+
+	static void fill(const Memory &memory, uint64_t frame);
+
+	DWORD CameraId;
+	Clock::time_point DeviceEpoch;
+	std::mutex Mutex;
+	std::condition_variable FrameReady;
+	std::condition_variable StateChanged;
+
+	INT LastError;
+	const char *LastErrorText;
+
+	// AOI
+	INT PosX;
+	INT PosY;
+	INT Width;
+	INT Height;
+	INT Binning;
+	INT Subsampling;
+	INT ColorMode;
+	UINT PixelClock;
+	std::vector<UINT> PixelClockList;
+	double FrameTime;
+	double Exposure;
+
+	std::map<INT, Memory> Memories;
+	INT LastMemoryId;
+	INT ActiveMemoryId;
+
+	std::vector<SequenceBuffer> Sequence;
+	size_t NextBuffer;
+	bool QueueEnabled;
+	std::deque<size_t> Queue;
+
+	// enabled and signaled events, as bit masks of IS_SET_EVENT_*
+	uint32_t EnabledEvents;
+	uint32_t SignaledEvents;
+	std::condition_variable EventSignaled;
+
+	// in trigger mode, the exposures of a burst start the trigger delay after
+	// a trigger, one frame time apart, each frame being read out a frame time
+	// after its start ; triggers received meanwhile are ignored, as by a busy
+	// sensor
+	INT TriggerMode;
+	INT TriggerDelay;
+	UINT TriggerBurst;
+	bool TriggerPending;
+	Clock::time_point TriggerTime;
+
+	bool Capturing;
+	std::thread CaptureThread;
+	uint64_t FrameCount;
+	UEYE_CAPTURE_STATUS_INFO CaptureStatus;
+	std::mt19937 Random;
+	std::uniform_real_distribution<double> FailureDistribution;
+};
+
+std::mutex RegistryMutex;
+std::map<HIDS, SimCamera*> Cameras;
+
+SimCamera* lookup(HIDS camera_handle)
+{
+	std::lock_guard<std::mutex> lock(RegistryMutex);
+	std::map<HIDS, SimCamera*>::iterator it = Cameras.find(camera_handle);
+	return it != Cameras.end() ? it->second : NULL;
+}
+
+// bytes of the pixels of a line, 10 and 12 bit depths being packed sources
+INT lineBytes(INT width, INT bitspixel)
+{
+	if(bitspixel == 10 || bitspixel == 12)
+		return (width*bitspixel + 7) / 8;
+	return width * ((bitspixel+7)/8);
+}
+
+Memory imageMemory(INT width, INT height, INT bitspixel)
+{
+	Memory memory;
+	std::memset(&memory, 0, sizeof(memory));
+	memory.Width = width;
+	memory.Height = height;
+	memory.Bits = bitspixel;
+	// like the SDK, lines are padded to a multiple of 4 bytes
+	memory.Pitch = (lineBytes(width, bitspixel) + 3) & ~3;
+	return memory;
+}
+
+SimCamera::SimCamera(DWORD camera_id):
+	CameraId(camera_id), DeviceEpoch(Clock::now()), LastError(IS_SUCCESS), LastErrorText(NULL),
+	PosX(0), PosY(0), Width(config().Width), Height(config().Height), Binning(IS_BINNING_DISABLE), Subsampling(IS_SUBSAMPLING_DISABLE), ColorMode(config().ColorMode),
+	PixelClock(0), FrameTime(0), Exposure(0), LastMemoryId(0), ActiveMemoryId(0),
+	NextBuffer(0), QueueEnabled(false), EnabledEvents(0), SignaledEvents(0),
+	TriggerMode(IS_SET_TRIGGER_OFF), TriggerDelay(0), TriggerBurst(1), TriggerPending(false), Capturing(false), FrameCount(0),
+	Random(camera_id), FailureDistribution(0.0, 1.0)
+{
+	std::memset(&CaptureStatus, 0, sizeof(CaptureStatus));
+	for(size_t i=0; i<sizeof(PIXEL_CLOCK_LIST)/sizeof(PIXEL_CLOCK_LIST[0]); ++i)
+	{
+		if(PIXEL_CLOCK_LIST[i] <= (UINT)config().PixelClockMax)
+			PixelClockList.push_back(PIXEL_CLOCK_LIST[i]);
+	}
+	PixelClock = PixelClockList.front();
+	for(size_t i=0; i<PixelClockList.size(); ++i)
+	{
+		if(PixelClockList[i] <= (UINT)config().PixelClock)
+			PixelClock = PixelClockList[i];
+	}
+	setFrameTime(1.0/config().FrameRate);
+	setExposure(maxExposure());
+}
+
+SimCamera::~SimCamera()
+{
+	stopCapture();
+	for(std::map<INT, Memory>::iterator it=Memories.begin(); it!=Memories.end(); ++it)
+	{
+		if(!it->second.External)
+			std::free(it->second.Ptr);
+	}
+}
+
+INT SimCamera::fail(INT error, const char *text)
+{
+	LastError = error;
+	LastErrorText = text;
+	return error;
+}
+
+INT SimCamera::sensorWidth() const
+{
+	INT width = config().Width / (binningFactor(Binning, true) * subsamplingFactor(Subsampling, true));
+	return width - width % AOI_WIDTH_INC;
+}
+
+INT SimCamera::sensorHeight() const
+{
+	INT height = config().Height / (binningFactor(Binning, false) * subsamplingFactor(Subsampling, false));
+	return height - height % AOI_HEIGHT_INC;
+}
+
+void SimCamera::setDecimation(INT binning, INT subsampling)
+{
+	int old_x = binningFactor(Binning, true) * subsamplingFactor(Subsampling, true);
+	int old_y = binningFactor(Binning, false) * subsamplingFactor(Subsampling, false);
+	Binning = binning;
+	Subsampling = subsampling;
+	int x = binningFactor(Binning, true) * subsamplingFactor(Subsampling, true);
+	int y = binningFactor(Binning, false) * subsamplingFactor(Subsampling, false);
+	// the AOI keeps covering the same sensor area, within the increments
+	Width = std::max(AOI_MIN_WIDTH, std::min(sensorWidth(), Width * old_x / x / AOI_WIDTH_INC * AOI_WIDTH_INC));
+	Height = std::max(AOI_MIN_HEIGHT, std::min(sensorHeight(), Height * old_y / y / AOI_HEIGHT_INC * AOI_HEIGHT_INC));
+	PosX = std::min(sensorWidth() - Width, PosX * old_x / x) / AOI_POS_INC * AOI_POS_INC;
+	PosY = std::min(sensorHeight() - Height, PosY * old_y / y) / AOI_POS_INC * AOI_POS_INC;
+	setFrameTime(FrameTime);
+}
+
+bool SimCamera::validAOI(INT x, INT y, INT width, INT height) const
+{
+	if(x < 0 || y < 0 || x % AOI_POS_INC || y % AOI_POS_INC)
+		return false;
+	if(width < AOI_MIN_WIDTH || height < AOI_MIN_HEIGHT || width % AOI_WIDTH_INC || height % AOI_HEIGHT_INC)
+		return false;
+	return x + width <= sensorWidth() && y + height <= sensorHeight();
+}
+
+double SimCamera::lineTime() const
+{
+	return (Width + HORIZONTAL_BLANKING) / (PixelClock * 1e6);
+}
+
+double SimCamera::minFrameTime() const
+{
+	return lineTime() * (Height + VERTICAL_BLANKING);
+}
+
+double SimCamera::minExposure() const
+{
+	return lineTime() * 1000.0;
+}
+
+double SimCamera::maxExposure() const
+{
+	return std::max(minExposure(), (FrameTime - lineTime()) * 1000.0);
+}
+
+void SimCamera::setFrameTime(double frame_time)
+{
+	double min = minFrameTime();
+	double step = lineTime();
+	frame_time = std::min(std::max(frame_time, min), std::max(min, MAX_FRAME_TIME));
+	FrameTime = min + std::round((frame_time - min) / step) * step;
+	setExposure(Exposure);
+}
+
+void SimCamera::setExposure(double exposure)
+{
+	double min = minExposure();
+	double step = min;
+	exposure = std::min(std::max(exposure, min), maxExposure());
+	Exposure = min + std::floor((exposure - min) / step) * step;
+}
+
+void SimCamera::startCapture()
+{
+	Capturing = true;
+	CaptureThread = std::thread(&SimCamera::captureLoop, this);
+}
+
+void SimCamera::stopCapture()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Capturing = false;
+	}
+	StateChanged.notify_all();
+	if(CaptureThread.joinable())
+		CaptureThread.join();
+}
+
+void SimCamera::captureLoop()
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	Clock::time_point next = Clock::now();
+	while(Capturing)
+	{
+		Clock::duration frame_time = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(FrameTime));
+		if(TriggerMode != IS_SET_TRIGGER_OFF)
+		{
+			StateChanged.wait(lock, [this]{return !Capturing || TriggerPending || TriggerMode == IS_SET_TRIGGER_OFF;});
+			if(!TriggerPending)
+			{
+				next = Clock::now();
+				continue;
+			}
+			Clock::time_point exposure = TriggerTime + std::chrono::microseconds(TriggerDelay);
+			UINT burst = TriggerBurst;
+			for(UINT i=0; i<burst; ++i, exposure += frame_time)
+			{
+				// the trigger is cancelled when the trigger mode changes
+				if(StateChanged.wait_until(lock, exposure + frame_time, [this]{return !Capturing || !TriggerPending;}))
+					break;
+				produceFrame(lock, exposure);
+			}
+			TriggerPending = false;
+			next = Clock::now();
+			continue;
+		}
+		next += frame_time;
+		Clock::time_point now = Clock::now();
+		// a consumer that stalls the device does not get a burst of late frames
+		if(next + frame_time < now)
+			next = now;
+		if(StateChanged.wait_until(lock, next, [this]{return !Capturing || TriggerMode != IS_SET_TRIGGER_OFF;}))
+			continue;
+		produceFrame(lock, Clock::now());
+	}
+}
+
+void SimCamera::produceFrame(std::unique_lock<std::mutex> &lock, Clock::time_point start)
+{
+	uint64_t frame = FrameCount++;
+	int index = nextFreeBuffer();
+	if(index < 0)
+	{
+		countStatus(IS_CAP_STATUS_API_NO_DEST_MEM);
+		return;
+	}
+	SequenceBuffer &buffer = Sequence[index];
+	buffer.State = BUFFER_FILLING;
+	stamp(Memories[buffer.Id], frame, start);
+	Memory memory = Memories[buffer.Id];
+
+	lock.unlock();
+	fill(memory, frame);
+	lock.lock();
+
+	// the sequence can not be cleared while capturing, so index is still valid
+	SequenceBuffer &filled = Sequence[index];
+	filled.Failed = FailureDistribution(Random) < config().TransferFailure;
+	if(filled.Failed)
+		countStatus(IS_CAP_STATUS_USB_TRANSFER_FAILED);
+	if(EnabledEvents & (1u << IS_SET_EVENT_FRAME))
+	{
+		SignaledEvents |= 1u << IS_SET_EVENT_FRAME;
+		EventSignaled.notify_all();
+	}
+	if(QueueEnabled)
+	{
+		filled.State = BUFFER_QUEUED;
+		Queue.push_back(index);
+		FrameReady.notify_all();
+	}
+	else
+	{
+		filled.State = BUFFER_FREE;
+	}
+}
+
+int SimCamera::nextFreeBuffer()
+{
+	for(size_t i=0; i<Sequence.size(); ++i)
+	{
+		size_t index = (NextBuffer + i) % Sequence.size();
+		if(Sequence[index].State == BUFFER_FREE)
+		{
+			NextBuffer = index + 1;
+			return index;
+		}
+	}
+	return -1;
+}
+
+void SimCamera::countStatus(int status)
+{
+	++CaptureStatus.dwCapStatusCnt_Total;
+	++CaptureStatus.adwCapStatusCnt_Detail[status];
+}
+
+UINT64 SimCamera::deviceTimestamp(Clock::time_point time) const
+{
+	// device clock ticks are 0.1 us
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time - DeviceEpoch).count() / 100;
+}
+
+void SimCamera::stamp(Memory &memory, uint64_t frame, Clock::time_point start) const
+{
+	memory.FrameNumber = frame;
+	memory.Timestamp = deviceTimestamp(start);
+	// the AOI is latched at the start of the frame, cropped to the memory
+	memory.ImageWidth = std::min(Width, memory.Width);
+	memory.ImageHeight = std::min(Height, memory.Height);
+	memory.ImagePosX = PosX;
+	memory.ImagePosY = PosY;
+}
+
+void SimCamera::fill(const Memory &memory, uint64_t frame)
+{
+	// diagonal gradient moving by 4 pixels per frame, offset by the AOI
+	// position, written with 256 byte copies so that generation cost stays
+	// close to the memory bandwidth
+	static const Pattern pattern;
+	INT line = std::min(lineBytes(memory.ImageWidth, memory.Bits), memory.Pitch);
+	for(INT y=0; y<memory.ImageHeight; ++y)
+	{
+		char *row = memory.Ptr + (size_t)y*memory.Pitch;
+		const char *src = pattern.Data + ((y + memory.ImagePosX + memory.ImagePosY + frame*4) & 0xff);
+		for(INT x=0; x<line; x+=256)
+			std::memcpy(row+x, src, std::min(256, line-x));
+	}
+}
+
+}
+
+extern "C"{
+
+INT is_InitCamera(HIDS *phCam, void *hWnd)
+{
+	std::lock_guard<std::mutex> lock(RegistryMutex);
+	DWORD requested = *phCam;
+	DWORD camera_id = 0;
+	if(requested & IS_USE_DEVICE_ID)
+		requested &= ~IS_USE_DEVICE_ID;
+	if(requested == 0)
+	{
+		for(int i=1; i<=config().CameraCount && !camera_id; ++i)
+		{
+			if(!Cameras.count(i))
+				camera_id = i;
+		}
+	}
+	else if(requested <= (DWORD)config().CameraCount && !Cameras.count(requested))
+	{
+		camera_id = requested;
+	}
+	if(!camera_id)
+		return IS_CANT_OPEN_DEVICE;
+	Cameras[camera_id] = new SimCamera(camera_id);
+	*phCam = camera_id;
+	return IS_SUCCESS;
+}
+
+INT is_ExitCamera(HIDS hCam)
+{
+	SimCamera *camera = NULL;
+	{
+		std::lock_guard<std::mutex> lock(RegistryMutex);
+		std::map<HIDS, SimCamera*>::iterator it = Cameras.find(hCam);
+		if(it == Cameras.end())
+			return IS_INVALID_CAMERA_HANDLE;
+		camera = it->second;
+		Cameras.erase(it);
+	}
+	delete camera;
+	return IS_SUCCESS;
+}
+
+INT is_GetNumberOfCameras(INT *pnNumCams)
+{
+	*pnNumCams = config().CameraCount;
+	return IS_SUCCESS;
+}
+
+INT is_GetCameraList(PUEYE_CAMERA_LIST pucl)
+{
+	std::lock_guard<std::mutex> lock(RegistryMutex);
+	ULONG count = std::min<ULONG>(pucl->dwCount, config().CameraCount);
+	for(ULONG i=0; i<count; ++i)
+	{
+		UEYE_CAMERA_INFO &info = pucl->uci[i];
+		std::memset(&info, 0, sizeof(info));
+		info.dwCameraID = i+1;
+		info.dwDeviceID = i+1;
+		info.dwSensorID = 0xffff;
+		info.dwInUse = Cameras.count(i+1);
+		std::snprintf(info.SerNo, sizeof(info.SerNo), "SIM%06u", (unsigned)(i+1));
+		std::snprintf(info.Model, sizeof(info.Model), "UI-SIM");
+		std::snprintf(info.FullModelName, sizeof(info.FullModelName), "UI-SIM simulated camera");
+	}
+	pucl->dwCount = count;
+	return IS_SUCCESS;
+}
+
+INT is_GetSensorInfo(HIDS hCam, PSENSORINFO pInfo)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::memset(pInfo, 0, sizeof(*pInfo));
+	pInfo->SensorID = 0xffff;
+	std::snprintf(pInfo->strSensorName, sizeof(pInfo->strSensorName), "UI-SIM-%s", isMonochrome(config().ColorMode) ? "M" : "C");
+	pInfo->nColorMode = isMonochrome(config().ColorMode) ? IS_COLORMODE_MONOCHROME : IS_COLORMODE_BAYER;
+	pInfo->nMaxWidth = config().Width;
+	pInfo->nMaxHeight = config().Height;
+	pInfo->bMasterGain = 1;
+	pInfo->bGlobShutter = 1;
+	pInfo->wPixelSize = 345;
+	pInfo->nUpperLeftBayerPixel = BAYER_PIXEL_RED;
+	return IS_SUCCESS;
+}
+
+INT is_GetError(HIDS hCam, INT *pErr, IS_CHAR **ppcErr)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	*pErr = camera->LastError;
+	*ppcErr = const_cast<IS_CHAR*>(camera->LastErrorText);
+	return IS_SUCCESS;
+}
+
+INT is_SetErrorReport(HIDS hCam, INT Mode)
+{
+	return IS_SUCCESS;
+}
+
+INT is_AOI(HIDS hCam, UINT nCommand, void *pParam, UINT SizeOfParam)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	switch(nCommand)
+	{
+		case IS_AOI_IMAGE_GET_AOI:
+		{
+			if(SizeOfParam != sizeof(IS_RECT))
+				break;
+			IS_RECT *rect = static_cast<IS_RECT*>(pParam);
+			rect->s32X = camera->PosX;
+			rect->s32Y = camera->PosY;
+			rect->s32Width = camera->Width;
+			rect->s32Height = camera->Height;
+			return IS_SUCCESS;
+		}
+		case IS_AOI_IMAGE_SET_AOI:
+		{
+			if(SizeOfParam != sizeof(IS_RECT))
+				break;
+			const IS_RECT *rect = static_cast<const IS_RECT*>(pParam);
+			if(camera->Capturing)
+				return camera->fail(IS_CAPTURE_RUNNING, "AOI size can not change while capturing");
+			if(!camera->validAOI(rect->s32X, rect->s32Y, rect->s32Width, rect->s32Height))
+				return camera->fail(IS_INVALID_PARAMETER, "invalid AOI");
+			camera->PosX = rect->s32X;
+			camera->PosY = rect->s32Y;
+			camera->Width = rect->s32Width;
+			camera->Height = rect->s32Height;
+			// the frame rate is kept when still possible, the exposure clamped
+			camera->setFrameTime(camera->FrameTime);
+			return IS_SUCCESS;
+		}
+		case IS_AOI_IMAGE_SET_POS:
+		case IS_AOI_IMAGE_SET_POS_FAST:
+		{
+			if(SizeOfParam != sizeof(IS_POINT_2D))
+				break;
+			const IS_POINT_2D *point = static_cast<const IS_POINT_2D*>(pParam);
+			if(nCommand == IS_AOI_IMAGE_SET_POS && camera->Capturing)
+				return camera->fail(IS_CAPTURE_RUNNING, "use IS_AOI_IMAGE_SET_POS_FAST while capturing");
+			if(!camera->validAOI(point->s32X, point->s32Y, camera->Width, camera->Height))
+				return camera->fail(IS_INVALID_PARAMETER, "invalid AOI position");
+			// applied from the next frame started
+			camera->PosX = point->s32X;
+			camera->PosY = point->s32Y;
+			return IS_SUCCESS;
+		}
+		case IS_AOI_IMAGE_SET_POS_FAST_SUPPORTED:
+		{
+			if(SizeOfParam != sizeof(INT))
+				break;
+			*static_cast<INT*>(pParam) = IS_AOI_IMAGE_SET_POS_FAST_SUPPORTED;
+			return IS_SUCCESS;
+		}
+		case IS_AOI_IMAGE_GET_POS_INC:
+		case IS_AOI_IMAGE_GET_SIZE_INC:
+		case IS_AOI_IMAGE_GET_SIZE_MIN:
+		{
+			if(SizeOfParam != sizeof(IS_SIZE_2D))
+				break;
+			IS_SIZE_2D *size = static_cast<IS_SIZE_2D*>(pParam);
+			size->s32Width = nCommand == IS_AOI_IMAGE_GET_POS_INC ? AOI_POS_INC : nCommand == IS_AOI_IMAGE_GET_SIZE_INC ? AOI_WIDTH_INC : AOI_MIN_WIDTH;
+			size->s32Height = nCommand == IS_AOI_IMAGE_GET_POS_INC ? AOI_POS_INC : nCommand == IS_AOI_IMAGE_GET_SIZE_INC ? AOI_HEIGHT_INC : AOI_MIN_HEIGHT;
+			return IS_SUCCESS;
+		}
+	}
+	return camera->fail(IS_NOT_SUPPORTED, "AOI command not supported by the simulation");
+}
+
+INT is_SetColorMode(HIDS hCam, INT Mode)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	if(Mode == IS_GET_COLOR_MODE)
+		return camera->ColorMode;
+	camera->ColorMode = Mode;
+	return IS_SUCCESS;
+}
+
+INT is_SetBinning(HIDS hCam, INT mode)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	switch(mode)
+	{
+		case IS_GET_BINNING:
+			return camera->Binning;
+		case IS_GET_SUPPORTED_BINNING:
+			return SUPPORTED_BINNING;
+		case IS_GET_BINNING_FACTOR_HORIZONTAL:
+			return binningFactor(camera->Binning, true);
+		case IS_GET_BINNING_FACTOR_VERTICAL:
+			return binningFactor(camera->Binning, false);
+	}
+	if((mode & ~SUPPORTED_BINNING) || !binningFactor(mode, true) || !binningFactor(mode, false))
+		return camera->fail(IS_INVALID_PARAMETER, "binning mode not supported");
+	if(camera->Capturing)
+		return camera->fail(IS_CAPTURE_RUNNING, "binning can not change while capturing");
+	camera->setDecimation(mode, camera->Subsampling);
+	return IS_SUCCESS;
+}
+
+INT is_SetSubSampling(HIDS hCam, INT mode)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	switch(mode)
+	{
+		case IS_GET_SUBSAMPLING:
+			return camera->Subsampling;
+		case IS_GET_SUPPORTED_SUBSAMPLING:
+			return SUPPORTED_SUBSAMPLING;
+		case IS_GET_SUBSAMPLING_FACTOR_HORIZONTAL:
+			return subsamplingFactor(camera->Subsampling, true);
+		case IS_GET_SUBSAMPLING_FACTOR_VERTICAL:
+			return subsamplingFactor(camera->Subsampling, false);
+	}
+	if((mode & ~SUPPORTED_SUBSAMPLING) || !subsamplingFactor(mode, true) || !subsamplingFactor(mode, false))
+		return camera->fail(IS_INVALID_PARAMETER, "subsampling mode not supported");
+	if(camera->Capturing)
+		return camera->fail(IS_CAPTURE_RUNNING, "subsampling can not change while capturing");
+	camera->setDecimation(camera->Binning, mode);
+	return IS_SUCCESS;
+}
+
+INT is_PixelClock(HIDS hCam, UINT nCommand, void *pParam, UINT cbSizeOfParam)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	UINT *param = static_cast<UINT*>(pParam);
+	const std::vector<UINT> &list = camera->PixelClockList;
+	switch(nCommand)
+	{
+		case IS_PIXELCLOCK_CMD_GET_NUMBER:
+			*param = list.size();
+			return IS_SUCCESS;
+		case IS_PIXELCLOCK_CMD_GET_LIST:
+			if(cbSizeOfParam < list.size()*sizeof(UINT))
+				return camera->fail(IS_INVALID_PARAMETER, "pixel clock list buffer too small");
+			std::copy(list.begin(), list.end(), param);
+			return IS_SUCCESS;
+		case IS_PIXELCLOCK_CMD_GET_RANGE:
+			param[0] = list.front();
+			param[1] = list.back();
+			param[2] = 0;
+			return IS_SUCCESS;
+		case IS_PIXELCLOCK_CMD_GET_DEFAULT:
+			*param = list.front();
+			return IS_SUCCESS;
+		case IS_PIXELCLOCK_CMD_GET:
+			*param = camera->PixelClock;
+			return IS_SUCCESS;
+		case IS_PIXELCLOCK_CMD_SET:
+			if(std::find(list.begin(), list.end(), *param) == list.end())
+				return camera->fail(IS_INVALID_PARAMETER, "pixel clock not in the list of supported values");
+			camera->PixelClock = *param;
+			camera->setFrameTime(camera->FrameTime);
+			return IS_SUCCESS;
+		default:
+			return camera->fail(IS_NOT_SUPPORTED, "pixel clock command not supported by the simulation");
+	}
+}
+
+INT is_Exposure(HIDS hCam, UINT nCommand, void *pParam, UINT cbSizeOfParam)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	double *param = static_cast<double*>(pParam);
+	switch(nCommand)
+	{
+		case IS_EXPOSURE_CMD_GET_CAPS:
+			*static_cast<UINT*>(pParam) = 0;
+			return IS_SUCCESS;
+		case IS_EXPOSURE_CMD_GET_EXPOSURE_DEFAULT:
+			*param = camera->maxExposure();
+			return IS_SUCCESS;
+		case IS_EXPOSURE_CMD_GET_EXPOSURE:
+			*param = camera->Exposure;
+			return IS_SUCCESS;
+		case IS_EXPOSURE_CMD_GET_EXPOSURE_RANGE_MIN:
+			*param = camera->minExposure();
+			return IS_SUCCESS;
+		case IS_EXPOSURE_CMD_GET_EXPOSURE_RANGE_MAX:
+			*param = camera->maxExposure();
+			return IS_SUCCESS;
+		case IS_EXPOSURE_CMD_GET_EXPOSURE_RANGE_INC:
+			*param = camera->minExposure();
+			return IS_SUCCESS;
+		case IS_EXPOSURE_CMD_GET_EXPOSURE_RANGE:
+			if(cbSizeOfParam < 3*sizeof(double))
+				return camera->fail(IS_INVALID_PARAMETER, "exposure range buffer too small");
+			param[0] = camera->minExposure();
+			param[1] = camera->maxExposure();
+			param[2] = camera->minExposure();
+			return IS_SUCCESS;
+		case IS_EXPOSURE_CMD_SET_EXPOSURE:
+			camera->setExposure(*param);
+			*param = camera->Exposure;
+			return IS_SUCCESS;
+		default:
+			return camera->fail(IS_NOT_SUPPORTED, "exposure command not supported by the simulation");
+	}
+}
+
+INT is_SetFrameRate(HIDS hCam, double FPS, double *newFPS)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	if(FPS != IS_GET_FRAMERATE)
+	{
+		if(FPS <= 0)
+			return camera->fail(IS_INVALID_PARAMETER, "invalid frame rate");
+		camera->setFrameTime(1.0/FPS);
+	}
+	*newFPS = 1.0/camera->FrameTime;
+	return IS_SUCCESS;
+}
+
+INT is_GetFrameTimeRange(HIDS hCam, double *min, double *max, double *intervall)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	*min = camera->minFrameTime();
+	*max = std::max(*min, MAX_FRAME_TIME);
+	*intervall = camera->lineTime();
+	return IS_SUCCESS;
+}
+
+INT is_AllocImageMem(HIDS hCam, INT width, INT height, INT bitspixel, char **ppcImgMem, int *pid)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	if(width <= 0 || height <= 0 || bitspixel <= 0)
+		return camera->fail(IS_INVALID_PARAMETER, "invalid image memory size");
+	Memory memory = imageMemory(width, height, bitspixel);
+	void *ptr = NULL;
+	if(posix_memalign(&ptr, 64, (size_t)memory.Pitch*height) != 0)
+		return camera->fail(IS_NO_SUCCESS, "out of memory");
+	memory.Ptr = static_cast<char*>(ptr);
+	*ppcImgMem = memory.Ptr;
+	*pid = ++camera->LastMemoryId;
+	camera->Memories[*pid] = memory;
+	return IS_SUCCESS;
+}
+
+INT is_SetAllocatedImageMem(HIDS hCam, INT width, INT height, INT bitspixel, char *pcImgMem, int *pid)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	if(width <= 0 || height <= 0 || bitspixel <= 0)
+		return camera->fail(IS_INVALID_PARAMETER, "invalid image memory size");
+	if(!pcImgMem)
+		return camera->fail(IS_INVALID_MEMORY_POINTER, "null image memory");
+	Memory memory = imageMemory(width, height, bitspixel);
+	memory.Ptr = pcImgMem;
+	memory.External = true;
+	*pid = ++camera->LastMemoryId;
+	camera->Memories[*pid] = memory;
+	return IS_SUCCESS;
+}
+
+INT is_FreeImageMem(HIDS hCam, char *pcMem, int id)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	std::map<INT, Memory>::iterator it = camera->Memories.find(id);
+	if(it == camera->Memories.end() || it->second.Ptr != pcMem)
+		return camera->fail(IS_INVALID_MEMORY_POINTER, "unknown image memory");
+	if(!it->second.External)
+		std::free(it->second.Ptr);
+	camera->Memories.erase(it);
+	if(camera->ActiveMemoryId == id)
+		camera->ActiveMemoryId = 0;
+	return IS_SUCCESS;
+}
+
+INT is_CopyImageMem(HIDS hCam, char *pcSource, int nID, char *pcDest)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	size_t size = 0;
+	{
+		std::lock_guard<std::mutex> lock(camera->Mutex);
+		std::map<INT, Memory>::iterator it = camera->Memories.find(nID);
+		if(it == camera->Memories.end() || it->second.Ptr != pcSource)
+			return camera->fail(IS_INVALID_MEMORY_POINTER, "unknown image memory");
+		size = (size_t)it->second.Pitch * it->second.Height;
+	}
+	std::memcpy(pcDest, pcSource, size);
+	return IS_SUCCESS;
+}
+
+INT is_SetImageMem(HIDS hCam, char *pcMem, int id)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	std::map<INT, Memory>::iterator it = camera->Memories.find(id);
+	if(it == camera->Memories.end() || it->second.Ptr != pcMem)
+		return camera->fail(IS_INVALID_MEMORY_POINTER, "unknown image memory");
+	camera->ActiveMemoryId = id;
+	return IS_SUCCESS;
+}
+
+INT is_InquireImageMem(HIDS hCam, char *pcMem, int nID, int *pnX, int *pnY, int *pnBits, int *pnPitch)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	std::map<INT, Memory>::iterator it = camera->Memories.find(nID);
+	if(it == camera->Memories.end() || it->second.Ptr != pcMem)
+		return camera->fail(IS_INVALID_MEMORY_POINTER, "unknown image memory");
+	if(pnX)
+		*pnX = it->second.Width;
+	if(pnY)
+		*pnY = it->second.Height;
+	if(pnBits)
+		*pnBits = it->second.Bits;
+	if(pnPitch)
+		*pnPitch = it->second.Pitch;
+	return IS_SUCCESS;
+}
+
+INT is_GetImageMemPitch(HIDS hCam, INT *pPitch)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	std::map<INT, Memory>::iterator it = camera->Memories.find(camera->ActiveMemoryId);
+	if(it == camera->Memories.end())
+		return camera->fail(IS_NO_ACTIVE_IMG_MEM, "no active image memory");
+	*pPitch = it->second.Pitch;
+	return IS_SUCCESS;
+}
+
+INT is_FreezeVideo(HIDS hCam, INT Wait)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	Memory memory;
+	uint64_t frame;
+	double frame_time;
+	{
+		std::lock_guard<std::mutex> lock(camera->Mutex);
+		if(camera->Capturing)
+			return camera->fail(IS_CAPTURE_RUNNING, "capture already running");
+		if(!camera->Memories.count(camera->ActiveMemoryId))
+			return camera->fail(IS_NO_ACTIVE_IMG_MEM, "no active image memory");
+		frame = camera->FrameCount++;
+		camera->stamp(camera->Memories[camera->ActiveMemoryId], frame, Clock::now());
+		memory = camera->Memories[camera->ActiveMemoryId];
+		frame_time = camera->FrameTime;
+	}
+	std::this_thread::sleep_for(std::chrono::duration<double>(frame_time));
+	SimCamera::fill(memory, frame);
+	return IS_SUCCESS;
+}
+
+INT is_CaptureVideo(HIDS hCam, INT Wait)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	if(camera->Capturing)
+		return IS_SUCCESS;
+	if(camera->Sequence.empty())
+		return camera->fail(IS_NO_ACTIVE_IMG_MEM, "no image memory in sequence");
+	camera->startCapture();
+	return IS_SUCCESS;
+}
+
+INT is_StopLiveVideo(HIDS hCam, INT Wait)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	camera->stopCapture();
+	return IS_SUCCESS;
+}
+
+INT is_AddToSequence(HIDS hCam, char *pcMem, INT nID)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	std::map<INT, Memory>::iterator it = camera->Memories.find(nID);
+	if(it == camera->Memories.end() || it->second.Ptr != pcMem)
+		return camera->fail(IS_INVALID_MEMORY_POINTER, "unknown image memory");
+	SequenceBuffer buffer = {pcMem, nID, BUFFER_FREE, false};
+	camera->Sequence.push_back(buffer);
+	return IS_SUCCESS;
+}
+
+INT is_ClearSequence(HIDS hCam)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	if(camera->Capturing)
+		return camera->fail(IS_CAPTURE_RUNNING, "capture running");
+	camera->Sequence.clear();
+	camera->Queue.clear();
+	camera->NextBuffer = 0;
+	return IS_SUCCESS;
+}
+
+INT is_InitImageQueue(HIDS hCam, INT nMode)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	camera->QueueEnabled = true;
+	camera->Queue.clear();
+	return IS_SUCCESS;
+}
+
+INT is_ExitImageQueue(HIDS hCam)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	camera->QueueEnabled = false;
+	for(size_t i=0; i<camera->Queue.size(); ++i)
+		camera->Sequence[camera->Queue[i]].State = BUFFER_FREE;
+	camera->Queue.clear();
+	return IS_SUCCESS;
+}
+
+INT is_WaitForNextImage(HIDS hCam, UINT timeout, char **ppcMem, INT *imageID)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::unique_lock<std::mutex> lock(camera->Mutex);
+	if(!camera->QueueEnabled)
+		return camera->fail(IS_NO_SUCCESS, "image queue not initialized");
+	if(!camera->FrameReady.wait_for(lock, std::chrono::milliseconds(timeout), [camera]{return !camera->Queue.empty();}))
+		return camera->fail(IS_TIMED_OUT, "timeout while waiting for next image");
+	SequenceBuffer &buffer = camera->Sequence[camera->Queue.front()];
+	camera->Queue.pop_front();
+	buffer.State = BUFFER_LOCKED;
+	*ppcMem = buffer.Ptr;
+	*imageID = buffer.Id;
+	if(buffer.Failed)
+		return camera->fail(IS_CAPTURE_STATUS, "image transfer failed");
+	return IS_SUCCESS;
+}
+
+INT is_UnlockSeqBuf(HIDS hCam, INT nNum, char *pcMem)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	for(size_t i=0; i<camera->Sequence.size(); ++i)
+	{
+		SequenceBuffer &buffer = camera->Sequence[i];
+		if(buffer.Ptr == pcMem || (!pcMem && nNum == (INT)i+1))
+		{
+			if(buffer.State == BUFFER_LOCKED)
+				buffer.State = BUFFER_FREE;
+			return IS_SUCCESS;
+		}
+	}
+	return camera->fail(IS_INVALID_MEMORY_POINTER, "image memory not in sequence");
+}
+
+INT is_SetExternalTrigger(HIDS hCam, INT nTriggerMode)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	{
+		std::lock_guard<std::mutex> lock(camera->Mutex);
+		if(nTriggerMode == IS_GET_EXTERNALTRIGGER)
+			return camera->TriggerMode;
+		// edges never come, but the software trigger works in every mode
+		if(nTriggerMode != IS_SET_TRIGGER_OFF && nTriggerMode != IS_SET_TRIGGER_SOFTWARE && nTriggerMode != IS_SET_TRIGGER_HI_LO && nTriggerMode != IS_SET_TRIGGER_LO_HI)
+			return camera->fail(IS_INVALID_PARAMETER, "invalid trigger mode");
+		camera->TriggerMode = nTriggerMode;
+		camera->TriggerPending = false;
+	}
+	camera->StateChanged.notify_all();
+	return IS_SUCCESS;
+}
+
+INT is_ForceTrigger(HIDS hCam)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	{
+		std::lock_guard<std::mutex> lock(camera->Mutex);
+		if(camera->TriggerMode == IS_SET_TRIGGER_OFF)
+			return camera->fail(IS_NO_SUCCESS, "trigger mode not enabled");
+		if(camera->TriggerPending)
+			return IS_SUCCESS;
+		camera->TriggerPending = true;
+		camera->TriggerTime = Clock::now();
+	}
+	camera->StateChanged.notify_all();
+	return IS_SUCCESS;
+}
+
+INT is_SetTriggerDelay(HIDS hCam, INT nTriggerDelay)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	switch(nTriggerDelay)
+	{
+		case IS_GET_TRIGGER_DELAY:
+			return camera->TriggerDelay;
+		case IS_GET_MIN_TRIGGER_DELAY:
+			return 0;
+		case IS_GET_MAX_TRIGGER_DELAY:
+			return MAX_TRIGGER_DELAY;
+		case IS_GET_TRIGGER_DELAY_GRANULARITY:
+			return 1;
+		default:
+			if(nTriggerDelay < 0 || nTriggerDelay > MAX_TRIGGER_DELAY)
+				return camera->fail(IS_INVALID_PARAMETER, "trigger delay out of range");
+			camera->TriggerDelay = nTriggerDelay;
+			return IS_SUCCESS;
+	}
+}
+
+INT is_Trigger(HIDS hCam, UINT nCommand, void *pParam, UINT cbSizeOfParam)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	switch(nCommand)
+	{
+		case IS_TRIGGER_CMD_GET_BURST_SIZE_SUPPORTED:
+			if(cbSizeOfParam != sizeof(UINT))
+				return camera->fail(IS_INVALID_PARAMETER, "invalid parameter size");
+			*static_cast<UINT*>(pParam) = 1;
+			return IS_SUCCESS;
+		case IS_TRIGGER_CMD_GET_BURST_SIZE_RANGE:
+		{
+			if(cbSizeOfParam != sizeof(RANGE_OF_VALUES_U32))
+				return camera->fail(IS_INVALID_PARAMETER, "invalid parameter size");
+			RANGE_OF_VALUES_U32 range = {1, MAX_TRIGGER_BURST, 1, 1, 0};
+			std::memcpy(pParam, &range, sizeof(range));
+			return IS_SUCCESS;
+		}
+		case IS_TRIGGER_CMD_GET_BURST_SIZE:
+			if(cbSizeOfParam != sizeof(UINT))
+				return camera->fail(IS_INVALID_PARAMETER, "invalid parameter size");
+			*static_cast<UINT*>(pParam) = camera->TriggerBurst;
+			return IS_SUCCESS;
+		case IS_TRIGGER_CMD_SET_BURST_SIZE:
+		{
+			if(cbSizeOfParam != sizeof(UINT))
+				return camera->fail(IS_INVALID_PARAMETER, "invalid parameter size");
+			UINT burst = *static_cast<UINT*>(pParam);
+			if(burst < 1 || burst > MAX_TRIGGER_BURST)
+				return camera->fail(IS_INVALID_PARAMETER, "burst size out of range");
+			camera->TriggerBurst = burst;
+			return IS_SUCCESS;
+		}
+		default:
+			return camera->fail(IS_NOT_SUPPORTED, "trigger command not supported by the simulation");
+	}
+}
+
+INT is_CaptureStatus(HIDS hCam, UINT nCommand, void *pParam, UINT cbSizeOfParam)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	switch(nCommand)
+	{
+		case IS_CAPTURE_STATUS_INFO_CMD_GET:
+			if(cbSizeOfParam != sizeof(UEYE_CAPTURE_STATUS_INFO))
+				return camera->fail(IS_INVALID_PARAMETER, "invalid capture status size");
+			std::memcpy(pParam, &camera->CaptureStatus, sizeof(UEYE_CAPTURE_STATUS_INFO));
+			return IS_SUCCESS;
+		case IS_CAPTURE_STATUS_INFO_CMD_RESET:
+			std::memset(&camera->CaptureStatus, 0, sizeof(UEYE_CAPTURE_STATUS_INFO));
+			return IS_SUCCESS;
+		default:
+			return camera->fail(IS_NOT_SUPPORTED, "capture status command not supported by the simulation");
+	}
+}
+
+INT is_EnableEvent(HIDS hCam, INT which)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	if(which != IS_SET_EVENT_FRAME)
+		return camera->fail(IS_NOT_SUPPORTED, "event not supported by the simulation");
+	camera->EnabledEvents |= 1u << which;
+	return IS_SUCCESS;
+}
+
+INT is_DisableEvent(HIDS hCam, INT which)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	if(which < 0 || which >= 32)
+		return camera->fail(IS_INVALID_PARAMETER, "invalid event");
+	camera->EnabledEvents &= ~(1u << which);
+	camera->SignaledEvents &= ~(1u << which);
+	return IS_SUCCESS;
+}
+
+INT is_WaitEvent(HIDS hCam, INT which, INT nTimeout)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::unique_lock<std::mutex> lock(camera->Mutex);
+	if(which < 0 || which >= 32 || !(camera->EnabledEvents & (1u << which)))
+		return camera->fail(IS_INVALID_PARAMETER, "event not enabled");
+	uint32_t mask = 1u << which;
+	if(!camera->EventSignaled.wait_for(lock, std::chrono::milliseconds(nTimeout), [camera, mask]{return (camera->SignaledEvents & mask) != 0;}))
+		return IS_TIMED_OUT;
+	// events are auto-reset
+	camera->SignaledEvents &= ~mask;
+	return IS_SUCCESS;
+}
+
+INT is_GetImageInfo(HIDS hCam, INT nImageBufferID, UEYEIMAGEINFO *pImageInfo, INT nImageInfoSize)
+{
+	SimCamera *camera = lookup(hCam);
+	if(!camera)
+		return IS_INVALID_CAMERA_HANDLE;
+	std::lock_guard<std::mutex> lock(camera->Mutex);
+	if(nImageInfoSize != sizeof(UEYEIMAGEINFO))
+		return camera->fail(IS_INVALID_PARAMETER, "invalid image info size");
+	std::map<INT, Memory>::iterator it = camera->Memories.find(nImageBufferID);
+	if(it == camera->Memories.end())
+		return camera->fail(IS_INVALID_MEMORY_POINTER, "unknown image memory");
+	std::memset(pImageInfo, 0, sizeof(UEYEIMAGEINFO));
+	pImageInfo->u64TimestampDevice = it->second.Timestamp;
+	pImageInfo->u64FrameNumber = it->second.FrameNumber;
+	pImageInfo->dwImageBuffers = camera->Sequence.size();
+	for(size_t i=0; i<camera->Sequence.size(); ++i)
+	{
+		if(camera->Sequence[i].State != BUFFER_FREE)
+			++pImageInfo->dwImageBuffersInUse;
+	}
+	pImageInfo->dwImageWidth = it->second.ImageWidth;
+	pImageInfo->dwImageHeight = it->second.ImageHeight;
+	return IS_SUCCESS;
+}
+
+}
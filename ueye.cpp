@@ -1,5 +1,9 @@
 #include "ueye.hpp"
-#include <iostream>
+#include "ueye_format.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <ostream>
 
 #define THROW_IF_ERROR(...) \
 { \
@@ -8,119 +12,159 @@
 		throw Exception(CameraHandle, err_, #__VA_ARGS__); \
 }
 
+// SDK call of the camera configuration, counted in SdkCalls
+#define CAMERA_CALL(...) \
+{ \
+	++SdkCalls; \
+	THROW_IF_ERROR(__VA_ARGS__); \
+}
+
+// SDK getters returning the value asked for, negative on error
+#define CAMERA_GET(value, ...) \
+{ \
+	++SdkCalls; \
+	value = (__VA_ARGS__); \
+	if(value < 0) \
+		throw Exception(CameraHandle, value, #__VA_ARGS__); \
+}
+
 namespace{
+	// from the pixel format table, see ueye_format.hpp
 	uint8_t bitDepth(int32_t color_mode)
 	{
-		switch(color_mode & ~IS_CM_PREFER_PACKED_SOURCE_FORMAT)
+		return ueye::pixelBits(color_mode);
+	}
+	
+	// bytes of the pixels of a line, 10 and 12 bit depths being packed
+	size_t lineBytes(uint32_t width, int32_t color_mode)
+	{
+		return ueye::pixelLineBytes(width, color_mode);
+	}
+	
+	void matType(int32_t color_mode, int &type, int &channel)
+	{
+		type = ueye::pixelMatType(color_mode);
+		channel = ueye::pixelViewRows(color_mode);
+	}
+	
+	// SDK modes by TriggerMode
+	const INT TRIGGER_MODES[] = {IS_SET_TRIGGER_OFF, IS_SET_TRIGGER_SOFTWARE, IS_SET_TRIGGER_LO_HI, IS_SET_TRIGGER_HI_LO};
+	
+	int64_t nanoseconds(const std::chrono::steady_clock::time_point &time)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+	}
+	
+	// Expected entries of the table for every IS_CM_* mode : bits per pixel,
+	// unpacked and packed, view() type and rows per line. The 10 and 12 bit
+	// mono and raw modes are transferred as 16 bit pixels unless the packed
+	// source format is asked for, where the switch statements the table
+	// replaced gave 10 and 12 bits in both cases.
+	constexpr bool formatIs(int32_t color_mode, int bits, int packed_bits, int type, int rows)
+	{
+		return ueye::pixelBits(color_mode) == bits && ueye::pixelBits(color_mode | IS_CM_PREFER_PACKED_SOURCE_FORMAT) == packed_bits
+			&& ueye::pixelMatType(color_mode) == type && ueye::pixelViewRows(color_mode) == rows;
+	}
+	
+	static_assert(formatIs(IS_CM_SENSOR_RAW8, 8, 8, CV_8UC1, 1), "IS_CM_SENSOR_RAW8");
+	static_assert(formatIs(IS_CM_SENSOR_RAW10, 16, 10, CV_16UC1, 1), "IS_CM_SENSOR_RAW10");
+	static_assert(formatIs(IS_CM_SENSOR_RAW12, 16, 12, CV_16UC1, 1), "IS_CM_SENSOR_RAW12");
+	static_assert(formatIs(IS_CM_SENSOR_RAW16, 16, 16, CV_16UC1, 1), "IS_CM_SENSOR_RAW16");
+	static_assert(formatIs(IS_CM_MONO8, 8, 8, CV_8UC1, 1), "IS_CM_MONO8");
+	static_assert(formatIs(IS_CM_MONO10, 16, 10, CV_16UC1, 1), "IS_CM_MONO10");
+	static_assert(formatIs(IS_CM_MONO12, 16, 12, CV_16UC1, 1), "IS_CM_MONO12");
+	static_assert(formatIs(IS_CM_MONO16, 16, 16, CV_16UC1, 1), "IS_CM_MONO16");
+	static_assert(formatIs(IS_CM_BGR5_PACKED, 15, 15, CV_8UC2, 1), "IS_CM_BGR5_PACKED");
+	static_assert(formatIs(IS_CM_BGR565_PACKED, 16, 16, CV_8UC2, 1), "IS_CM_BGR565_PACKED");
+	static_assert(formatIs(IS_CM_RGB8_PACKED, 24, 24, CV_8UC3, 1), "IS_CM_RGB8_PACKED");
+	static_assert(formatIs(IS_CM_BGR8_PACKED, 24, 24, CV_8UC3, 1), "IS_CM_BGR8_PACKED");
+	static_assert(formatIs(IS_CM_RGBA8_PACKED, 32, 32, CV_8UC4, 1), "IS_CM_RGBA8_PACKED");
+	static_assert(formatIs(IS_CM_BGRA8_PACKED, 32, 32, CV_8UC4, 1), "IS_CM_BGRA8_PACKED");
+	static_assert(formatIs(IS_CM_RGBY8_PACKED, 32, 32, CV_8UC4, 1), "IS_CM_RGBY8_PACKED");
+	static_assert(formatIs(IS_CM_BGRY8_PACKED, 32, 32, CV_8UC4, 1), "IS_CM_BGRY8_PACKED");
+	static_assert(formatIs(IS_CM_RGB10_PACKED, 30, 30, CV_16UC3, 1), "IS_CM_RGB10_PACKED");
+	static_assert(formatIs(IS_CM_BGR10_PACKED, 30, 30, CV_16UC3, 1), "IS_CM_BGR10_PACKED");
+	static_assert(formatIs(IS_CM_RGB10_UNPACKED, 30, 30, CV_16UC1, 3), "IS_CM_RGB10_UNPACKED");
+	static_assert(formatIs(IS_CM_BGR10_UNPACKED, 30, 30, CV_16UC1, 3), "IS_CM_BGR10_UNPACKED");
+	static_assert(formatIs(IS_CM_RGB12_UNPACKED, 36, 36, CV_16UC1, 3), "IS_CM_RGB12_UNPACKED");
+	static_assert(formatIs(IS_CM_BGR12_UNPACKED, 36, 36, CV_16UC1, 3), "IS_CM_BGR12_UNPACKED");
+	static_assert(formatIs(IS_CM_RGBA12_UNPACKED, 48, 48, CV_16UC1, 4), "IS_CM_RGBA12_UNPACKED");
+	static_assert(formatIs(IS_CM_BGRA12_UNPACKED, 48, 48, CV_16UC1, 4), "IS_CM_BGRA12_UNPACKED");
+	static_assert(formatIs(IS_CM_UYVY_PACKED, 16, 16, CV_8UC2, 1), "IS_CM_UYVY_PACKED");
+	static_assert(formatIs(IS_CM_CBYCRY_PACKED, 16, 16, CV_8UC2, 1), "IS_CM_CBYCRY_PACKED");
+	static_assert(formatIs(IS_CM_RGB8_PLANAR, 24, 24, CV_8UC1, 3), "IS_CM_RGB8_PLANAR");
+	// modes the library does not read
+	static_assert(formatIs(IS_CM_JPEG, 0, 0, CV_8UC1, 1), "IS_CM_JPEG");
+	static_assert(formatIs(IS_CM_UYVY_MONO_PACKED, 0, 0, CV_8UC1, 1), "IS_CM_UYVY_MONO_PACKED");
+	static_assert(formatIs(IS_CM_UYVY_BAYER_PACKED, 0, 0, CV_8UC1, 1), "IS_CM_UYVY_BAYER_PACKED");
+	
+#if CV_VERSION_MAJOR >= 4
+	typedef cv::AccessFlag AccessFlags;
+#else
+	typedef int AccessFlags;
+#endif
+	
+	// Mat allocator for views on leased frames : it never owns pixel memory,
+	// the data handle is the frame lease, released with the last reference
+	class FrameLeaseAllocator: public cv::MatAllocator
+	{
+		public:
+		cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, AccessFlags flags, cv::UMatUsageFlags usage_flags) const
+		{
+			return cv::Mat::getDefaultAllocator()->allocate(dims, sizes, type, data, step, flags, usage_flags);
+		}
+		
+		bool allocate(cv::UMatData* data, AccessFlags access_flags, cv::UMatUsageFlags usage_flags) const
+		{
+			return cv::Mat::getDefaultAllocator()->allocate(data, access_flags, usage_flags);
+		}
+		
+		void deallocate(cv::UMatData* data) const
 		{
-			case IS_CM_MONO16:
-			case IS_CM_SENSOR_RAW16:
-			case IS_CM_BGR565_PACKED:
-			case IS_CM_UYVY_PACKED:
-			case IS_CM_CBYCRY_PACKED:
-				return 16;
-			case IS_CM_MONO12:
-			case IS_CM_SENSOR_RAW12:
-				return 12;
-			case IS_CM_MONO10:
-			case IS_CM_SENSOR_RAW10:
-				return 10;
-			case IS_CM_MONO8:
-			case IS_CM_SENSOR_RAW8:
-				return 8;
-			case IS_CM_RGB12_UNPACKED:
-			case IS_CM_BGR12_UNPACKED:
-				return 36;
-			case IS_CM_RGB10_UNPACKED:
-			case IS_CM_RGB10_PACKED:
-			case IS_CM_BGR10_UNPACKED:
-			case IS_CM_BGR10_PACKED:
-				return 30;
-			case IS_CM_RGB8_PACKED:
-			case IS_CM_BGR8_PACKED:
-			case IS_CM_RGB8_PLANAR:
-				return 24;
-			case IS_CM_RGBA12_UNPACKED:
-			case IS_CM_BGRA12_UNPACKED:
-				return 48;
-			case IS_CM_RGBA8_PACKED:
-			case IS_CM_RGBY8_PACKED:
-			case IS_CM_BGRA8_PACKED:
-			case IS_CM_BGRY8_PACKED:
-				return 32;
-			case IS_CM_BGR5_PACKED:
-				return 15;
-			default:
-				return 0;
+			delete static_cast<ueye::Frame*>(data->handle);
+			delete data;
 		}
+	};
+	
+	const FrameLeaseAllocator* frameLeaseAllocator()
+	{
+		static FrameLeaseAllocator allocator;
+		return &allocator;
 	}
 	
-	void matType(int32_t color_mode, int &type, int &channel)
+	// binning or subsampling flags of one direction, for the factors 2, 3 and 4
+	struct DecimationFlags
 	{
-		channel = 1;
-		switch(color_mode & ~IS_CM_PREFER_PACKED_SOURCE_FORMAT)
+		INT Factor2;
+		INT Factor3;
+		INT Factor4;
+	};
+	const DecimationFlags BINNING_HORIZONTAL = {IS_BINNING_2X_HORIZONTAL, IS_BINNING_3X_HORIZONTAL, IS_BINNING_4X_HORIZONTAL};
+	const DecimationFlags BINNING_VERTICAL = {IS_BINNING_2X_VERTICAL, IS_BINNING_3X_VERTICAL, IS_BINNING_4X_VERTICAL};
+	const DecimationFlags SUBSAMPLING_HORIZONTAL = {IS_SUBSAMPLING_2X_HORIZONTAL, IS_SUBSAMPLING_3X_HORIZONTAL, IS_SUBSAMPLING_4X_HORIZONTAL};
+	const DecimationFlags SUBSAMPLING_VERTICAL = {IS_SUBSAMPLING_2X_VERTICAL, IS_SUBSAMPLING_3X_VERTICAL, IS_SUBSAMPLING_4X_VERTICAL};
+	
+	int decimationFactor(INT mode, const DecimationFlags &flags)
+	{
+		if(mode & flags.Factor4)
+			return 4;
+		if(mode & flags.Factor3)
+			return 3;
+		if(mode & flags.Factor2)
+			return 2;
+		return 1;
+	}
+	
+	INT decimationMode(int factor, const DecimationFlags &flags)
+	{
+		switch(factor)
 		{
-			case IS_CM_MONO16:
-			case IS_CM_SENSOR_RAW16:
-			case IS_CM_MONO12:
-			case IS_CM_SENSOR_RAW12:
-			case IS_CM_MONO10:
-			case IS_CM_SENSOR_RAW10:
-				type = CV_16U;
-				return;
-				
-			case IS_CM_MONO8:
-			case IS_CM_SENSOR_RAW8:
-				type = CV_8U;
-				return;
-				
-			case IS_CM_RGB10_PACKED:
-			case IS_CM_BGR10_PACKED:
-				type = CV_16UC3;
-				return;
-				
-			case IS_CM_UYVY_PACKED:
-			case IS_CM_CBYCRY_PACKED:
-			case IS_CM_BGR565_PACKED:
-			case IS_CM_BGR5_PACKED:
-				type = CV_8UC2;
-				return;
-				
-			case IS_CM_RGB8_PACKED:
-			case IS_CM_BGR8_PACKED:
-				type = CV_8UC3;
-				return;
-				
-			case IS_CM_RGBA8_PACKED:
-			case IS_CM_RGBY8_PACKED:
-			case IS_CM_BGRA8_PACKED:
-			case IS_CM_BGRY8_PACKED:
-				type = CV_8UC4;
-				return;
-			
-			case IS_CM_RGB12_UNPACKED:
-			case IS_CM_BGR12_UNPACKED:
-			case IS_CM_RGB10_UNPACKED:
-			case IS_CM_BGR10_UNPACKED:
-				type = CV_16U;
-				channel = 3;
-				return;
-				
-			case IS_CM_RGB8_PLANAR:
-				type = CV_8U;
-				channel = 3;
-				return;
-				
-			case IS_CM_RGBA12_UNPACKED:
-			case IS_CM_BGRA12_UNPACKED:
-				type = CV_16U;
-				channel = 4;
-				return;
-				
-			default:
-				type = CV_8U;
-				return;
+			case 1: return 0;
+			case 2: return flags.Factor2;
+			case 3: return flags.Factor3;
+			case 4: return flags.Factor4;
 		}
+		return -1;
 	}
 }
 
@@ -165,25 +209,38 @@ const char* Exception::what() const throw()
 }
 
 
+ImageAllocator::~ImageAllocator()
+{}
+
+
 ImageMemory::ImageMemory(const Camera& camera, uint32_t width, uint32_t height, int32_t color_mode):
-	CameraHandle(0), MemoryPtr(NULL), MemoryId(0), Width(0), Height(0), BitDepth(0), ColorMode(0)
+	CameraHandle(0), Allocator(NULL), AllocatedSize(0), MemoryPtr(NULL), MemoryId(0), Width(0), Height(0), CapacityWidth(0), CapacityHeight(0), Pitch(0), BitDepth(0), ColorMode(0)
 {
-	HIDS camera_handle = camera.handle();
-	if(width == 0)
-		width = camera.getAOIWidth();
-	if(height == 0)
-		height = camera.getAOIHeight();
-	if(color_mode == 0)
-		color_mode = camera.getColorMode();
-	create(camera_handle, width, height, color_mode);
+	init(camera, width, height, color_mode);
 }
 
+ImageMemory::ImageMemory(const Camera& camera, ImageAllocator &allocator, uint32_t width, uint32_t height, int32_t color_mode):
+	CameraHandle(0), Allocator(&allocator), AllocatedSize(0), MemoryPtr(NULL), MemoryId(0), Width(0), Height(0), CapacityWidth(0), CapacityHeight(0), Pitch(0), BitDepth(0), ColorMode(0)
+{
+	init(camera, width, height, color_mode);
+}
+
+ImageMemory::ImageMemory(char *data, uint32_t width, uint32_t height, int32_t pitch, int32_t color_mode):
+	CameraHandle(0), Allocator(NULL), AllocatedSize(0), MemoryPtr(data), MemoryId(0), Width(width), Height(height), CapacityWidth(width), CapacityHeight(height), Pitch(pitch), BitDepth(bitDepth(color_mode)), ColorMode(color_mode)
+{}
+
 ImageMemory::ImageMemory(const ImageMemory &memory):
-	CameraHandle(0), MemoryPtr(NULL), MemoryId(0), Width(0), Height(0), BitDepth(0), ColorMode(0)
+	CameraHandle(0), Allocator(NULL), AllocatedSize(0), MemoryPtr(NULL), MemoryId(0), Width(0), Height(0), CapacityWidth(0), CapacityHeight(0), Pitch(0), BitDepth(0), ColorMode(0)
 {
 	*this = memory;
 }
 
+ImageMemory::ImageMemory(ImageMemory &&memory) noexcept:
+	CameraHandle(memory.CameraHandle), Allocator(memory.Allocator), AllocatedSize(memory.AllocatedSize), MemoryPtr(memory.MemoryPtr), MemoryId(memory.MemoryId), Width(memory.Width), Height(memory.Height), CapacityWidth(memory.CapacityWidth), CapacityHeight(memory.CapacityHeight), Pitch(memory.Pitch), BitDepth(memory.BitDepth), ColorMode(memory.ColorMode)
+{
+	memory.MemoryPtr = NULL;
+}
+
 ImageMemory::~ImageMemory()
 {
 	release();
@@ -193,28 +250,93 @@ ImageMemory& ImageMemory::operator=(const ImageMemory &memory)
 {
 	if(this == &memory)
 		return *this;
-	if(memory.CameraHandle!=CameraHandle || memory.Width!=Width || memory.Height!=Height || memory.ColorMode!=ColorMode)
+	if(!memory.CameraHandle)
+		throw Exception(0, IS_INVALID_PARAMETER, "copy of an image memory not registered with the SDK");
+	if(!MemoryPtr || memory.CameraHandle!=CameraHandle || memory.Allocator!=Allocator || memory.CapacityWidth!=CapacityWidth || memory.CapacityHeight!=CapacityHeight || memory.ColorMode!=ColorMode)
 	{
 		release();
-		create(memory.CameraHandle, memory.Width, memory.Height, memory.ColorMode);
+		Allocator = memory.Allocator;
+		create(memory.CameraHandle, memory.CapacityWidth, memory.CapacityHeight, memory.ColorMode);
 	}
 	THROW_IF_ERROR(is_CopyImageMem(CameraHandle, memory.MemoryPtr, memory.MemoryId, MemoryPtr));
+	Width = memory.Width;
+	Height = memory.Height;
+	return *this;
+}
+
+ImageMemory& ImageMemory::operator=(ImageMemory &&memory) noexcept
+{
+	if(this == &memory)
+		return *this;
+	release();
+	CameraHandle = memory.CameraHandle;
+	Allocator = memory.Allocator;
+	AllocatedSize = memory.AllocatedSize;
+	MemoryPtr = memory.MemoryPtr;
+	MemoryId = memory.MemoryId;
+	Width = memory.Width;
+	Height = memory.Height;
+	CapacityWidth = memory.CapacityWidth;
+	CapacityHeight = memory.CapacityHeight;
+	Pitch = memory.Pitch;
+	BitDepth = memory.BitDepth;
+	ColorMode = memory.ColorMode;
+	memory.MemoryPtr = NULL;
+	return *this;
+}
+
+void ImageMemory::init(const Camera& camera, uint32_t width, uint32_t height, int32_t color_mode)
+{
+	HIDS camera_handle = camera.handle();
+	if(width == 0)
+		width = camera.getAOIWidth();
+	if(height == 0)
+		height = camera.getAOIHeight();
+	if(color_mode == 0)
+		color_mode = camera.getColorMode();
+	create(camera_handle, width, height, color_mode);
 }
 
 void ImageMemory::create(HIDS camera_handle, uint32_t width, uint32_t height, int32_t color_mode)
 {
 	CameraHandle = camera_handle;
-	Width = width;
-	Height = height;
+	Width = CapacityWidth = width;
+	Height = CapacityHeight = height;
 	ColorMode = color_mode;
 	BitDepth = bitDepth(ColorMode);
-	THROW_IF_ERROR(is_AllocImageMem(CameraHandle, Width, Height, BitDepth, &MemoryPtr, &MemoryId));
+	if(!Allocator)
+	{
+		THROW_IF_ERROR(is_AllocImageMem(CameraHandle, Width, Height, BitDepth, &MemoryPtr, &MemoryId));
+		THROW_IF_ERROR(is_InquireImageMem(CameraHandle, MemoryPtr, MemoryId, NULL, NULL, NULL, &Pitch));
+		return;
+	}
+	
+	// the SDK pads lines to a multiple of 4 bytes
+	size_t line = (lineBytes(Width, ColorMode) + 3) & ~(size_t)3;
+	AllocatedSize = line*Height;
+	char *ptr = static_cast<char*>(Allocator->allocate(AllocatedSize));
+	INT err = is_SetAllocatedImageMem(CameraHandle, Width, Height, BitDepth, ptr, &MemoryId);
+	if(err != IS_SUCCESS)
+	{
+		Allocator->deallocate(ptr, AllocatedSize);
+		throw Exception(CameraHandle, err, "is_SetAllocatedImageMem");
+	}
+	MemoryPtr = ptr;
+	THROW_IF_ERROR(is_InquireImageMem(CameraHandle, MemoryPtr, MemoryId, NULL, NULL, NULL, &Pitch));
+	if((size_t)Pitch*Height > AllocatedSize)
+		throw Exception(CameraHandle, IS_INVALID_MEMORY_POINTER, "image memory smaller than the SDK line pitch");
 }
 
 void ImageMemory::release()
 {
-	if(MemoryPtr)
+	// memory of the caller stays with it
+	if(MemoryPtr && CameraHandle)
+	{
 		is_FreeImageMem(CameraHandle, MemoryPtr, MemoryId);
+		// the SDK only unregisters caller-allocated memory
+		if(Allocator)
+			Allocator->deallocate(MemoryPtr, AllocatedSize);
+	}
 	MemoryPtr = NULL;
 }
 
@@ -238,240 +360,1420 @@ uint32_t ImageMemory::height() const
 	return Height;
 }
 
-void ImageMemory::copyToMat(cv::Mat &mat)const
+uint32_t ImageMemory::capacityWidth() const
 {
-	int mat_type, mat_channel;
-	matType(ColorMode, mat_type,  mat_channel);
-	mat.create(Height*mat_channel, Width, mat_type);
-	THROW_IF_ERROR(is_CopyImageMem(CameraHandle, MemoryPtr, MemoryId, mat.ptr<char>()));
+	return CapacityWidth;
 }
 
-
-std::vector<CameraInfo> getCameraList()
+uint32_t ImageMemory::capacityHeight() const
 {
-	HIDS CameraHandle = 0;
-	
-	INT camera_number;
-	THROW_IF_ERROR(is_GetNumberOfCameras(&camera_number));
-
-	UEYE_CAMERA_LIST *camera_list = (UEYE_CAMERA_LIST*) new uint8_t[sizeof(DWORD)+camera_number*sizeof(UEYE_CAMERA_INFO)];
-	camera_list->dwCount = camera_number;
-	THROW_IF_ERROR(is_GetCameraList(camera_list));
-	
-	std::vector<CameraInfo> result;
-	for(int i=0; i<camera_number; ++i)
-	{
-		CameraInfo info;
-		info.CameraId = camera_list->uci[i].dwCameraID;
-		info.DeviceId = camera_list->uci[i].dwDeviceID;
-		info.SensorId = camera_list->uci[i].dwSensorID;
-		info.InUse = camera_list->uci[i].dwInUse;
-		info.SerialNumber = std::string(camera_list->uci[i].SerNo, 16);
-		info.SerialNumber.resize(info.SerialNumber.find('\0'));
-		info.ModelName = std::string(camera_list->uci[i].Model, 16);
-		info.ModelName.resize(info.ModelName.find('\0'));
-		info.FullModelName = std::string(camera_list->uci[i].FullModelName, 32);
-		info.FullModelName.resize(info.FullModelName.find('\0'));
-		info.CameraStatus = camera_list->uci[i].dwStatus;
-		result.push_back(info);
-	}
-	
-	delete[] camera_list;
-	return  result;
+	return CapacityHeight;
 }
 
-
-Camera::Camera(uint8_t camera_id):
-	CameraHandle(0), ColorMode(0)
+bool ImageMemory::setImageSize(uint32_t width, uint32_t height)
 {
-	CameraHandle = camera_id;
-	THROW_IF_ERROR(is_InitCamera(&CameraHandle, 0));
-	THROW_IF_ERROR(is_GetSensorInfo(CameraHandle, &SensorInfo));
-	THROW_IF_ERROR(is_AOI(CameraHandle, IS_AOI_IMAGE_GET_AOI, &AOI, sizeof(AOI)));
-	ColorMode = is_SetColorMode(CameraHandle, IS_GET_COLOR_MODE);
-	updateTimingInfo(TIMING_INIT);
+	if(width > CapacityWidth || height > CapacityHeight)
+		return false;
+	Width = width;
+	Height = height;
+	return true;
 }
 
-Camera::~Camera()
+int32_t ImageMemory::pitch() const
 {
-	is_ExitCamera(CameraHandle);
+	return Pitch;
 }
 
-std::string Camera::getSensorName()const
+uint8_t ImageMemory::bitsPerPixel() const
 {
-	return std::string(SensorInfo.strSensorName, SensorInfo.strSensorName+32);
+	return BitDepth;
 }
 
-int Camera::getSensorWidth() const
+int32_t ImageMemory::colorMode() const
 {
-	return SensorInfo.nMaxWidth;
+	return ColorMode;
 }
 
-int Camera::getSensorHeight() const
+ImageAllocator* ImageMemory::allocator() const
 {
-	return SensorInfo.nMaxHeight;
+	return Allocator;
 }
 
-uint8_t Camera::getSensorColorMode() const
+void ImageMemory::copyToMat(cv::Mat &mat)const
 {
-	return SensorInfo.nColorMode;
+	cv::Mat source = view();
+	mat.create(source.rows, source.cols, source.type());
+	// the SDK copies the whole memory, only usable when it has no padding
+	if(CameraHandle && Width == CapacityWidth && Height == CapacityHeight && mat.isContinuous() && mat.step[0] == (size_t)Pitch)
+	{
+		THROW_IF_ERROR(is_CopyImageMem(CameraHandle, MemoryPtr, MemoryId, mat.ptr<char>()));
+	}
+	else
+	{
+		source.copyTo(mat);
+	}
 }
 
-int32_t Camera::getAOIPosX() const
+cv::Mat ImageMemory::view()const
 {
-	return AOI.s32X;
+	if(pixelPacking(ColorMode) == PACKING_BITS)
+		return cv::Mat(Height, lineBytes(Width, ColorMode), CV_8U, MemoryPtr, Pitch);
+	int mat_type, mat_channel;
+	matType(ColorMode, mat_type,  mat_channel);
+	// the pitch of a planar format covers the pixels of all its planes
+	size_t step = ColorMode & IS_CM_FORMAT_PLANAR ? Pitch/mat_channel : Pitch;
+	return cv::Mat(Height*mat_channel, Width, mat_type, MemoryPtr, step);
 }
-int32_t Camera::getAOIPosY() const
+
+
+SequenceSizing::SequenceSizing():
+	HoldTime(0.1), MinBuffers(3), MaxBuffers(64), MemoryLimit(512*1024*1024), Grow(true), GrowLostFrames(2)
+{}
+
+
+ImageMemoryPool::ImageMemoryPool(const Camera &camera):
+	Cam(camera), Allocator(NULL), Allocations(0)
+{}
+
+void ImageMemoryPool::setAllocator(ImageAllocator *allocator)
 {
-	return AOI.s32Y;
+	if(allocator == Allocator)
+		return;
+	Idle.clear();
+	Allocator = allocator;
 }
-int32_t Camera::getAOIWidth() const
+
+ImageMemory ImageMemoryPool::acquire(uint32_t width, uint32_t height, int32_t color_mode)
 {
-	return AOI.s32Width;
+	Format key = format(width, height, color_mode);
+	std::map<Format, std::vector<ImageMemory> >::iterator it = Idle.find(key);
+	if(it != Idle.end() && !it->second.empty())
+	{
+		ImageMemory memory(std::move(it->second.back()));
+		it->second.pop_back();
+		memory.setImageSize(memory.capacityWidth(), memory.capacityHeight());
+		return memory;
+	}
+	++Allocations;
+	if(Allocator)
+		return ImageMemory(Cam, *Allocator, key.Width, key.Height, key.ColorMode);
+	return ImageMemory(Cam, key.Width, key.Height, key.ColorMode);
 }
-int32_t Camera::getAOIHeight() const
+
+void ImageMemoryPool::acquire(std::vector<ImageMemory> &buffer, size_t count, uint32_t width, uint32_t height, int32_t color_mode)
 {
-	return AOI.s32Height;
+	buffer.reserve(buffer.size()+count);
+	for(size_t i=0; i<count; ++i)
+		buffer.push_back(acquire(width, height, color_mode));
 }
 
-int32_t Camera::getColorMode() const
+void ImageMemoryPool::release(ImageMemory &&memory)
 {
-	return ColorMode;
+	if(!memory.ptr())
+		return;
+	if(memory.allocator() != Allocator)
+	{
+		// from before setAllocator, freed rather than kept
+		ImageMemory discarded(std::move(memory));
+		return;
+	}
+	// keeps the vector, and its capacity, of formats no longer used
+	Idle[format(memory.capacityWidth(), memory.capacityHeight(), memory.colorMode())].push_back(std::move(memory));
 }
 
-Range<uint32_t> Camera::getPixelClockRange() const
+void ImageMemoryPool::release(std::vector<ImageMemory> &buffer)
 {
-	return PixelClockRange;
+	for(size_t i=0; i<buffer.size(); ++i)
+		release(std::move(buffer[i]));
+	buffer.clear();
 }
-Range<double> Camera::getFrameTimeRange() const
+
+void ImageMemoryPool::clear()
 {
-	return FrameTimeRange;
+	Idle.clear();
 }
-Range<double> Camera::getExposureRange() const
+
+size_t ImageMemoryPool::idleCount() const
 {
-	return ExposureRange;
+	size_t count = 0;
+	for(std::map<Format, std::vector<ImageMemory> >::const_iterator it = Idle.begin(); it != Idle.end(); ++it)
+		count += it->second.size();
+	return count;
 }
-std::vector<uint32_t> Camera::getPixelClockList()const
+
+uint64_t ImageMemoryPool::allocationCount() const
 {
-	return PixelClockList;
+	return Allocations;
 }
-uint32_t Camera::getPixelClock() const
+
+bool ImageMemoryPool::Format::operator<(const Format &format) const
 {
-	return PixelClock;
+	if(Width != format.Width)
+		return Width < format.Width;
+	if(Height != format.Height)
+		return Height < format.Height;
+	return ColorMode < format.ColorMode;
 }
-double Camera::getFrameRate() const
+
+ImageMemoryPool::Format ImageMemoryPool::format(uint32_t width, uint32_t height, int32_t color_mode) const
 {
-	return FrameRate;
+	Format format;
+	format.Width = width ? width : Cam.getAOIWidth();
+	format.Height = height ? height : Cam.getAOIHeight();
+	format.ColorMode = color_mode ? color_mode : Cam.getColorMode();
+	return format;
 }
-double Camera::getExposure() const
+
+
+CaptureStatistics::CaptureStatistics()
 {
-	return Exposure;
+	reset();
 }
-void Camera::setPixelClock(uint32_t pixel_clock)
+
+void CaptureStatistics::reset()
 {
-	THROW_IF_ERROR(is_PixelClock(CameraHandle, IS_PIXELCLOCK_CMD_SET, &pixel_clock, sizeof(pixel_clock)));
-	updateTimingInfo(TIMING_PIXEL_CLOCK);
+	ResetTime.store(nanoseconds(std::chrono::steady_clock::now()), std::memory_order_relaxed);
+	Delivered.store(0, std::memory_order_relaxed);
+	Missed.store(0, std::memory_order_relaxed);
+	Lost.store(0, std::memory_order_relaxed);
+	UnlockedLate.store(0, std::memory_order_relaxed);
+	MeanInterval.store(0, std::memory_order_relaxed);
+	LatencySum.store(0, std::memory_order_relaxed);
+	LatencyMax.store(0, std::memory_order_relaxed);
+	PendingTrigger.store(0, std::memory_order_relaxed);
+	Triggered.store(0, std::memory_order_relaxed);
+	TriggerLatencySum.store(0, std::memory_order_relaxed);
+	TriggerLatencyMax.store(0, std::memory_order_relaxed);
+	BufferCount.store(0, std::memory_order_relaxed);
+	BuffersInUse.store(0, std::memory_order_relaxed);
+	MaxBuffersInUse.store(0, std::memory_order_relaxed);
+	for(size_t i=0; i<JITTER_BINS; ++i)
+		Jitter[i].store(0, std::memory_order_relaxed);
+	LastHostTime = 0;
+	MinOffset = std::numeric_limits<int64_t>::max();
 }
-void Camera::setFrameRate(double frame_rate)
+
+CaptureStatistics::Snapshot CaptureStatistics::snapshot() const
 {
-	THROW_IF_ERROR(is_SetFrameRate(CameraHandle, frame_rate, &FrameRate));
-	updateTimingInfo(TIMING_FRAME_RATE);
+	Snapshot snapshot;
+	int64_t now = nanoseconds(std::chrono::steady_clock::now());
+	snapshot.Duration = (now - ResetTime.load(std::memory_order_relaxed))*1e-9;
+	double mean_interval = MeanInterval.load(std::memory_order_relaxed);
+	snapshot.FrameRate = mean_interval > 0 ? 1.0/mean_interval : 0.0;
+	snapshot.Delivered = Delivered.load(std::memory_order_relaxed);
+	snapshot.Missed = Missed.load(std::memory_order_relaxed);
+	snapshot.Lost = Lost.load(std::memory_order_relaxed);
+	snapshot.UnlockedLate = UnlockedLate.load(std::memory_order_relaxed);
+	snapshot.MeanLatency = snapshot.Delivered ? LatencySum.load(std::memory_order_relaxed)*1e-9/snapshot.Delivered : 0.0;
+	snapshot.MaxLatency = LatencyMax.load(std::memory_order_relaxed)*1e-9;
+	snapshot.Triggered = Triggered.load(std::memory_order_relaxed);
+	snapshot.MeanTriggerLatency = snapshot.Triggered ? TriggerLatencySum.load(std::memory_order_relaxed)*1e-9/snapshot.Triggered : 0.0;
+	snapshot.MaxTriggerLatency = TriggerLatencyMax.load(std::memory_order_relaxed)*1e-9;
+	snapshot.BufferCount = BufferCount.load(std::memory_order_relaxed);
+	snapshot.BuffersInUse = BuffersInUse.load(std::memory_order_relaxed);
+	snapshot.MaxBuffersInUse = MaxBuffersInUse.load(std::memory_order_relaxed);
+	for(size_t i=0; i<JITTER_BINS; ++i)
+		snapshot.Jitter[i] = Jitter[i].load(std::memory_order_relaxed);
+	return snapshot;
 }
-void Camera::setExposure(double exposure)
+
+uint64_t CaptureStatistics::missed() const
 {
-	THROW_IF_ERROR(is_Exposure(CameraHandle, IS_EXPOSURE_CMD_SET_EXPOSURE, &exposure, sizeof(exposure)));
-	updateTimingInfo(TIMING_FRAME_RATE);
+	return Missed.load(std::memory_order_relaxed);
 }
 
-
-void Camera::imageCapture(ImageMemory &image_memory)
+uint64_t CaptureStatistics::delivered() const
 {
-	THROW_IF_ERROR(is_SetImageMem(CameraHandle, image_memory.ptr(), image_memory.id()));
-	THROW_IF_ERROR(is_FreezeVideo(CameraHandle, IS_WAIT));
+	return Delivered.load(std::memory_order_relaxed);
 }
 
-void Camera::videoCaptureStart(std::vector<ImageMemory> &buffer)
+uint64_t CaptureStatistics::lost() const
 {
-	for(size_t i=0; i<buffer.size(); ++i)
-	{
-		THROW_IF_ERROR(is_AddToSequence(CameraHandle, buffer[i].ptr(), buffer[i].id()));
-		SequencePtr[buffer[i].ptr()] = &(buffer[i]);
-	}
-	THROW_IF_ERROR(is_InitImageQueue(CameraHandle, 0));
-	THROW_IF_ERROR(is_CaptureVideo(CameraHandle, IS_WAIT));
+	return Lost.load(std::memory_order_relaxed);
 }
 
-void Camera::videoCaptureStop()
+void CaptureStatistics::triggerForced(std::chrono::steady_clock::time_point time)
 {
-	THROW_IF_ERROR(is_StopLiveVideo(CameraHandle, IS_WAIT));
-	THROW_IF_ERROR(is_ExitImageQueue(CameraHandle));
-	THROW_IF_ERROR(is_ClearSequence(CameraHandle));
-	SequencePtr.clear();
+	PendingTrigger.store(nanoseconds(time), std::memory_order_relaxed);
 }
 
-ImageMemory* Camera::waitNextFrame(uint32_t timeout)
+void CaptureStatistics::frameDelivered(const FrameInfo &info)
 {
-	char *ptr=NULL;
-	int id;
-	bool ok = false;
-	while(!ok)
+	int64_t host_time = nanoseconds(info.HostTimestamp);
+	uint64_t delivered = Delivered.fetch_add(1, std::memory_order_relaxed);
+	Lost.fetch_add(info.LostBefore, std::memory_order_relaxed);
+	
+	// interval between deliveries, per sensor frame when frames were lost
+	if(delivered > 0)
 	{
-		INT err = is_WaitForNextImage(CameraHandle, timeout, &ptr, &id);
-		if(err == IS_CAPTURE_STATUS)
+		double interval = (host_time - LastHostTime)*1e-9/(info.LostBefore+1);
+		double mean_interval = MeanInterval.load(std::memory_order_relaxed);
+		if(delivered > 1)
 		{
-			std::cout<<"missed frame"<<std::endl;
-			if(ptr)
-				THROW_IF_ERROR(is_UnlockSeqBuf(CameraHandle, id, ptr));
+			double deviation = std::abs(interval - mean_interval)*1e6;
+			size_t bin = 0;
+			while(bin < JITTER_BINS-1 && deviation >= (1<<bin))
+				++bin;
+			Jitter[bin].fetch_add(1, std::memory_order_relaxed);
+			mean_interval += (interval - mean_interval)/16;
 		}
 		else
 		{
-			THROW_IF_ERROR(err);
-			ok=true;
+			mean_interval = interval;
 		}
+		MeanInterval.store(mean_interval, std::memory_order_relaxed);
 	}
-	if(ptr)
-		return SequencePtr[ptr];
-	else
-		return NULL;
+	LastHostTime = host_time;
+	
+	// host and device clocks are not synchronized : latency is measured
+	// relative to the smallest host/device offset seen so far
+	if(info.DeviceTimestamp)
+	{
+		int64_t offset = host_time - (int64_t)info.DeviceTimestamp*100;
+		if(offset < MinOffset)
+			MinOffset = offset;
+		uint64_t latency = offset - MinOffset;
+		LatencySum.fetch_add(latency, std::memory_order_relaxed);
+		if(latency > LatencyMax.load(std::memory_order_relaxed))
+			LatencyMax.store(latency, std::memory_order_relaxed);
+	}
+	
+	// the first frame after a software trigger, the ones of a burst and the
+	// frames of triggers ignored by a busy sensor are not told apart
+	int64_t trigger_time = PendingTrigger.exchange(0, std::memory_order_relaxed);
+	if(trigger_time && host_time > trigger_time)
+	{
+		uint64_t latency = host_time - trigger_time;
+		Triggered.fetch_add(1, std::memory_order_relaxed);
+		TriggerLatencySum.fetch_add(latency, std::memory_order_relaxed);
+		if(latency > TriggerLatencyMax.load(std::memory_order_relaxed))
+			TriggerLatencyMax.store(latency, std::memory_order_relaxed);
+	}
+	
+	BufferCount.store(info.BufferCount, std::memory_order_relaxed);
+	BuffersInUse.store(info.BuffersInUse, std::memory_order_relaxed);
+	if(info.BuffersInUse > MaxBuffersInUse.load(std::memory_order_relaxed))
+		MaxBuffersInUse.store(info.BuffersInUse, std::memory_order_relaxed);
 }
 
-void Camera::unlockFrame(ImageMemory *frame)
+void CaptureStatistics::frameMissed()
 {
-	THROW_IF_ERROR(is_UnlockSeqBuf(CameraHandle, IS_IGNORE_PARAMETER, frame->ptr()));
+	Missed.fetch_add(1, std::memory_order_relaxed);
 }
 
-HIDS Camera::handle()const
+void CaptureStatistics::frameUnlocked(const FrameInfo &info)
 {
-	return CameraHandle;
+	// the sensor needs a free buffer every frame interval, a frame held for
+	// longer than the other buffers last may have caused a drop
+	double mean_interval = MeanInterval.load(std::memory_order_relaxed);
+	if(info.BufferCount < 1 || mean_interval <= 0)
+		return;
+	double hold = std::chrono::duration<double>(std::chrono::steady_clock::now() - info.HostTimestamp).count();
+	if(hold > (info.BufferCount-1)*mean_interval)
+		UnlockedLate.fetch_add(1, std::memory_order_relaxed);
 }
 
-void Camera::updateTimingInfo(Camera::TimingUpdate update)
+void CaptureStatistics::Snapshot::dump(std::ostream &stream) const
 {
-	THROW_IF_ERROR(is_Exposure(CameraHandle, IS_EXPOSURE_CMD_GET_EXPOSURE, &Exposure, sizeof(Exposure)));
-	if(update == TIMING_EXPOSURE)
-		return;
-	
-	double drange[3];
-	THROW_IF_ERROR(is_Exposure(CameraHandle, IS_EXPOSURE_CMD_GET_EXPOSURE_RANGE, &drange, sizeof(drange)));
-	ExposureRange = Range<double>(drange[0], drange[1], drange[2]);
-	THROW_IF_ERROR(is_SetFrameRate(CameraHandle, IS_GET_FRAMERATE, &FrameRate));
-	if(update == TIMING_FRAME_RATE)
-		return;
-	
-	THROW_IF_ERROR(is_GetFrameTimeRange(CameraHandle, &drange[0], &drange[1], &drange[2]));
-	FrameTimeRange = Range<double>(drange[0], drange[1], drange[2]);
-	THROW_IF_ERROR(is_PixelClock(CameraHandle, IS_PIXELCLOCK_CMD_GET, &PixelClock, sizeof(PixelClock)));
-	if(update == TIMING_PIXEL_CLOCK)
-		return;
-	
-	UINT urange[3];
-	THROW_IF_ERROR(is_PixelClock(CameraHandle, IS_PIXELCLOCK_CMD_GET_RANGE, urange, sizeof(urange)));
-	PixelClockRange = Range<uint32_t>(urange[0], urange[1], urange[2]);
-	
-	UINT number;
-	THROW_IF_ERROR(is_PixelClock(CameraHandle, IS_PIXELCLOCK_CMD_GET_NUMBER, &number, sizeof(number)));
-	PixelClockList.resize(number);
-	THROW_IF_ERROR(is_PixelClock(CameraHandle, IS_PIXELCLOCK_CMD_GET_LIST, &(PixelClockList[0]), number*sizeof(PixelClockList[0])));
+	stream<<"{\"duration\": "<<Duration
+		<<", \"fps\": "<<FrameRate
+		<<", \"delivered\": "<<Delivered
+		<<", \"missed\": "<<Missed
+		<<", \"lost\": "<<Lost
+		<<", \"unlocked_late\": "<<UnlockedLate
+		<<", \"latency_mean\": "<<MeanLatency
+		<<", \"latency_max\": "<<MaxLatency
+		<<", \"triggered\": "<<Triggered
+		<<", \"trigger_latency_mean\": "<<MeanTriggerLatency
+		<<", \"trigger_latency_max\": "<<MaxTriggerLatency
+		<<", \"buffers\": "<<BufferCount
+		<<", \"buffers_in_use\": "<<BuffersInUse
+		<<", \"buffers_in_use_max\": "<<MaxBuffersInUse
+		<<", \"jitter_us_log2\": [";
+	for(size_t i=0; i<JITTER_BINS; ++i)
+		stream<<(i ? ", " : "")<<Jitter[i];
+	stream<<"]}";
+}
+
+FrameSource::~FrameSource()
+{}
+
+cv::Mat FrameSource::leasedView(Frame &&frame)
+{
+	// unlocked here until the Mat holds the lease
+	std::unique_ptr<Frame> lease(new Frame(std::move(frame)));
+	cv::Mat view = lease->memory()->view();
+	cv::UMatData *data = new cv::UMatData(frameLeaseAllocator());
+	data->data = data->origdata = view.data;
+	data->size = view.step[0]*view.rows;
+	data->refcount = 1;
+	data->handle = lease.get();
+	view.u = data;
+	lease.release();
+	return view;
+}
+
+
+Frame::Frame():
+	Owner(NULL), Memory(NULL), SequenceId(0), Info()
+{}
+
+Frame::Frame(const std::shared_ptr<std::atomic<FrameSource*> > &source, ImageMemory *memory, int sequence_id, const FrameInfo &info):
+	Owner(source), Memory(memory), SequenceId(sequence_id), Info(info)
+{}
+
+Frame::Frame(Frame &&frame):
+	Owner(std::move(frame.Owner)), Memory(frame.Memory), SequenceId(frame.SequenceId), Info(frame.Info)
+{
+	frame.Memory = NULL;
+}
+
+Frame::~Frame()
+{
+	// no exception from destructor, errors can only be seen with unlock()
+	if(valid())
+		Owner->load()->tryUnlock(*this);
+}
+
+Frame& Frame::operator=(Frame &&frame)
+{
+	if(this == &frame)
+		return *this;
+	if(valid())
+		Owner->load()->tryUnlock(*this);
+	Owner = std::move(frame.Owner);
+	Memory = frame.Memory;
+	SequenceId = frame.SequenceId;
+	Info = frame.Info;
+	frame.Memory = NULL;
+	return *this;
+}
+
+bool Frame::valid() const
+{
+	return Owner && Owner->load();
+}
+
+ImageMemory* Frame::memory() const
+{
+	return Memory;
+}
+
+int Frame::sequenceId() const
+{
+	return SequenceId;
+}
+
+const FrameInfo& Frame::info() const
+{
+	return Info;
+}
+
+void Frame::unlock()
+{
+	if(valid())
+		Owner->load()->unlockFrame(*this);
+}
+
+
+std::vector<CameraInfo> getCameraList()
+{
+	HIDS CameraHandle = 0;
+	
+	INT camera_number;
+	THROW_IF_ERROR(is_GetNumberOfCameras(&camera_number));
+
+	UEYE_CAMERA_LIST *camera_list = (UEYE_CAMERA_LIST*) new uint8_t[sizeof(DWORD)+camera_number*sizeof(UEYE_CAMERA_INFO)];
+	camera_list->dwCount = camera_number;
+	THROW_IF_ERROR(is_GetCameraList(camera_list));
+	
+	std::vector<CameraInfo> result;
+	for(int i=0; i<camera_number; ++i)
+	{
+		CameraInfo info;
+		info.CameraId = camera_list->uci[i].dwCameraID;
+		info.DeviceId = camera_list->uci[i].dwDeviceID;
+		info.SensorId = camera_list->uci[i].dwSensorID;
+		info.InUse = camera_list->uci[i].dwInUse;
+		info.SerialNumber = std::string(camera_list->uci[i].SerNo, 16);
+		info.SerialNumber.resize(info.SerialNumber.find('\0'));
+		info.ModelName = std::string(camera_list->uci[i].Model, 16);
+		info.ModelName.resize(info.ModelName.find('\0'));
+		info.FullModelName = std::string(camera_list->uci[i].FullModelName, 32);
+		info.FullModelName.resize(info.FullModelName.find('\0'));
+		info.CameraStatus = camera_list->uci[i].dwStatus;
+		result.push_back(info);
+	}
+	
+	delete[] camera_list;
+	return  result;
+}
+
+
+TimingTransaction::TimingTransaction(Camera &camera):
+	Cam(camera), PixelClockRequest(KEEP), FrameRateRequest(KEEP), ExposureRequest(KEEP), Settings()
+{}
+
+TimingTransaction& TimingTransaction::pixelClock(uint32_t pixel_clock)
+{
+	PixelClockRequest = VALUE;
+	Settings.PixelClock = pixel_clock;
+	return *this;
+}
+
+TimingTransaction& TimingTransaction::maxPixelClock()
+{
+	PixelClockRequest = MAXIMUM;
+	return *this;
+}
+
+TimingTransaction& TimingTransaction::frameRate(double frame_rate)
+{
+	FrameRateRequest = VALUE;
+	Settings.FrameRate = frame_rate;
+	return *this;
+}
+
+TimingTransaction& TimingTransaction::maxFrameRate()
+{
+	FrameRateRequest = MAXIMUM;
+	return *this;
+}
+
+TimingTransaction& TimingTransaction::exposure(double exposure)
+{
+	ExposureRequest = VALUE;
+	Settings.Exposure = exposure;
+	return *this;
+}
+
+TimingTransaction& TimingTransaction::minExposure()
+{
+	ExposureRequest = MINIMUM;
+	return *this;
+}
+
+TimingTransaction& TimingTransaction::maxExposure()
+{
+	ExposureRequest = MAXIMUM;
+	return *this;
+}
+
+TimingSettings TimingTransaction::commit()
+{
+	std::lock_guard<std::recursive_mutex> lock(Cam.TimingMutex);
+	// setters only invalidate the cached values, the ranges needed are
+	// queried once, after the change they depend on
+	if(PixelClockRequest == MAXIMUM)
+	{
+		std::vector<uint32_t> list = Cam.getPixelClockList();
+		Settings.PixelClock = list.empty() ? Cam.getPixelClockRange().max() : *std::max_element(list.begin(), list.end());
+	}
+	if(PixelClockRequest != KEEP && Settings.PixelClock != Cam.getPixelClock())
+		Cam.setPixelClock(Settings.PixelClock);
+	
+	if(FrameRateRequest == MAXIMUM)
+		Settings.FrameRate = 1.0/Cam.getFrameTimeRange().min();
+	if(FrameRateRequest != KEEP)
+		Cam.setFrameRate(Settings.FrameRate);
+	
+	if(ExposureRequest == MINIMUM)
+		Settings.Exposure = Cam.getExposureRange().min();
+	if(ExposureRequest == MAXIMUM)
+		Settings.Exposure = Cam.getExposureRange().max();
+	if(ExposureRequest != KEEP)
+		Cam.setExposure(Settings.Exposure);
+	
+	TimingSettings achieved;
+	achieved.PixelClock = Cam.getPixelClock();
+	achieved.FrameRate = Cam.getFrameRate();
+	achieved.Exposure = Cam.getExposure();
+	return achieved;
+}
+
+
+Camera::Camera(uint8_t camera_id):
+	CameraHandle(0), FastAOIPosition(-1), Binning(IS_BINNING_DISABLE), Subsampling(IS_SUBSAMPLING_DISABLE), SupportedBinning(-1), SupportedSubsampling(-1), ColorMode(0), TimingDirty(TIMING_ALL), PixelClock(0), FrameRate(0), Exposure(0), SdkCalls(0),
+	MemoryPool(*this), LeasedFrames(0), LeaseOwner(std::make_shared<std::atomic<FrameSource*> >(this)), AdaptiveSequence(false), GrowPending(false), GrowCount(0), SizeCheckLost(0), SizeCheckDelivered(0),
+	LastFrameNumber(0), LastFrameNumberValid(false)
+{
+	CameraHandle = camera_id;
+	THROW_IF_ERROR(is_InitCamera(&CameraHandle, 0));
+	THROW_IF_ERROR(is_GetSensorInfo(CameraHandle, &SensorInfo));
+	THROW_IF_ERROR(is_AOI(CameraHandle, IS_AOI_IMAGE_GET_AOI, &AOI, sizeof(AOI)));
+	AOIPositionIncrement.s32Width = AOIPositionIncrement.s32Height = 0;
+	AOISizeIncrement.s32Width = AOISizeIncrement.s32Height = 0;
+	ColorMode = is_SetColorMode(CameraHandle, IS_GET_COLOR_MODE);
+	Binning = is_SetBinning(CameraHandle, IS_GET_BINNING);
+	Subsampling = is_SetSubSampling(CameraHandle, IS_GET_SUBSAMPLING);
+}
+
+Camera::~Camera()
+{
+	// leases left are detached, they must not unlock into a closed camera
+	LeaseOwner->store(NULL);
+	// image memories are freed through the camera handle
+	MemoryPool.clear();
+	is_ExitCamera(CameraHandle);
+}
+
+std::string Camera::getSensorName()const
+{
+	return std::string(SensorInfo.strSensorName, SensorInfo.strSensorName+32);
+}
+
+int Camera::getSensorWidth() const
+{
+	return SensorInfo.nMaxWidth;
+}
+
+int Camera::getSensorHeight() const
+{
+	return SensorInfo.nMaxHeight;
+}
+
+uint8_t Camera::getSensorColorMode() const
+{
+	return SensorInfo.nColorMode;
+}
+
+uint8_t Camera::getSensorBayerPixel() const
+{
+	return SensorInfo.nUpperLeftBayerPixel;
+}
+
+int32_t Camera::getAOIPosX() const
+{
+	return AOI.s32X;
+}
+int32_t Camera::getAOIPosY() const
+{
+	return AOI.s32Y;
+}
+int32_t Camera::getAOIWidth() const
+{
+	return AOI.s32Width;
+}
+int32_t Camera::getAOIHeight() const
+{
+	return AOI.s32Height;
+}
+
+void Camera::setAOI(int32_t x, int32_t y, int32_t width, int32_t height)
+{
+	queryAOIIncrements();
+	IS_RECT aoi;
+	aoi.s32X = x - x % AOIPositionIncrement.s32Width;
+	aoi.s32Y = y - y % AOIPositionIncrement.s32Height;
+	aoi.s32Width = width - width % AOISizeIncrement.s32Width;
+	aoi.s32Height = height - height % AOISizeIncrement.s32Height;
+	// the pixel clock range does not depend on the AOI
+	changeImageFormat([this, &aoi]{return is_AOI(CameraHandle, IS_AOI_IMAGE_SET_AOI, &aoi, sizeof(aoi));},
+		aoi.s32Width, aoi.s32Height, ColorMode, TIMING_FRAME_TIME_RANGE | TIMING_FRAME_RATE | TIMING_EXPOSURE_RANGE | TIMING_EXPOSURE);
+}
+
+bool Camera::setAOIPosition(int32_t x, int32_t y)
+{
+	queryAOIIncrements();
+	IS_POINT_2D position;
+	position.s32X = x - x % AOIPositionIncrement.s32Width;
+	position.s32Y = y - y % AOIPositionIncrement.s32Height;
+	if(SequencePtr.empty())
+	{
+		CAMERA_CALL(is_AOI(CameraHandle, IS_AOI_IMAGE_SET_POS, &position, sizeof(position)));
+	}
+	else
+	{
+		if(FastAOIPosition < 0)
+		{
+			INT supported = 0;
+			++SdkCalls;
+			FastAOIPosition = is_AOI(CameraHandle, IS_AOI_IMAGE_SET_POS_FAST_SUPPORTED, &supported, sizeof(supported)) == IS_SUCCESS && supported;
+		}
+		if(!FastAOIPosition)
+		{
+			setAOI(position.s32X, position.s32Y, AOI.s32Width, AOI.s32Height);
+			return false;
+		}
+		CAMERA_CALL(is_AOI(CameraHandle, IS_AOI_IMAGE_SET_POS_FAST, &position, sizeof(position)));
+	}
+	AOI.s32X = position.s32X;
+	AOI.s32Y = position.s32Y;
+	return true;
+}
+
+INT Camera::getSupportedBinning() const
+{
+	if(SupportedBinning < 0)
+	{
+		++SdkCalls;
+		SupportedBinning = is_SetBinning(CameraHandle, IS_GET_SUPPORTED_BINNING);
+	}
+	return SupportedBinning;
+}
+INT Camera::getBinning() const
+{
+	return Binning;
+}
+void Camera::setBinning(INT mode)
+{
+	// -1 is what binningMode and subsamplingMode return for unsupported factors
+	if(mode < 0)
+		throw Exception(CameraHandle, IS_INVALID_PARAMETER, "setBinning : mode not supported");
+	if(mode == Binning)
+		return;
+	int32_t width = AOI.s32Width * decimationFactor(Binning, BINNING_HORIZONTAL) / decimationFactor(mode, BINNING_HORIZONTAL);
+	int32_t height = AOI.s32Height * decimationFactor(Binning, BINNING_VERTICAL) / decimationFactor(mode, BINNING_VERTICAL);
+	changeImageFormat([this, mode]{return is_SetBinning(CameraHandle, mode);}, width, height, ColorMode, TIMING_ALL);
+	Binning = mode;
+}
+
+INT Camera::getSupportedSubsampling() const
+{
+	if(SupportedSubsampling < 0)
+	{
+		++SdkCalls;
+		SupportedSubsampling = is_SetSubSampling(CameraHandle, IS_GET_SUPPORTED_SUBSAMPLING);
+	}
+	return SupportedSubsampling;
+}
+INT Camera::getSubsampling() const
+{
+	return Subsampling;
+}
+void Camera::setSubsampling(INT mode)
+{
+	// -1 is what binningMode and subsamplingMode return for unsupported factors
+	if(mode < 0)
+		throw Exception(CameraHandle, IS_INVALID_PARAMETER, "setSubsampling : mode not supported");
+	if(mode == Subsampling)
+		return;
+	int32_t width = AOI.s32Width * decimationFactor(Subsampling, SUBSAMPLING_HORIZONTAL) / decimationFactor(mode, SUBSAMPLING_HORIZONTAL);
+	int32_t height = AOI.s32Height * decimationFactor(Subsampling, SUBSAMPLING_VERTICAL) / decimationFactor(mode, SUBSAMPLING_VERTICAL);
+	changeImageFormat([this, mode]{return is_SetSubSampling(CameraHandle, mode);}, width, height, ColorMode, TIMING_ALL);
+	Subsampling = mode;
+}
+
+INT Camera::binningMode(int horizontal, int vertical) const
+{
+	INT mode = decimationMode(horizontal, BINNING_HORIZONTAL) | decimationMode(vertical, BINNING_VERTICAL);
+	return mode >= 0 && (mode & ~getSupportedBinning()) == 0 ? mode : -1;
+}
+INT Camera::subsamplingMode(int horizontal, int vertical) const
+{
+	INT mode = decimationMode(horizontal, SUBSAMPLING_HORIZONTAL) | decimationMode(vertical, SUBSAMPLING_VERTICAL);
+	return mode >= 0 && (mode & ~getSupportedSubsampling()) == 0 ? mode : -1;
+}
+
+int Camera::getDecimationX() const
+{
+	return decimationFactor(Binning, BINNING_HORIZONTAL) * decimationFactor(Subsampling, SUBSAMPLING_HORIZONTAL);
+}
+int Camera::getDecimationY() const
+{
+	return decimationFactor(Binning, BINNING_VERTICAL) * decimationFactor(Subsampling, SUBSAMPLING_VERTICAL);
+}
+
+void Camera::changeImageFormat(const std::function<INT()> &change, int32_t expected_width, int32_t expected_height, int32_t expected_color_mode, uint32_t timing_values)
+{
+	bool reallocatable = AdaptiveSequence && LeasedFrames.load() == 0;
+	if(!reallocatable && !sequenceFits(expected_width, expected_height, expected_color_mode))
+		throw Exception(CameraHandle, IS_INVALID_PARAMETER, "sequence buffers too small for the new image size");
+	
+	bool capturing = !SequencePtr.empty();
+	size_t sequence_length = SequencePtr.size();
+	IS_RECT previous_aoi = AOI;
+	int32_t previous_color_mode = ColorMode;
+	try
+	{
+		if(capturing)
+		{
+			CAMERA_CALL(is_StopLiveVideo(CameraHandle, IS_WAIT));
+			CAMERA_CALL(is_ExitImageQueue(CameraHandle));
+		}
+		CAMERA_CALL(change());
+		CAMERA_CALL(is_AOI(CameraHandle, IS_AOI_IMAGE_GET_AOI, &AOI, sizeof(AOI)));
+		{
+			std::lock_guard<std::recursive_mutex> lock(TimingMutex);
+			TimingDirty |= timing_values;
+			FrameTimeRanges.clear();
+		}
+		
+		if(!sequenceFits(AOI.s32Width, AOI.s32Height, ColorMode))
+		{
+			if(!reallocatable)
+				throw Exception(CameraHandle, IS_INVALID_PARAMETER, "sequence buffers too small for the image size read back");
+			CAMERA_CALL(is_ClearSequence(CameraHandle));
+			SequencePtr.clear();
+			for(size_t i=0; i<OwnedSequence.size(); ++i)
+				MemoryPool.release(std::move(OwnedSequence[i]));
+			OwnedSequence.clear();
+			for(size_t i=0; i<sequence_length; ++i)
+			{
+				OwnedSequence.push_back(MemoryPool.acquire());
+				CAMERA_CALL(addToSequence(OwnedSequence.back()));
+			}
+		}
+		for(std::map<char*, SequenceBuffer>::const_iterator it = SequencePtr.begin(); it != SequencePtr.end(); ++it)
+			it->second.Memory->setImageSize(AOI.s32Width, AOI.s32Height);
+		if(capturing)
+		{
+			LastFrameNumberValid = false;
+			CAMERA_CALL(is_InitImageQueue(CameraHandle, 0));
+			CAMERA_CALL(captureVideo());
+		}
+	}
+	catch(...)
+	{
+		restoreImageFormat(previous_aoi, previous_color_mode, capturing, sequence_length);
+		throw;
+	}
+}
+
+void Camera::restoreImageFormat(const IS_RECT &aoi, int32_t color_mode, bool capturing, size_t sequence_length)
+{
+	// best effort, the error that brought here is the one reported
+	SdkCalls += 5;
+	if(capturing)
+	{
+		is_StopLiveVideo(CameraHandle, IS_WAIT);
+		is_ExitImageQueue(CameraHandle);
+	}
+	is_SetColorMode(CameraHandle, color_mode);
+	ColorMode = color_mode;
+	// Binning and Subsampling are only updated once the change succeeded
+	is_SetBinning(CameraHandle, Binning);
+	is_SetSubSampling(CameraHandle, Subsampling);
+	IS_RECT previous_aoi = aoi;
+	is_AOI(CameraHandle, IS_AOI_IMAGE_SET_AOI, &previous_aoi, sizeof(previous_aoi));
+	is_AOI(CameraHandle, IS_AOI_IMAGE_GET_AOI, &AOI, sizeof(AOI));
+	{
+		std::lock_guard<std::recursive_mutex> lock(TimingMutex);
+		TimingDirty = TIMING_ALL;
+		FrameTimeRanges.clear();
+	}
+	if(!capturing)
+		return;
+	
+	INT err = IS_SUCCESS;
+	// the sequence may have been reallocated halfway
+	if(SequencePtr.size() != sequence_length || !sequenceFits(AOI.s32Width, AOI.s32Height, ColorMode))
+	{
+		if(AdaptiveSequence && LeasedFrames.load() == 0)
+		{
+			is_ClearSequence(CameraHandle);
+			SequencePtr.clear();
+			for(size_t i=0; i<OwnedSequence.size(); ++i)
+				MemoryPool.release(std::move(OwnedSequence[i]));
+			OwnedSequence.clear();
+			try
+			{
+				for(size_t i=0; err == IS_SUCCESS && i<sequence_length; ++i)
+				{
+					OwnedSequence.push_back(MemoryPool.acquire());
+					err = addToSequence(OwnedSequence.back());
+				}
+			}
+			catch(const std::exception&)
+			{
+				err = IS_NO_SUCCESS;
+			}
+		}
+		else
+		{
+			err = IS_INVALID_PARAMETER;
+		}
+	}
+	for(std::map<char*, SequenceBuffer>::const_iterator it = SequencePtr.begin(); it != SequencePtr.end(); ++it)
+		it->second.Memory->setImageSize(AOI.s32Width, AOI.s32Height);
+	LastFrameNumberValid = false;
+	if(err == IS_SUCCESS)
+		err = is_InitImageQueue(CameraHandle, 0);
+	if(err == IS_SUCCESS)
+		err = captureVideo();
+	if(err != IS_SUCCESS)
+	{
+		// left stopped rather than believed capturing ; the owned buffers stay
+		// with the camera, leases may point to them, until videoCaptureStop
+		is_StopLiveVideo(CameraHandle, IS_WAIT);
+		is_ExitImageQueue(CameraHandle);
+		is_ClearSequence(CameraHandle);
+		SequencePtr.clear();
+	}
+}
+
+bool Camera::sequenceFits(int32_t width, int32_t height, int32_t color_mode) const
+{
+	for(std::map<char*, SequenceBuffer>::const_iterator it = SequencePtr.begin(); it != SequencePtr.end(); ++it)
+	{
+		const ImageMemory &memory = *it->second.Memory;
+		if(memory.capacityWidth() < (uint32_t)width || memory.capacityHeight() < (uint32_t)height || memory.colorMode() != color_mode)
+			return false;
+	}
+	return true;
+}
+
+void Camera::queryAOIIncrements()
+{
+	if(AOIPositionIncrement.s32Width > 0)
+		return;
+	CAMERA_CALL(is_AOI(CameraHandle, IS_AOI_IMAGE_GET_POS_INC, &AOIPositionIncrement, sizeof(AOIPositionIncrement)));
+	CAMERA_CALL(is_AOI(CameraHandle, IS_AOI_IMAGE_GET_SIZE_INC, &AOISizeIncrement, sizeof(AOISizeIncrement)));
+}
+
+int32_t Camera::getColorMode() const
+{
+	return ColorMode;
+}
+void Camera::setColorMode(int32_t color_mode)
+{
+	if(color_mode == ColorMode)
+		return;
+	changeImageFormat([this, color_mode]{
+		INT err = is_SetColorMode(CameraHandle, color_mode);
+		if(err == IS_SUCCESS)
+			ColorMode = color_mode;
+		return err;
+	}, AOI.s32Width, AOI.s32Height, color_mode, TIMING_FRAME_TIME_RANGE | TIMING_FRAME_RATE | TIMING_EXPOSURE_RANGE | TIMING_EXPOSURE);
+}
+
+Range<uint32_t> Camera::getPixelClockRange() const
+{
+	std::lock_guard<std::recursive_mutex> lock(TimingMutex);
+	refreshTiming(TIMING_PIXEL_CLOCK_RANGE);
+	return PixelClockRange;
+}
+Range<double> Camera::getFrameTimeRange() const
+{
+	std::lock_guard<std::recursive_mutex> lock(TimingMutex);
+	refreshTiming(TIMING_FRAME_TIME_RANGE);
+	return FrameTimeRange;
+}
+Range<double> Camera::getExposureRange() const
+{
+	std::lock_guard<std::recursive_mutex> lock(TimingMutex);
+	refreshTiming(TIMING_EXPOSURE_RANGE);
+	return ExposureRange;
+}
+std::vector<uint32_t> Camera::getPixelClockList()const
+{
+	std::lock_guard<std::recursive_mutex> lock(TimingMutex);
+	refreshTiming(TIMING_PIXEL_CLOCK_RANGE);
+	return PixelClockList;
+}
+uint32_t Camera::getPixelClock() const
+{
+	std::lock_guard<std::recursive_mutex> lock(TimingMutex);
+	refreshTiming(TIMING_PIXEL_CLOCK);
+	return PixelClock;
+}
+double Camera::getFrameRate() const
+{
+	std::lock_guard<std::recursive_mutex> lock(TimingMutex);
+	refreshTiming(TIMING_FRAME_RATE);
+	return FrameRate;
+}
+double Camera::getExposure() const
+{
+	std::lock_guard<std::recursive_mutex> lock(TimingMutex);
+	refreshTiming(TIMING_EXPOSURE);
+	return Exposure;
+}
+void Camera::setPixelClock(uint32_t pixel_clock)
+{
+	std::lock_guard<std::recursive_mutex> lock(TimingMutex);
+	CAMERA_CALL(is_PixelClock(CameraHandle, IS_PIXELCLOCK_CMD_SET, &pixel_clock, sizeof(pixel_clock)));
+	PixelClock = pixel_clock;
+	// the frame rate and exposure may have been clamped to the new ranges
+	TimingDirty = (TimingDirty & ~TIMING_PIXEL_CLOCK) | TIMING_FRAME_TIME_RANGE | TIMING_FRAME_RATE | TIMING_EXPOSURE_RANGE | TIMING_EXPOSURE;
+}
+void Camera::setFrameRate(double frame_rate)
+{
+	std::lock_guard<std::recursive_mutex> lock(TimingMutex);
+	// the SDK returns the frame rate actually set
+	CAMERA_CALL(is_SetFrameRate(CameraHandle, frame_rate, &FrameRate));
+	TimingDirty = (TimingDirty & ~TIMING_FRAME_RATE) | TIMING_EXPOSURE_RANGE | TIMING_EXPOSURE;
+}
+void Camera::setExposure(double exposure)
+{
+	std::lock_guard<std::recursive_mutex> lock(TimingMutex);
+	CAMERA_CALL(is_Exposure(CameraHandle, IS_EXPOSURE_CMD_SET_EXPOSURE, &exposure, sizeof(exposure)));
+	TimingDirty |= TIMING_EXPOSURE;
+}
+void Camera::invalidateTiming()
+{
+	std::lock_guard<std::recursive_mutex> lock(TimingMutex);
+	TimingDirty = TIMING_ALL;
+	FrameTimeRanges.clear();
+}
+uint64_t Camera::getSdkCallCount() const
+{
+	return SdkCalls;
+}
+TimingTransaction Camera::timing()
+{
+	return TimingTransaction(*this);
+}
+
+TriggerMode Camera::getTriggerMode() const
+{
+	INT mode;
+	CAMERA_GET(mode, is_SetExternalTrigger(CameraHandle, IS_GET_EXTERNALTRIGGER));
+	for(size_t i=0; i<sizeof(TRIGGER_MODES)/sizeof(TRIGGER_MODES[0]); ++i)
+	{
+		if(TRIGGER_MODES[i] == mode)
+			return (TriggerMode)i;
+	}
+	// set outside of setTriggerMode, TriggerMode has no value for it
+	throw Exception(CameraHandle, IS_NOT_SUPPORTED, "getTriggerMode : trigger mode not known");
+}
+
+void Camera::setTriggerMode(TriggerMode mode)
+{
+	// the image queue and its buffers are kept, only the sensor is stopped
+	bool capturing = !SequencePtr.empty();
+	if(capturing)
+		CAMERA_CALL(is_StopLiveVideo(CameraHandle, IS_WAIT));
+	CAMERA_CALL(is_SetExternalTrigger(CameraHandle, TRIGGER_MODES[mode]));
+	if(capturing)
+		CAMERA_CALL(captureVideo());
+}
+
+Range<uint32_t> Camera::getTriggerDelayRange() const
+{
+	INT min, max, step;
+	CAMERA_GET(min, is_SetTriggerDelay(CameraHandle, IS_GET_MIN_TRIGGER_DELAY));
+	CAMERA_GET(max, is_SetTriggerDelay(CameraHandle, IS_GET_MAX_TRIGGER_DELAY));
+	CAMERA_GET(step, is_SetTriggerDelay(CameraHandle, IS_GET_TRIGGER_DELAY_GRANULARITY));
+	return Range<uint32_t>(min, max, step);
+}
+
+uint32_t Camera::getTriggerDelay() const
+{
+	INT delay;
+	CAMERA_GET(delay, is_SetTriggerDelay(CameraHandle, IS_GET_TRIGGER_DELAY));
+	return delay;
+}
+
+void Camera::setTriggerDelay(uint32_t delay)
+{
+	Range<uint32_t> range = getTriggerDelayRange();
+	delay = std::min(std::max(delay, range.min()), range.max());
+	if(range.step() > 1)
+		delay = range.min() + (delay - range.min())/range.step()*range.step();
+	CAMERA_CALL(is_SetTriggerDelay(CameraHandle, delay));
+}
+
+Range<uint32_t> Camera::getTriggerBurstRange() const
+{
+	UINT supported = 0;
+	if(is_Trigger(CameraHandle, IS_TRIGGER_CMD_GET_BURST_SIZE_SUPPORTED, &supported, sizeof(supported)) != IS_SUCCESS || !supported)
+		return Range<uint32_t>(1, 1, 1);
+	RANGE_OF_VALUES_U32 range;
+	CAMERA_CALL(is_Trigger(CameraHandle, IS_TRIGGER_CMD_GET_BURST_SIZE_RANGE, &range, sizeof(range)));
+	return Range<uint32_t>(range.u32Minimum, range.u32Maximum, range.u32Increment);
+}
+
+uint32_t Camera::getTriggerBurst() const
+{
+	UINT frames = 1;
+	if(is_Trigger(CameraHandle, IS_TRIGGER_CMD_GET_BURST_SIZE, &frames, sizeof(frames)) != IS_SUCCESS)
+		return 1;
+	return frames;
+}
+
+void Camera::setTriggerBurst(uint32_t frames)
+{
+	Range<uint32_t> range = getTriggerBurstRange();
+	UINT burst = std::min(std::max(frames, range.min()), range.max());
+	if(range.max() == 1)
+		return;
+	CAMERA_CALL(is_Trigger(CameraHandle, IS_TRIGGER_CMD_SET_BURST_SIZE, &burst, sizeof(burst)));
+}
+
+INT Camera::tryForceTrigger()
+{
+	// stamped before the call, which returns once the trigger is sent
+	Statistics.triggerForced(std::chrono::steady_clock::now());
+	return is_ForceTrigger(CameraHandle);
+}
+
+void Camera::forceTrigger()
+{
+	THROW_IF_ERROR(tryForceTrigger());
+}
+
+
+void Camera::imageCapture(ImageMemory &image_memory)
+{
+	THROW_IF_ERROR(tryCapture(image_memory));
+}
+
+void Camera::videoCaptureStart(std::vector<ImageMemory> &buffer)
+{
+	for(size_t i=0; i<buffer.size(); ++i)
+	{
+		THROW_IF_ERROR(addToSequence(buffer[i]));
+	}
+	LastFrameNumberValid = false;
+	Statistics.reset();
+	THROW_IF_ERROR(is_InitImageQueue(CameraHandle, 0));
+	THROW_IF_ERROR(captureVideo());
+}
+
+void Camera::videoCaptureStart(const SequenceSizing &sizing)
+{
+	// the rollback below would clear the sequence in use
+	if(!SequencePtr.empty())
+		throw Exception(CameraHandle, IS_CAPTURE_RUNNING, "videoCaptureStart with a sequence already set");
+	size_t length = sequenceLength(sizing);
+	try
+	{
+		for(size_t i=0; i<length; ++i)
+		{
+			OwnedSequence.push_back(MemoryPool.acquire());
+			THROW_IF_ERROR(addToSequence(OwnedSequence.back()));
+		}
+		Sizing = sizing;
+		AdaptiveSequence = true;
+		GrowPending = false;
+		GrowCount = 0;
+		NextSizeCheck = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+		SizeCheckLost = 0;
+		SizeCheckDelivered = 0;
+		LastFrameNumberValid = false;
+		Statistics.reset();
+		THROW_IF_ERROR(is_InitImageQueue(CameraHandle, 0));
+		THROW_IF_ERROR(captureVideo());
+	}
+	catch(...)
+	{
+		// the buffers go back to the pool, unregistered, for the next start
+		is_ExitImageQueue(CameraHandle);
+		is_ClearSequence(CameraHandle);
+		SequencePtr.clear();
+		for(size_t i=0; i<OwnedSequence.size(); ++i)
+			MemoryPool.release(std::move(OwnedSequence[i]));
+		OwnedSequence.clear();
+		AdaptiveSequence = false;
+		throw;
+	}
+}
+
+void Camera::videoCaptureStop()
+{
+	if(LeasedFrames.load() != 0)
+		throw Exception(CameraHandle, IS_NO_SUCCESS, "videoCaptureStop with frames still leased");
+	THROW_IF_ERROR(is_StopLiveVideo(CameraHandle, IS_WAIT));
+	THROW_IF_ERROR(is_ExitImageQueue(CameraHandle));
+	THROW_IF_ERROR(is_ClearSequence(CameraHandle));
+	SequencePtr.clear();
+	if(AdaptiveSequence)
+	{
+		for(size_t i=0; i<OwnedSequence.size(); ++i)
+			MemoryPool.release(std::move(OwnedSequence[i]));
+		OwnedSequence.clear();
+		AdaptiveSequence = false;
+	}
+}
+
+size_t Camera::getSequenceLength() const
+{
+	return SequencePtr.size();
+}
+
+uint64_t Camera::getSequenceGrowCount() const
+{
+	return GrowCount;
+}
+
+size_t Camera::sequenceLength(const SequenceSizing &sizing) const
+{
+	// one buffer being filled and one waiting in the queue, besides the held ones
+	size_t length = (size_t)std::ceil(sizing.HoldTime*getFrameRate()) + 2;
+	length = std::min(length, sequenceLimit(sizing));
+	return std::max(length, sizing.MinBuffers);
+}
+
+size_t Camera::sequenceLimit(const SequenceSizing &sizing) const
+{
+	size_t line = (lineBytes(getAOIWidth(), ColorMode) + 3) & ~(size_t)3;
+	size_t memory_limit = sizing.MemoryLimit / (line*getAOIHeight());
+	return std::min(sizing.MaxBuffers, memory_limit);
+}
+
+INT Camera::addToSequence(ImageMemory &memory)
+{
+	INT err = is_AddToSequence(CameraHandle, memory.ptr(), memory.id());
+	if(err != IS_SUCCESS)
+		return err;
+	// 1-based position in the sequence
+	SequenceBuffer sequence_buffer = {&memory, (int)SequencePtr.size()+1, FrameInfo()};
+	SequencePtr[memory.ptr()] = sequence_buffer;
+	return IS_SUCCESS;
+}
+
+INT Camera::captureVideo()
+{
+	++SdkCalls;
+	INT mode = is_SetExternalTrigger(CameraHandle, IS_GET_EXTERNALTRIGGER);
+	return is_CaptureVideo(CameraHandle, mode == IS_SET_TRIGGER_OFF ? IS_WAIT : IS_DONT_WAIT);
+}
+
+INT Camera::growSequence(Frame &frame)
+{
+	GrowPending = false;
+	size_t length = OwnedSequence.size();
+	size_t target = std::min(std::max(length + 1, length*3/2), sequenceLimit(Sizing));
+	if(target <= length)
+		return IS_SUCCESS;
+	
+	// allocate before stopping, the growth is given up if that fails
+	std::vector<ImageMemory> buffers;
+	try
+	{
+		MemoryPool.acquire(buffers, target - length);
+	}
+	catch(const std::exception&)
+	{
+		return IS_SUCCESS;
+	}
+	tryUnlock(frame);
+	INT err = is_StopLiveVideo(CameraHandle, IS_WAIT);
+	if(err == IS_SUCCESS)
+		err = is_ExitImageQueue(CameraHandle);
+	for(size_t i=0; err == IS_SUCCESS && i<buffers.size(); ++i)
+	{
+		OwnedSequence.push_back(std::move(buffers[i]));
+		err = addToSequence(OwnedSequence.back());
+	}
+	if(err == IS_SUCCESS)
+		err = is_InitImageQueue(CameraHandle, 0);
+	if(err == IS_SUCCESS)
+		err = captureVideo();
+	// frames not captured during the restart are not lost
+	LastFrameNumberValid = false;
+	++GrowCount;
+	return err;
+}
+
+void Camera::checkSequenceSize(std::chrono::steady_clock::time_point now)
+{
+	uint64_t lost = Statistics.lost();
+	uint64_t delivered = Statistics.delivered();
+	uint64_t window_lost = lost - SizeCheckLost;
+	uint64_t window_delivered = delivered - SizeCheckDelivered;
+	if(window_lost >= Sizing.GrowLostFrames && window_lost*4 < window_delivered && OwnedSequence.size() < sequenceLimit(Sizing))
+		GrowPending = true;
+	SizeCheckLost = lost;
+	SizeCheckDelivered = delivered;
+	NextSizeCheck = now + std::chrono::seconds(1);
+}
+
+INT Camera::tryWaitNextFrame(Frame &frame, uint32_t timeout)
+{
+	if(GrowPending && LeasedFrames.load() == (frame.Owner == LeaseOwner ? 1 : 0))
+	{
+		INT err = growSequence(frame);
+		if(err != IS_SUCCESS)
+			return err;
+	}
+	char *ptr = NULL;
+	INT id;
+	INT err = is_WaitForNextImage(CameraHandle, timeout, &ptr, &id);
+	std::chrono::steady_clock::time_point host_timestamp = std::chrono::steady_clock::now();
+	if(err != IS_SUCCESS && err != IS_CAPTURE_STATUS)
+		return err;
+	std::map<char*, SequenceBuffer>::const_iterator it = SequencePtr.find(ptr);
+	if(it == SequencePtr.end())
+		return IS_INVALID_MEMORY_POINTER;
+	if(err == IS_CAPTURE_STATUS)
+	{
+		Statistics.frameMissed();
+		is_UnlockSeqBuf(CameraHandle, it->second.Id, ptr);
+		return err;
+	}
+	
+	FrameInfo info = FrameInfo();
+	info.HostTimestamp = host_timestamp;
+	UEYEIMAGEINFO image_info;
+	if(is_GetImageInfo(CameraHandle, id, &image_info, sizeof(image_info)) == IS_SUCCESS)
+	{
+		info.DeviceTimestamp = image_info.u64TimestampDevice;
+		info.FrameNumber = image_info.u64FrameNumber;
+		info.Width = image_info.dwImageWidth;
+		info.Height = image_info.dwImageHeight;
+		info.BufferCount = image_info.dwImageBuffers;
+		info.BuffersInUse = image_info.dwImageBuffersInUse;
+		if(LastFrameNumberValid && info.FrameNumber > LastFrameNumber+1)
+		{
+			info.LostBefore = info.FrameNumber - LastFrameNumber - 1;
+		}
+		LastFrameNumber = info.FrameNumber;
+		LastFrameNumberValid = true;
+	}
+	Statistics.frameDelivered(info);
+	if(AdaptiveSequence && Sizing.Grow && host_timestamp >= NextSizeCheck)
+		checkSequenceSize(host_timestamp);
+	++LeasedFrames;
+	frame = Frame(LeaseOwner, it->second.Memory, it->second.Id, info);
+	return IS_SUCCESS;
+}
+
+INT Camera::tryUnlock(Frame &frame)
+{
+	if(!frame.Owner)
+		return IS_SUCCESS;
+	frame.Owner.reset();
+	--LeasedFrames;
+	Statistics.frameUnlocked(frame.Info);
+	return is_UnlockSeqBuf(CameraHandle, frame.SequenceId, frame.Memory->ptr());
+}
+
+INT Camera::tryCapture(ImageMemory &image_memory)
+{
+	INT err = is_SetImageMem(CameraHandle, image_memory.ptr(), image_memory.id());
+	if(err != IS_SUCCESS)
+		return err;
+	return is_FreezeVideo(CameraHandle, IS_WAIT);
+}
+
+void Camera::enableFrameEvent()
+{
+	THROW_IF_ERROR(is_EnableEvent(CameraHandle, IS_SET_EVENT_FRAME));
+}
+
+void Camera::disableFrameEvent()
+{
+	THROW_IF_ERROR(is_DisableEvent(CameraHandle, IS_SET_EVENT_FRAME));
+}
+
+INT Camera::tryWaitFrameEvent(uint32_t timeout)
+{
+	return is_WaitEvent(CameraHandle, IS_SET_EVENT_FRAME, timeout);
+}
+
+uint64_t Camera::getMissedFrameCount() const
+{
+	return Statistics.missed();
+}
+
+uint64_t Camera::getLostFrameCount() const
+{
+	return Statistics.lost();
+}
+
+const CaptureStatistics& Camera::getStatistics() const
+{
+	return Statistics;
+}
+
+ImageMemoryPool& Camera::memoryPool()
+{
+	return MemoryPool;
+}
+
+Frame Camera::nextFrame(uint32_t timeout)
+{
+	Frame frame;
+	INT err;
+	do
+	{
+		err = tryWaitNextFrame(frame, timeout);
+	}
+	while(err == IS_CAPTURE_STATUS);
+	if(err != IS_SUCCESS)
+		throw Exception(CameraHandle, err, "is_WaitForNextImage");
+	return frame;
+}
+
+void Camera::unlockFrame(Frame &frame)
+{
+	THROW_IF_ERROR(tryUnlock(frame));
+}
+
+ImageMemory* Camera::waitNextFrame(uint32_t timeout)
+{
+	Frame frame = nextFrame(timeout);
+	// ownership of the lock goes to the caller, who unlocks with unlockFrame ;
+	// the buffer is not in another frame until then
+	SequencePtr[frame.Memory->ptr()].Info = frame.Info;
+	frame.Owner.reset();
+	return frame.Memory;
+}
+
+void Camera::unlockFrame(ImageMemory *frame)
+{
+	std::map<char*, SequenceBuffer>::const_iterator it = SequencePtr.find(frame->ptr());
+	int id = IS_IGNORE_PARAMETER;
+	if(it != SequencePtr.end())
+	{
+		id = it->second.Id;
+		Statistics.frameUnlocked(it->second.Info);
+	}
+	--LeasedFrames;
+	THROW_IF_ERROR(is_UnlockSeqBuf(CameraHandle, id, frame->ptr()));
+}
+
+cv::Mat Camera::waitNextView(uint32_t timeout)
+{
+	return leasedView(nextFrame(timeout));
+}
+
+HIDS Camera::handle()const
+{
+	return CameraHandle;
+}
+
+void Camera::refreshTiming(uint32_t values) const
+{
+	values &= TimingDirty;
+	if(values & TIMING_PIXEL_CLOCK)
+	{
+		CAMERA_CALL(is_PixelClock(CameraHandle, IS_PIXELCLOCK_CMD_GET, &PixelClock, sizeof(PixelClock)));
+	}
+	if(values & TIMING_PIXEL_CLOCK_RANGE)
+	{
+		UINT urange[3];
+		CAMERA_CALL(is_PixelClock(CameraHandle, IS_PIXELCLOCK_CMD_GET_RANGE, urange, sizeof(urange)));
+		PixelClockRange = Range<uint32_t>(urange[0], urange[1], urange[2]);
+		UINT number;
+		CAMERA_CALL(is_PixelClock(CameraHandle, IS_PIXELCLOCK_CMD_GET_NUMBER, &number, sizeof(number)));
+		PixelClockList.resize(number);
+		CAMERA_CALL(is_PixelClock(CameraHandle, IS_PIXELCLOCK_CMD_GET_LIST, &(PixelClockList[0]), number*sizeof(PixelClockList[0])));
+	}
+	if(values & TIMING_FRAME_TIME_RANGE)
+	{
+		// only depends on the pixel clock for a given AOI
+		refreshTiming(TIMING_PIXEL_CLOCK);
+		std::map<uint32_t, Range<double> >::const_iterator it = FrameTimeRanges.find(PixelClock);
+		if(it != FrameTimeRanges.end())
+		{
+			FrameTimeRange = it->second;
+		}
+		else
+		{
+			double drange[3];
+			CAMERA_CALL(is_GetFrameTimeRange(CameraHandle, &drange[0], &drange[1], &drange[2]));
+			FrameTimeRange = Range<double>(drange[0], drange[1], drange[2]);
+			FrameTimeRanges[PixelClock] = FrameTimeRange;
+		}
+	}
+	if(values & TIMING_FRAME_RATE)
+	{
+		CAMERA_CALL(is_SetFrameRate(CameraHandle, IS_GET_FRAMERATE, &FrameRate));
+	}
+	if(values & TIMING_EXPOSURE_RANGE)
+	{
+		double drange[3];
+		CAMERA_CALL(is_Exposure(CameraHandle, IS_EXPOSURE_CMD_GET_EXPOSURE_RANGE, &drange, sizeof(drange)));
+		ExposureRange = Range<double>(drange[0], drange[1], drange[2]);
+	}
+	if(values & TIMING_EXPOSURE)
+	{
+		CAMERA_CALL(is_Exposure(CameraHandle, IS_EXPOSURE_CMD_GET_EXPOSURE, &Exposure, sizeof(Exposure)));
+	}
+	TimingDirty &= ~values;
 }
 
 }
@@ -4,8 +4,18 @@
 extern "C"{
 #include <ueye.h>
 }
+#include "ueye_types.hpp"
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <exception>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include <opencv2/core/core.hpp>
 
@@ -46,37 +56,284 @@ class Range
 
 class Camera;
 
+// targets of ImageMemory::copyToMat, 8 bit per channel except MAT_NATIVE
+enum MatFormat
+{
+	MAT_NATIVE, // the memory layout, as given by view()
+	MAT_BGR,
+	MAT_GRAY,
+	MAT_BGRA // opaque alpha
+};
+
+// Source of caller-allocated image memory, registered with the SDK through
+// is_SetAllocatedImageMem. Implementations are in ueye_allocator.hpp.
+class ImageAllocator
+{
+	public:
+	virtual ~ImageAllocator();
+	// throws std::bad_alloc when no memory is available
+	virtual void* allocate(size_t size) = 0;
+	virtual void deallocate(void *ptr, size_t size) = 0;
+};
+
 class ImageMemory
 {
 	public:
 	
 	ImageMemory(const Camera& camera, uint32_t width=0, uint32_t height=0, int32_t color_mode=0);
+	// the allocator must outlive the memory and its copies
+	ImageMemory(const Camera& camera, ImageAllocator &allocator, uint32_t width=0, uint32_t height=0, int32_t color_mode=0);
+	// memory of the caller, neither registered with the SDK nor freed, for
+	// frames that do not come from a camera (Playback) ; it can not be copied
+	ImageMemory(char *data, uint32_t width, uint32_t height, int32_t pitch, int32_t color_mode);
 	explicit ImageMemory(const ImageMemory &memory);
+	// noexcept, so that std::vector moves rather than copies on reallocation
+	ImageMemory(ImageMemory &&memory) noexcept;
 	~ImageMemory();
 	ImageMemory& operator=(const ImageMemory &memory);
+	ImageMemory& operator=(ImageMemory &&memory) noexcept;
 	
 	char* ptr();
 	int id() const;
 	
+	// size of the image in the memory, up to the allocated capacity
 	uint32_t width() const;
 	uint32_t height() const;
+	uint32_t capacityWidth() const;
+	uint32_t capacityHeight() const;
+	// false when the memory is too small for the new size
+	bool setImageSize(uint32_t width, uint32_t height);
+	int32_t pitch() const;
+	int32_t colorMode() const;
+	// as given to the SDK, 10 and 12 for packed sources
+	uint8_t bitsPerPixel() const;
+	ImageAllocator* allocator() const;
 	
+	// packed sources give their bytes, to unpack with ueye::Unpacker
 	void copyToMat(cv::Mat &mat)const;
+	// converted during the copy, see ueye::FormatConverter (ueye_convert.cpp)
+	void copyToMat(cv::Mat &mat, MatFormat format)const;
+	// planar formats give their planes one after the other
+	cv::Mat view()const;
 	
 	private:
 	
+	void init(const Camera& camera, uint32_t width, uint32_t height, int32_t color_mode);
 	void create(HIDS camera_handle, uint32_t width, uint32_t height, int32_t color_mode);
 	void release();
 	
-	HIDS CameraHandle;
+	HIDS CameraHandle; // 0 for memory of the caller
+	ImageAllocator *Allocator; // NULL when allocated by is_AllocImageMem
+	size_t AllocatedSize;
 	char *MemoryPtr;
 	int32_t MemoryId;
 	uint32_t Width;
 	uint32_t Height;
+	uint32_t CapacityWidth;
+	uint32_t CapacityHeight;
+	int32_t Pitch;
 	uint8_t BitDepth;
 	int32_t ColorMode;
 };
 
+// Idle image memories of one camera, recycled by format (width, height,
+// color mode) so that a sequence can be rebuilt after videoCaptureStop without
+// any allocation. Owned by the Camera, emptied before the camera is closed.
+class ImageMemoryPool
+{
+	public:
+	explicit ImageMemoryPool(const Camera &camera);
+	
+	// memories are allocated from allocator, or by the SDK when NULL ; idle
+	// memories from the previous allocator are freed
+	void setAllocator(ImageAllocator *allocator);
+	
+	// width, height or color_mode 0 stand for the current camera setting
+	ImageMemory acquire(uint32_t width=0, uint32_t height=0, int32_t color_mode=0);
+	// appends count memories to buffer
+	void acquire(std::vector<ImageMemory> &buffer, size_t count, uint32_t width=0, uint32_t height=0, int32_t color_mode=0);
+	void release(ImageMemory &&memory);
+	// gives back and clears all memories of buffer
+	void release(std::vector<ImageMemory> &buffer);
+	// frees the idle memories
+	void clear();
+	
+	size_t idleCount() const;
+	uint64_t allocationCount() const;
+	
+	private:
+	ImageMemoryPool(const ImageMemoryPool&); // non construction-copyable
+	ImageMemoryPool& operator=(const ImageMemoryPool&); // non copyable
+	
+	struct Format
+	{
+		uint32_t Width;
+		uint32_t Height;
+		int32_t ColorMode;
+		bool operator<(const Format &format) const;
+	};
+	
+	Format format(uint32_t width, uint32_t height, int32_t color_mode) const;
+	
+	const Camera &Cam;
+	ImageAllocator *Allocator;
+	std::map<Format, std::vector<ImageMemory> > Idle;
+	uint64_t Allocations;
+};
+
+// Sizing of a sequence owned by the camera, see Camera::videoCaptureStart
+struct SequenceSizing
+{
+	SequenceSizing();
+	
+	double HoldTime; // longest time consumers keep frames locked, in seconds
+	size_t MinBuffers;
+	size_t MaxBuffers;
+	size_t MemoryLimit; // bytes, for the whole sequence
+	// grow the sequence when at least GrowLostFrames frames are lost within a
+	// second, while consumers keep up on average (less than a fifth of the
+	// frames lost) : more buffers do not help consumers slower than the camera
+	bool Grow;
+	uint64_t GrowLostFrames;
+};
+
+// Capture telemetry of a camera stream. Counters are updated by the capture
+// thread with relaxed atomics, so a snapshot can be taken from any thread
+// without stalling capture; fields of a snapshot are not mutually consistent.
+class CaptureStatistics
+{
+	public:
+	enum{JITTER_BINS = 16};
+	
+	struct Snapshot
+	{
+		double Duration; // seconds since reset
+		double FrameRate; // delivered frames per second, averaged over the last frames
+		uint64_t Delivered;
+		uint64_t Missed; // failed transfers
+		uint64_t Lost; // gaps in frame numbers, including missed frames
+		uint64_t UnlockedLate; // frames held long enough to starve the sequence
+		double MeanLatency; // seconds from sensor to consumer, above the fastest frame seen
+		double MaxLatency;
+		uint64_t Triggered; // frames following a software trigger
+		double MeanTriggerLatency; // seconds from the software trigger to the consumer
+		double MaxTriggerLatency;
+		uint32_t BufferCount;
+		uint32_t BuffersInUse;
+		uint32_t MaxBuffersInUse;
+		uint64_t Jitter[JITTER_BINS]; // deviation from the mean frame interval, bin i is < 2^i us
+		
+		void dump(std::ostream &stream) const; // as a JSON object
+	};
+	
+	CaptureStatistics();
+	
+	void reset();
+	Snapshot snapshot() const;
+	uint64_t delivered() const;
+	uint64_t missed() const;
+	uint64_t lost() const;
+	
+	void triggerForced(std::chrono::steady_clock::time_point time);
+	void frameDelivered(const FrameInfo &info);
+	void frameMissed();
+	void frameUnlocked(const FrameInfo &info);
+	
+	private:
+	CaptureStatistics(const CaptureStatistics&); // non construction-copyable
+	CaptureStatistics& operator=(const CaptureStatistics&); // non copyable
+	
+	std::atomic<int64_t> ResetTime;
+	std::atomic<uint64_t> Delivered;
+	std::atomic<uint64_t> Missed;
+	std::atomic<uint64_t> Lost;
+	std::atomic<uint64_t> UnlockedLate;
+	std::atomic<double> MeanInterval;
+	std::atomic<uint64_t> LatencySum;
+	std::atomic<uint64_t> LatencyMax;
+	// host time of the last software trigger not followed by a frame yet, 0 for none
+	std::atomic<int64_t> PendingTrigger;
+	std::atomic<uint64_t> Triggered;
+	std::atomic<uint64_t> TriggerLatencySum;
+	std::atomic<uint64_t> TriggerLatencyMax;
+	std::atomic<uint32_t> BufferCount;
+	std::atomic<uint32_t> BuffersInUse;
+	std::atomic<uint32_t> MaxBuffersInUse;
+	std::atomic<uint64_t> Jitter[JITTER_BINS];
+	
+	// only used by the capture thread
+	int64_t LastHostTime;
+	int64_t MinOffset;
+};
+
+class Frame;
+
+// Producer of frame leases : a capturing Camera, or a Playback of a recording
+// (ueye_playback.hpp). CaptureDispatcher only goes through this interface, so
+// that recorded frames follow the path of live ones.
+class FrameSource
+{
+	public:
+	virtual ~FrameSource();
+	
+	// IS_SUCCESS, IS_TIMED_OUT, IS_CAPTURE_STATUS when a frame was missed, or
+	// another error ; no allocation
+	virtual INT tryWaitNextFrame(Frame &frame, uint32_t timeout=1000) = 0;
+	virtual INT tryUnlock(Frame &frame) = 0;
+	virtual void unlockFrame(Frame &frame) = 0;
+	// signaled when a frame can be taken ; tryWaitFrameEvent returns
+	// IS_SUCCESS or IS_TIMED_OUT
+	virtual void enableFrameEvent() = 0;
+	virtual void disableFrameEvent() = 0;
+	virtual INT tryWaitFrameEvent(uint32_t timeout) = 0;
+	
+	protected:
+	// view of the frame memory holding the lease, released with the last
+	// Mat referencing it
+	static cv::Mat leasedView(Frame &&frame);
+};
+
+// Lease on a frame of a FrameSource : a locked sequence buffer, returned by
+// Camera::nextFrame, or a buffer of a Playback. The buffer is unlocked when
+// the lease is destroyed or unlocked; leases are move-only and can be handed
+// over to another thread. A lease destroyed after its source does nothing,
+// its memory is gone with the source.
+// Recorder, FrameHistory and SharedFramePublisher take a frame by copying it
+// into memory of their own, so that the lease can be released as soon as
+// they return and the source never waits on them ; they are fed from the
+// capture loop or from a CaptureDispatcher callback.
+class Frame
+{
+	public:
+	Frame();
+	Frame(Frame &&frame);
+	~Frame();
+	Frame& operator=(Frame &&frame);
+	
+	bool valid() const;
+	ImageMemory* memory() const;
+	// 1-based position in the sequence of a camera, index in the recording
+	// of a playback
+	int sequenceId() const;
+	const FrameInfo& info() const;
+	
+	void unlock();
+	
+	private:
+	friend class Camera;
+	friend class Playback;
+	Frame(const std::shared_ptr<std::atomic<FrameSource*> > &source, ImageMemory *memory, int sequence_id, const FrameInfo &info);
+	Frame(const Frame&); // non construction-copyable
+	Frame& operator=(const Frame&); // non copyable
+	
+	// the source, pointing to NULL once it is destroyed ; atomic, frames
+	// being released on other threads than the one closing the source
+	std::shared_ptr<std::atomic<FrameSource*> > Owner;
+	ImageMemory *Memory;
+	int SequenceId;
+	FrameInfo Info;
+};
+
 struct CameraInfo
 {
 	uint64_t CameraId;
@@ -91,7 +348,57 @@ struct CameraInfo
 
 std::vector<CameraInfo> getCameraList();
 
-class Camera
+struct TimingSettings
+{
+	uint32_t PixelClock;
+	double FrameRate;
+	double Exposure;
+};
+
+// Change of the camera timing as one step, applied in dependency order :
+// pixel clock, then frame rate within the new frame time range, then exposure
+// within the new exposure range, so that no value is clamped by a setting
+// about to change. The timing lock of the camera is held for the whole
+// commit, so that no other timing getter or setter interleaves. Parameters
+// not given keep their current value, or are adjusted by the SDK to the new
+// ranges.
+//	TimingSettings achieved = camera.timing().maxPixelClock().frameRate(50).maxExposure().commit();
+class TimingTransaction
+{
+	public:
+	explicit TimingTransaction(Camera &camera);
+	
+	TimingTransaction& pixelClock(uint32_t pixel_clock);
+	TimingTransaction& maxPixelClock();
+	TimingTransaction& frameRate(double frame_rate);
+	TimingTransaction& maxFrameRate();
+	TimingTransaction& exposure(double exposure);
+	TimingTransaction& minExposure();
+	TimingTransaction& maxExposure();
+	
+	// applies the changes, returns the values actually set ; on error, the
+	// changes before the failing one stay applied
+	TimingSettings commit();
+	
+	private:
+	enum Request{KEEP, VALUE, MINIMUM, MAXIMUM};
+	
+	Camera &Cam;
+	Request PixelClockRequest;
+	Request FrameRateRequest;
+	Request ExposureRequest;
+	TimingSettings Settings;
+};
+
+enum TriggerMode
+{
+	TRIGGER_OFF, // free run
+	TRIGGER_SOFTWARE,
+	TRIGGER_RISING_EDGE,
+	TRIGGER_FALLING_EDGE
+};
+
+class Camera: public FrameSource
 {
 	public:
 	explicit Camera(uint8_t camera_id=0);
@@ -101,12 +408,44 @@ class Camera
 	int getSensorWidth() const;
 	int getSensorHeight() const;
 	uint8_t getSensorColorMode() const;
+	// BAYER_PIXEL_* color of the first sensor pixel
+	uint8_t getSensorBayerPixel() const;
 	
 	int32_t getAOIPosX() const;
 	int32_t getAOIPosY() const;
 	int32_t getAOIWidth() const;
 	int32_t getAOIHeight() const;
+	// Values are rounded down to the sensor increments. While capturing, the
+	// stream is restarted, and the sequence buffers are only reallocated when
+	// they are too small for the new size, which needs a sequence started
+	// with a SequenceSizing and no frame locked.
+	void setAOI(int32_t x, int32_t y, int32_t width, int32_t height);
+	// Moves the AOI without changing its size. While capturing, uses
+	// IS_AOI_IMAGE_SET_POS_FAST when the camera supports it, so that the
+	// stream is not stopped : returns false when setAOI had to be used.
+	bool setAOIPosition(int32_t x, int32_t y);
+	// Binning and subsampling modes combine one horizontal and one vertical
+	// IS_BINNING_* (IS_SUBSAMPLING_*) flag, IS_BINNING_DISABLE for none. The
+	// AOI is read back after a change, and while capturing the stream is
+	// restarted, the sequence buffers following the same rules as with setAOI.
+	// Negative modes are rejected.
+	INT getSupportedBinning() const;
+	INT getBinning() const;
+	void setBinning(INT mode);
+	INT getSupportedSubsampling() const;
+	INT getSubsampling() const;
+	void setSubsampling(INT mode);
+	// mode for factors 1 to 4, or -1 when the sensor does not support them
+	INT binningMode(int horizontal, int vertical) const;
+	INT subsamplingMode(int horizontal, int vertical) const;
+	// combined binning and subsampling factors
+	int getDecimationX() const;
+	int getDecimationY() const;
 	int32_t getColorMode() const;
+	// IS_CM_* format of the images, IS_CM_SENSOR_RAW8 to transfer the Bayer
+	// mosaic and demosaic on the host (ueye_convert.hpp). While capturing, the
+	// stream is restarted with new buffers, under the same conditions as setAOI.
+	void setColorMode(int32_t color_mode);
 	
 	Range<uint32_t> getPixelClockRange() const;
 	Range<double> getFrameTimeRange() const;
@@ -118,36 +457,171 @@ class Camera
 	void setPixelClock(uint32_t pixel_clock);
 	void setFrameRate(double frame_rate);
 	void setExposure(double exposure);
+	// Timing values are cached, and a setter only invalidates the values that
+	// depend on it, fetched again when next read. Call invalidateTiming after
+	// changing settings through handle(). The cache is locked, so that timing
+	// can be read and set from a thread other than the capture one.
+	void invalidateTiming();
+	TimingTransaction timing();
+	// SDK calls issued for the configuration, the capture path is not counted
+	uint64_t getSdkCallCount() const;
+	
+	// In trigger mode the sequence of videoCaptureStart stays armed, each
+	// trigger exposing a burst of frames after the trigger delay (in us).
+	// While capturing, setTriggerMode restarts the stream with its buffers.
+	// With a trigger mode active, starting capture does not wait for a frame.
+	TriggerMode getTriggerMode() const;
+	void setTriggerMode(TriggerMode mode);
+	Range<uint32_t> getTriggerDelayRange() const;
+	uint32_t getTriggerDelay() const;
+	// rounded down to the granularity
+	void setTriggerDelay(uint32_t delay);
+	// ranges from 1 to 1 when bursts are not supported
+	Range<uint32_t> getTriggerBurstRange() const;
+	uint32_t getTriggerBurst() const;
+	void setTriggerBurst(uint32_t frames);
+	// Software trigger into the armed sequence, a single SDK call with no
+	// allocation, usable in any trigger mode. The time of the trigger is kept
+	// for the trigger latency of getStatistics(), up to the next frame.
+	INT tryForceTrigger();
+	void forceTrigger();
 	
 	void imageCapture(ImageMemory &image_memory);
 	
 	void videoCaptureStart(std::vector<ImageMemory> &buffer);
+	// Captures into a sequence taken from the memory pool, long enough to hold
+	// the frames of sizing.HoldTime at the current frame rate. Growth happens
+	// in tryWaitNextFrame, at a wait where no other frame than the one being
+	// replaced is locked : that frame is then unlocked first, and capture is
+	// restarted with the longer sequence. A failed start gives the buffers
+	// back to the pool and leaves the camera stopped ; starting while a
+	// sequence is set throws.
+	void videoCaptureStart(const SequenceSizing &sizing=SequenceSizing());
+	// length of the sequence videoCaptureStart(sizing) would take
+	size_t sequenceLength(const SequenceSizing &sizing) const;
+	// throws while frames or views are still leased, the sequence buffers
+	// they point to would be freed or reused
 	void videoCaptureStop();
+	size_t getSequenceLength() const;
+	uint64_t getSequenceGrowCount() const;
+	
+	// Non-throwing capture path, returning the SDK status : IS_SUCCESS,
+	// IS_TIMED_OUT, IS_CAPTURE_STATUS when the transfer of a frame failed (its
+	// buffer is unlocked and the frame counted as missed), or another error.
+	// No allocation is done on any of these paths.
+	virtual INT tryWaitNextFrame(Frame &frame, uint32_t timeout=1000);
+	virtual INT tryUnlock(Frame &frame);
+	INT tryCapture(ImageMemory &image_memory);
+	// frame event (IS_SET_EVENT_FRAME), signaled once for each frame put in the
+	// image queue ; tryWaitFrameEvent returns IS_SUCCESS or IS_TIMED_OUT
+	virtual void enableFrameEvent();
+	virtual void disableFrameEvent();
+	virtual INT tryWaitFrameEvent(uint32_t timeout);
+	uint64_t getMissedFrameCount() const;
+	uint64_t getLostFrameCount() const;
+	const CaptureStatistics& getStatistics() const;
+	ImageMemoryPool& memoryPool();
+	
+	Frame nextFrame(uint32_t timeout=1000);
+	virtual void unlockFrame(Frame &frame);
 	ImageMemory* waitNextFrame(uint32_t timeout=1000);
 	void unlockFrame(ImageMemory *frame);
+	// the returned Mat shares the sequence buffer, which stays locked until
+	// the last Mat referencing it is released
+	cv::Mat waitNextView(uint32_t timeout=1000);
 	
 	HIDS handle()const;
 	
 	private:
+	friend class TimingTransaction;
 	Camera(const Camera&); // non construction-copyable
 	Camera& operator=(const Camera&); // non copyable
 	
-	enum TimingUpdate{TIMING_INIT, TIMING_PIXEL_CLOCK, TIMING_FRAME_RATE, TIMING_EXPOSURE};
-	void updateTimingInfo(TimingUpdate update);
+	// cached timing values, as bits of TimingDirty
+	enum TimingValue
+	{
+		TIMING_PIXEL_CLOCK = 1,
+		TIMING_PIXEL_CLOCK_RANGE = 2, // and list
+		TIMING_FRAME_TIME_RANGE = 4,
+		TIMING_FRAME_RATE = 8,
+		TIMING_EXPOSURE_RANGE = 16,
+		TIMING_EXPOSURE = 32,
+		TIMING_ALL = 63
+	};
+	// with TimingMutex locked
+	void refreshTiming(uint32_t values) const;
+	
+	size_t sequenceLimit(const SequenceSizing &sizing) const;
+	INT addToSequence(ImageMemory &memory);
+	// is_CaptureVideo, not waiting for a first frame when a trigger mode is
+	// active, as that frame only comes with a trigger
+	INT captureVideo();
+	void queryAOIIncrements();
+	// stops capture, applies the change, reads the AOI back, reallocates the
+	// sequence when it does not fit anymore, and restarts ; the expected format
+	// allows failing before the change when the buffers can not be reallocated
+	void changeImageFormat(const std::function<INT()> &change, int32_t expected_width, int32_t expected_height, int32_t expected_color_mode, uint32_t timing_values);
+	// after a failed change : puts the previous format back and restarts
+	// capture, or leaves the camera stopped when that fails too
+	void restoreImageFormat(const IS_RECT &aoi, int32_t color_mode, bool capturing, size_t sequence_length);
+	bool sequenceFits(int32_t width, int32_t height, int32_t color_mode) const;
+	INT growSequence(Frame &frame);
+	void checkSequenceSize(std::chrono::steady_clock::time_point now);
+	
+	// sequence buffer, with its 1-based position in the sequence as used by is_UnlockSeqBuf
+	struct SequenceBuffer
+	{
+		ImageMemory *Memory;
+		int Id;
+		FrameInfo Info; // of the frame handed out by waitNextFrame
+	};
 	
 	HIDS CameraHandle;
 	SENSORINFO SensorInfo;
 	IS_RECT AOI;
+	IS_SIZE_2D AOIPositionIncrement;
+	IS_SIZE_2D AOISizeIncrement;
+	int FastAOIPosition; // -1 until queried
+	INT Binning;
+	INT Subsampling;
+	mutable INT SupportedBinning; // -1 until queried
+	mutable INT SupportedSubsampling;
 	int32_t ColorMode;
-	Range<uint32_t> PixelClockRange;
-	std::vector<uint32_t> PixelClockList;
-	Range<double> FrameTimeRange;
-	Range<double> ExposureRange;
-	uint32_t PixelClock;
-	double FrameRate;
-	double Exposure;
+	// guards the timing cache below, filled by the const getters ; recursive,
+	// so that TimingTransaction::commit holds it across the getters and setters
+	mutable std::recursive_mutex TimingMutex;
+	mutable uint32_t TimingDirty;
+	mutable Range<uint32_t> PixelClockRange;
+	mutable std::vector<uint32_t> PixelClockList;
+	mutable Range<double> FrameTimeRange;
+	mutable Range<double> ExposureRange;
+	mutable uint32_t PixelClock;
+	mutable double FrameRate;
+	mutable double Exposure;
+	// frame time range by pixel clock, valid for the current AOI
+	mutable std::map<uint32_t, Range<double> > FrameTimeRanges;
+	mutable std::atomic<uint64_t> SdkCalls;
+	
+	ImageMemoryPool MemoryPool;
+	std::map<char*, SequenceBuffer> SequencePtr;
+	// frames locked by the application, including detached ones
+	std::atomic<int> LeasedFrames;
+	// shared with the leases, cleared by the destructor
+	std::shared_ptr<std::atomic<FrameSource*> > LeaseOwner;
+	
+	// sequence owned by the camera, in a deque for stable buffer addresses
+	bool AdaptiveSequence;
+	SequenceSizing Sizing;
+	std::deque<ImageMemory> OwnedSequence;
+	bool GrowPending;
+	uint64_t GrowCount;
+	std::chrono::steady_clock::time_point NextSizeCheck;
+	uint64_t SizeCheckLost;
+	uint64_t SizeCheckDelivered;
 	
-	std::map<char*, ImageMemory*> SequencePtr;
+	CaptureStatistics Statistics;
+	uint64_t LastFrameNumber;
+	bool LastFrameNumberValid;
 };
 
 }
@@ -0,0 +1,100 @@
+#include "ueye_allocator.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <system_error>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace{
+	// from <numaif.h>, not to depend on libnuma for a single system call
+	const int MEMORY_POLICY_BIND = 2;
+
+	size_t roundUp(size_t size, size_t alignment)
+	{
+		return (size + alignment - 1) / alignment * alignment;
+	}
+}
+
+namespace ueye{
+
+AlignedAllocator::AlignedAllocator(size_t alignment):
+	Alignment(alignment)
+{}
+
+void* AlignedAllocator::allocate(size_t size)
+{
+	void *ptr = NULL;
+	if(posix_memalign(&ptr, Alignment, size) != 0)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void AlignedAllocator::deallocate(void *ptr, size_t size)
+{
+	std::free(ptr);
+}
+
+
+HugePageAllocator::HugePageAllocator(int numa_node):
+	NumaNode(numa_node), HugePages(0), Fallbacks(0)
+{}
+
+void* HugePageAllocator::allocate(size_t size)
+{
+	size = roundUp(size, HUGE_PAGE_SIZE);
+	void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if(ptr != MAP_FAILED)
+	{
+		++HugePages;
+	}
+	else
+	{
+		ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(ptr == MAP_FAILED)
+			throw std::bad_alloc();
+		madvise(ptr, size, MADV_HUGEPAGE);
+		++Fallbacks;
+	}
+
+	// the policy only applies to pages not yet faulted in
+	if(NumaNode >= 0)
+	{
+		unsigned long node_mask[16];
+		std::memset(node_mask, 0, sizeof(node_mask));
+		const size_t mask_bits = 8*sizeof(unsigned long);
+		if((size_t)NumaNode >= mask_bits*16)
+		{
+			munmap(ptr, size);
+			throw std::system_error(EINVAL, std::system_category(), "NUMA node out of range");
+		}
+		node_mask[NumaNode/mask_bits] = 1ul << (NumaNode%mask_bits);
+		if(syscall(SYS_mbind, ptr, size, MEMORY_POLICY_BIND, node_mask, mask_bits*16, 0) != 0)
+		{
+			int err = errno;
+			munmap(ptr, size);
+			throw std::system_error(err, std::system_category(), "mbind");
+		}
+	}
+	std::memset(ptr, 0, size);
+	return ptr;
+}
+
+void HugePageAllocator::deallocate(void *ptr, size_t size)
+{
+	munmap(ptr, roundUp(size, HUGE_PAGE_SIZE));
+}
+
+uint64_t HugePageAllocator::hugePageCount() const
+{
+	return HugePages;
+}
+
+uint64_t HugePageAllocator::fallbackCount() const
+{
+	return Fallbacks;
+}
+
+}
@@ -0,0 +1,48 @@
+#ifndef UEYE_ALLOCATOR_HPP
+#define UEYE_ALLOCATOR_HPP
+
+#include "ueye.hpp"
+
+namespace ueye{
+
+// heap memory aligned on a cache line, or any power of two
+class AlignedAllocator: public ImageAllocator
+{
+	public:
+	explicit AlignedAllocator(size_t alignment=64);
+	
+	virtual void* allocate(size_t size);
+	virtual void deallocate(void *ptr, size_t size);
+	
+	private:
+	size_t Alignment;
+};
+
+// Anonymous mappings backed by 2 MB huge pages (MAP_HUGETLB), optionally bound
+// to a NUMA node. When no huge page is reserved (vm.nr_hugepages), falls back
+// to regular pages with transparent huge pages requested through madvise.
+// Pages are faulted in at allocation, so that the first frames do not pay for it.
+class HugePageAllocator: public ImageAllocator
+{
+	public:
+	// numa_node -1 keeps the default memory policy
+	explicit HugePageAllocator(int numa_node=-1);
+	
+	virtual void* allocate(size_t size);
+	virtual void deallocate(void *ptr, size_t size);
+	
+	// allocations served with huge pages, and with the fallback
+	uint64_t hugePageCount() const;
+	uint64_t fallbackCount() const;
+	
+	static const size_t HUGE_PAGE_SIZE = 2*1024*1024;
+	
+	private:
+	int NumaNode;
+	std::atomic<uint64_t> HugePages;
+	std::atomic<uint64_t> Fallbacks;
+};
+
+}
+
+#endif
@@ -0,0 +1,261 @@
+#include "ueye_async.hpp"
+#include <algorithm>
+#include <memory>
+
+namespace{
+	// ranges of a parallelFor, shared with the tasks that may start after it returned
+	struct ParallelLoop
+	{
+		ParallelLoop(size_t count, size_t ranges, const std::function<void(size_t, size_t)> &body):
+			Count(count), Ranges(ranges), Body(body), Next(0), Done(0)
+		{}
+		
+		// false once every range has been taken
+		bool runRange()
+		{
+			size_t range = Next++;
+			if(range >= Ranges)
+				return false;
+			Body(range*Count/Ranges, (range+1)*Count/Ranges);
+			std::lock_guard<std::mutex> lock(Mutex);
+			if(++Done == Ranges)
+				Finished.notify_all();
+			return true;
+		}
+		
+		size_t Count;
+		size_t Ranges;
+		const std::function<void(size_t, size_t)> &Body;
+		std::atomic<size_t> Next;
+		size_t Done;
+		std::mutex Mutex;
+		std::condition_variable Finished;
+	};
+}
+
+namespace ueye{
+
+WorkerPool::WorkerPool(size_t thread_count):
+	Stopping(false)
+{
+	if(thread_count == 0)
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	for(size_t i=0; i<thread_count; ++i)
+		Threads.push_back(std::thread(&WorkerPool::run, this));
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Stopping = true;
+	}
+	TaskPosted.notify_all();
+	for(size_t i=0; i<Threads.size(); ++i)
+		Threads[i].join();
+}
+
+size_t WorkerPool::size() const
+{
+	return Threads.size();
+}
+
+void WorkerPool::post(const std::function<void()> &task)
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Tasks.push_back(task);
+	}
+	TaskPosted.notify_one();
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t begin, size_t end)> &body)
+{
+	size_t ranges = std::min(count, Threads.size()+1);
+	if(ranges <= 1)
+	{
+		if(count)
+			body(0, count);
+		return;
+	}
+	std::shared_ptr<ParallelLoop> loop = std::make_shared<ParallelLoop>(count, ranges, body);
+	for(size_t i=1; i<ranges; ++i)
+		post([loop]{loop->runRange();});
+	while(loop->runRange())
+	{}
+	std::unique_lock<std::mutex> lock(loop->Mutex);
+	loop->Finished.wait(lock, [&loop]{return loop->Done == loop->Ranges;});
+}
+
+void WorkerPool::run()
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	while(true)
+	{
+		TaskPosted.wait(lock, [this]{return Stopping || !Tasks.empty();});
+		if(Tasks.empty())
+			return;
+		std::function<void()> task;
+		task.swap(Tasks.front());
+		Tasks.pop_front();
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
+
+
+CaptureDispatcher::CaptureDispatcher(WorkerPool &pool):
+	Pool(pool), Sweeps(0), Running(false), EventThreadActive(false)
+{}
+
+CaptureDispatcher::~CaptureDispatcher()
+{
+	stop();
+	// wait for the callbacks already posted to the pool
+	std::unique_lock<std::mutex> lock(Mutex);
+	StateChanged.wait(lock, [this]{
+		for(std::list<Source>::const_iterator it = Sources.begin(); it != Sources.end(); ++it)
+		{
+			if(it->InFlight)
+				return false;
+		}
+		return true;
+	});
+}
+
+void CaptureDispatcher::start()
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	if(Running)
+		return;
+	Running = true;
+	EventThreadActive = true;
+	EventThread = std::thread(&CaptureDispatcher::eventLoop, this);
+}
+
+void CaptureDispatcher::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		if(!Running)
+			return;
+		Running = false;
+	}
+	StateChanged.notify_all();
+	EventThread.join();
+}
+
+void CaptureDispatcher::addSource(FrameSource &producer, const FrameCallback &callback)
+{
+	producer.enableFrameEvent();
+	Source source;
+	source.Producer = &producer;
+	source.Callback = callback;
+	source.InFlight = 0;
+	source.Removed = false;
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Sources.push_back(source);
+	}
+	StateChanged.notify_all();
+}
+
+void CaptureDispatcher::removeSource(FrameSource &producer)
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	std::list<Source>::iterator source = Sources.begin();
+	while(source != Sources.end() && (source->Producer != &producer || source->Removed))
+		++source;
+	if(source == Sources.end())
+		return;
+	source->Removed = true;
+	// the event thread may still be fetching from the source until the end of its current sweep
+	uint64_t sweeps = Sweeps;
+	StateChanged.wait(lock, [this, source, sweeps]{return (Sweeps != sweeps || !EventThreadActive) && source->InFlight == 0;});
+	Sources.erase(source);
+	lock.unlock();
+	producer.disableFrameEvent();
+}
+
+void CaptureDispatcher::eventLoop()
+{
+	std::vector<Source*> sources;
+	size_t next_wait = 0;
+	std::unique_lock<std::mutex> lock(Mutex);
+	while(Running)
+	{
+		sources.clear();
+		for(std::list<Source>::iterator it = Sources.begin(); it != Sources.end(); ++it)
+		{
+			if(!it->Removed)
+				sources.push_back(&*it);
+		}
+		if(sources.empty())
+		{
+			StateChanged.wait(lock);
+			continue;
+		}
+		lock.unlock();
+
+		bool delivered = false;
+		for(size_t i=0; i<sources.size(); ++i)
+		{
+			Frame frame;
+			INT err;
+			while((err = sources[i]->Producer->tryWaitNextFrame(frame, 0)) == IS_SUCCESS || err == IS_CAPTURE_STATUS)
+			{
+				if(err == IS_SUCCESS)
+				{
+					dispatch(sources[i], frame);
+					delivered = true;
+				}
+			}
+		}
+		if(!delivered)
+		{
+			// a single source can be waited on for long, stop() being the only other wakeup needed
+			FrameSource *producer = sources[next_wait++ % sources.size()]->Producer;
+			producer->tryWaitFrameEvent(sources.size() > 1 ? 1 : 100);
+		}
+
+		lock.lock();
+		++Sweeps;
+		StateChanged.notify_all();
+	}
+	EventThreadActive = false;
+	StateChanged.notify_all();
+}
+
+void CaptureDispatcher::dispatch(Source *source, Frame &frame)
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		if(source->Removed)
+			return;
+		++source->InFlight;
+		Pending.push_back(PendingFrame());
+		Pending.back().Src = source;
+		Pending.back().Data = std::move(frame);
+	}
+	Pool.post([this]{runCallback();});
+}
+
+void CaptureDispatcher::runCallback()
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	Source *source = Pending.front().Src;
+	{
+		Frame frame(std::move(Pending.front().Data));
+		Pending.pop_front();
+		bool removed = source->Removed;
+		lock.unlock();
+		if(!removed)
+			source->Callback(*source->Producer, frame);
+	}
+	lock.lock();
+	--source->InFlight;
+	StateChanged.notify_all();
+}
+
+}
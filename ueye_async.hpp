@@ -0,0 +1,106 @@
+#ifndef UEYE_ASYNC_HPP
+#define UEYE_ASYNC_HPP
+
+#include "ueye.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+
+namespace ueye{
+
+// fixed set of threads running posted tasks in FIFO order
+class WorkerPool
+{
+	public:
+	// thread_count 0 uses one thread per hardware thread
+	explicit WorkerPool(size_t thread_count=0);
+	// runs the tasks still pending, then joins the threads
+	~WorkerPool();
+	
+	size_t size() const;
+	void post(const std::function<void()> &task);
+	// Runs body over [0, count) split in ranges, at most one per worker and
+	// one for the calling thread, and returns once all of them are done. The
+	// caller runs the ranges no worker has taken yet, so that it can be called
+	// from a task without deadlock. body must not throw.
+	void parallelFor(size_t count, const std::function<void(size_t begin, size_t end)> &body);
+	
+	private:
+	WorkerPool(const WorkerPool&); // non construction-copyable
+	WorkerPool& operator=(const WorkerPool&); // non copyable
+	
+	void run();
+	
+	std::vector<std::thread> Threads;
+	std::deque<std::function<void()> > Tasks;
+	std::mutex Mutex;
+	std::condition_variable TaskPosted;
+	bool Stopping;
+};
+
+// Drives any number of frame sources, capturing cameras or playbacks, with a
+// single event thread : frames signaled by the frame event of their source
+// are fetched and their callbacks run on a worker pool.
+// The Linux SDK can only wait on the event of one camera at a time, so the
+// event thread drains every source without blocking, and when none had a
+// frame, waits on their events in turn with a short timeout.
+// Callbacks of one source may run concurrently on different workers. The
+// frame stays locked until the callback returns, unless the callback moves it
+// out ; such frames must be released before the camera stops capturing.
+class CaptureDispatcher
+{
+	public:
+	// callbacks must not throw
+	typedef std::function<void(FrameSource &source, Frame &frame)> FrameCallback;
+	
+	explicit CaptureDispatcher(WorkerPool &pool);
+	~CaptureDispatcher();
+	
+	void start();
+	void stop();
+	
+	// a camera must be capturing (videoCaptureStart) and stay so until it is
+	// removed ; a source must outlive its removal
+	void addSource(FrameSource &source, const FrameCallback &callback);
+	// returns once no callback of the source is running anymore ; must not be
+	// called from a callback
+	void removeSource(FrameSource &source);
+	
+	private:
+	CaptureDispatcher(const CaptureDispatcher&); // non construction-copyable
+	CaptureDispatcher& operator=(const CaptureDispatcher&); // non copyable
+	
+	struct Source
+	{
+		FrameSource *Producer;
+		FrameCallback Callback;
+		size_t InFlight;
+		bool Removed;
+	};
+	struct PendingFrame
+	{
+		Source *Src;
+		Frame Data;
+	};
+	
+	void eventLoop();
+	void dispatch(Source *source, Frame &frame);
+	void runCallback();
+	
+	WorkerPool &Pool;
+	std::list<Source> Sources;
+	std::deque<PendingFrame> Pending;
+	std::mutex Mutex;
+	std::condition_variable StateChanged;
+	uint64_t Sweeps;
+	bool Running;
+	bool EventThreadActive;
+	std::thread EventThread;
+};
+
+}
+
+#endif
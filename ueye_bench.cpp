@@ -0,0 +1,1433 @@
+#include "ueye.hpp"
+#include "ueye_allocator.hpp"
+#include "ueye_codec.hpp"
+#include "ueye_async.hpp"
+#include "ueye_convert.hpp"
+#include "ueye_group.hpp"
+#include "ueye_history.hpp"
+#include "ueye_playback.hpp"
+#include "ueye_publisher.hpp"
+#include "ueye_recorder.hpp"
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <system_error>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace{
+	typedef std::chrono::steady_clock Clock;
+
+	double seconds(const Clock::duration &duration)
+	{
+		return std::chrono::duration<double>(duration).count();
+	}
+
+	void setMaxFrameRate(ueye::Camera &camera)
+	{
+		camera.timing().maxPixelClock().maxFrameRate().minExposure().commit();
+	}
+
+	// nextFrame and copyToMat throughput, camera running at its highest frame rate,
+	// or waitNextView cost when frames are consumed in place
+	int runCapture(int argc, char **argv, bool zero_copy)
+	{
+		size_t frames = argc > 0 ? std::atoi(argv[0]) : 1000;
+		size_t buffers = argc > 1 ? std::atoi(argv[1]) : 3;
+
+		ueye::Camera camera(0);
+		setMaxFrameRate(camera);
+		std::cout<<"Sensor : "<<camera.getSensorName()<<" "<<camera.getAOIWidth()<<"x"<<camera.getAOIHeight()<<std::endl;
+		std::cout<<"Pixel clock : "<<camera.getPixelClock()<<std::endl;
+		std::cout<<"FrameRate : "<<camera.getFrameRate()<<std::endl;
+
+		std::vector<ueye::ImageMemory> buffer;
+		camera.memoryPool().acquire(buffer, buffers);
+		camera.videoCaptureStart(buffer);
+
+		cv::Mat mat;
+		Clock::duration wait_time(0), copy_time(0);
+		Clock::time_point start = Clock::now();
+		for(size_t i=0; i<frames; ++i)
+		{
+			Clock::time_point wait_start = Clock::now();
+			if(zero_copy)
+			{
+				mat = camera.waitNextView();
+				wait_time += Clock::now() - wait_start;
+				continue;
+			}
+			ueye::Frame frame = camera.nextFrame();
+			Clock::time_point copy_start = Clock::now();
+			frame.memory()->copyToMat(mat);
+			Clock::time_point copy_end = Clock::now();
+			frame.unlock();
+			wait_time += copy_start - wait_start;
+			copy_time += copy_end - copy_start;
+		}
+		double total = seconds(Clock::now() - start);
+		double frame_mb = mat.total()*mat.elemSize()/1e6;
+		mat.release();
+		camera.videoCaptureStop();
+
+		UEYE_CAPTURE_STATUS_INFO status;
+		std::memset(&status, 0, sizeof(status));
+		is_CaptureStatus(camera.handle(), IS_CAPTURE_STATUS_INFO_CMD_GET, &status, sizeof(status));
+
+		std::cout<<"Frames : "<<frames<<" in "<<total<<" s, "<<frames/total<<" fps"<<std::endl;
+		if(zero_copy)
+		{
+			std::cout<<"waitNextView : "<<seconds(wait_time)/frames*1e6<<" us/frame"<<std::endl;
+		}
+		else
+		{
+			std::cout<<"nextFrame : "<<seconds(wait_time)/frames*1e6<<" us/frame"<<std::endl;
+			std::cout<<"copyToMat : "<<seconds(copy_time)/frames*1e6<<" us/frame, "<<frame_mb*frames/seconds(copy_time)<<" MB/s"<<std::endl;
+		}
+		std::cout<<"Missed frames : "<<camera.getMissedFrameCount()<<", lost frame numbers : "<<camera.getLostFrameCount()<<std::endl;
+		std::cout<<"Capture status errors : "<<status.dwCapStatusCnt_Total<<" (no destination memory : "<<status.adwCapStatusCnt_Detail[IS_CAP_STATUS_API_NO_DEST_MEM]<<")"<<std::endl;
+		std::cout<<"Statistics : ";
+		camera.getStatistics().snapshot().dump(std::cout);
+		std::cout<<std::endl;
+		return 0;
+	}
+
+	int benchCapture(int argc, char **argv)
+	{
+		return runCapture(argc, argv, false);
+	}
+
+	int benchView(int argc, char **argv)
+	{
+		return runCapture(argc, argv, true);
+	}
+
+	// all connected cameras at their highest frame rate, served by one
+	// CaptureDispatcher and a worker pool instead of one thread per camera
+	int benchDispatch(int argc, char **argv)
+	{
+		double duration = argc > 0 ? std::atof(argv[0]) : 5.0;
+		size_t workers = argc > 1 ? std::atoi(argv[1]) : 2;
+		size_t buffers = argc > 2 ? std::atoi(argv[2]) : 4;
+
+		std::vector<ueye::CameraInfo> list = ueye::getCameraList();
+		std::vector<std::unique_ptr<ueye::Camera> > cameras;
+		std::vector<std::vector<ueye::ImageMemory> > buffer(list.size());
+		for(size_t i=0; i<list.size(); ++i)
+		{
+			cameras.push_back(std::unique_ptr<ueye::Camera>(new ueye::Camera(list[i].CameraId)));
+			setMaxFrameRate(*cameras[i]);
+			cameras[i]->memoryPool().acquire(buffer[i], buffers);
+		}
+		std::cout<<"Cameras : "<<cameras.size()<<", workers : "<<workers<<std::endl;
+
+		std::atomic<uint64_t> frames(0);
+		std::atomic<int64_t> max_latency(0);
+		ueye::WorkerPool pool(workers);
+		ueye::CaptureDispatcher dispatcher(pool);
+		for(size_t i=0; i<cameras.size(); ++i)
+		{
+			cameras[i]->videoCaptureStart(buffer[i]);
+			dispatcher.addSource(*cameras[i], [&frames, &max_latency](ueye::FrameSource&, ueye::Frame &frame){
+				int64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - frame.info().HostTimestamp).count();
+				int64_t max = max_latency.load(std::memory_order_relaxed);
+				while(latency > max && !max_latency.compare_exchange_weak(max, latency, std::memory_order_relaxed));
+				frames.fetch_add(1, std::memory_order_relaxed);
+			});
+		}
+		Clock::time_point start = Clock::now();
+		dispatcher.start();
+		std::this_thread::sleep_for(std::chrono::duration<double>(duration));
+		dispatcher.stop();
+		double total = seconds(Clock::now() - start);
+		for(size_t i=0; i<cameras.size(); ++i)
+		{
+			dispatcher.removeSource(*cameras[i]);
+			cameras[i]->videoCaptureStop();
+		}
+
+		std::cout<<"Frames : "<<frames<<" in "<<total<<" s, "<<frames/total<<" fps"<<std::endl;
+		std::cout<<"Max dispatch latency : "<<max_latency<<" us"<<std::endl;
+		for(size_t i=0; i<cameras.size(); ++i)
+		{
+			ueye::CaptureStatistics::Snapshot stats = cameras[i]->getStatistics().snapshot();
+			std::cout<<"Camera "<<list[i].CameraId<<" : "<<stats.FrameRate<<" fps, missed frames : "<<stats.Missed<<", lost frame numbers : "<<stats.Lost<<std::endl;
+		}
+		return 0;
+	}
+
+	// camera at its highest frame rate recorded to path : sustained frame and
+	// write rates, drops and the deepest backlog of the writer ; with
+	// compress, MONO12 frames encoded on every hardware thread
+	int benchRecord(int argc, char **argv)
+	{
+		const char *path = argc > 0 ? argv[0] : "ueye_bench.rec";
+		double duration = argc > 1 ? std::atof(argv[1]) : 5.0;
+		size_t staging = argc > 2 ? std::atoi(argv[2]) : 16;
+		bool direct_io = argc > 3 ? std::atoi(argv[3]) != 0 : true;
+		bool compress = argc > 4 ? std::atoi(argv[4]) != 0 : false;
+
+		ueye::Camera camera(0);
+		if(compress)
+			camera.setColorMode(IS_CM_MONO12);
+		setMaxFrameRate(camera);
+		ueye::ImageMemory prototype(camera);
+		ueye::WorkerPool pool;
+		ueye::TileCodec codec(&pool);
+		ueye::Recorder recorder(path, ueye::Recorder::frameBytes(prototype), staging, direct_io, compress ? &codec : NULL);
+		std::cout<<"FrameRate : "<<camera.getFrameRate()<<", frame : "<<ueye::Recorder::frameBytes(prototype)/1e6<<" MB, "
+			<<(recorder.isDirectIO() ? "direct I/O" : "buffered I/O")<<std::endl;
+
+		camera.videoCaptureStart();
+		ueye::Frame frame;
+		Clock::time_point start = Clock::now();
+		while(Clock::now() - start < std::chrono::duration<double>(duration))
+		{
+			INT err = camera.tryWaitNextFrame(frame);
+			if(err == IS_SUCCESS)
+				recorder.write(frame);
+			else if(err != IS_CAPTURE_STATUS)
+				throw ueye::Exception(camera.handle(), err, "tryWaitNextFrame");
+		}
+		frame = ueye::Frame();
+		camera.videoCaptureStop();
+		double capture_time = seconds(Clock::now() - start);
+		ueye::CaptureStatistics::Snapshot capture = camera.getStatistics().snapshot();
+		recorder.close();
+		double total = seconds(Clock::now() - start);
+
+		ueye::RecorderStatistics stats = recorder.getStatistics();
+		std::cout<<"Captured : "<<capture.Delivered/capture_time<<" fps, lost frames : "<<capture.Lost<<std::endl;
+		std::cout<<"Recorded : "<<stats.Frames<<" frames, "<<stats.Bytes/total/1e6<<" MB/s, dropped : "<<stats.Dropped
+			<<", max backlog : "<<stats.MaxBacklog<<"/"<<staging<<std::endl;
+		if(compress)
+			std::cout<<"Compression : "<<stats.CompressionRatio<<", encode latency : "<<stats.MeanEncodeLatency*1e3<<" ms mean, "
+				<<stats.MaxEncodeLatency*1e3<<" ms max"<<std::endl;
+		return 0;
+	}
+
+	// TileCodec on synthetic images, a gradient with noise of noise levels :
+	// compression ratio, encode and decode times on one thread and on the
+	// pool, checked to decode to the original
+	int benchCodec(int argc, char **argv)
+	{
+		size_t iterations = argc > 0 ? std::atoi(argv[0]) : 20;
+		size_t workers = argc > 1 ? std::atoi(argv[1]) : std::thread::hardware_concurrency();
+		int noise = argc > 2 ? std::atoi(argv[2]) : 16;
+
+		ueye::WorkerPool pool(workers);
+		const int width = 2048, height = 2048;
+		struct
+		{
+			int32_t Mode;
+			const char *Name;
+			int Bits;
+		} modes[] = {{IS_CM_MONO8, "MONO8", 8}, {IS_CM_MONO12, "MONO12", 12}, {IS_CM_MONO16, "MONO16", 16}, {IS_CM_SENSOR_RAW12, "RAW12", 12}};
+		uint32_t seed = 1;
+		for(size_t m=0; m<sizeof(modes)/sizeof(modes[0]); ++m)
+		{
+			int32_t mode = modes[m].Mode;
+			int max_value = (1 << modes[m].Bits) - 1;
+			cv::Mat image(height, width, ueye::pixelMatType(mode));
+			for(int y=0; y<height; ++y)
+			{
+				for(int x=0; x<width; ++x)
+				{
+					seed = seed*1664525u + 1013904223u;
+					// Bayer colors get different levels
+					int value = (x + y)*max_value/(width + height) + (int)(seed >> 16) % (2*noise + 1) - noise + (mode == IS_CM_SENSOR_RAW12 ? (x%2 + y%2)*max_value/8 : 0);
+					value = std::min(std::max(value, 0), max_value);
+					if(image.depth() == CV_16U)
+						image.ptr<uint16_t>(y)[x] = value;
+					else
+						image.ptr<uint8_t>(y)[x] = value;
+				}
+			}
+			size_t raw_bytes = image.total()*image.elemSize();
+			std::vector<char> encoded(raw_bytes + 64*1024);
+			for(int threaded=0; threaded<2; ++threaded)
+			{
+				ueye::TileCodec codec(threaded ? &pool : NULL);
+				size_t bytes = 0;
+				Clock::time_point start = Clock::now();
+				for(size_t i=0; i<iterations; ++i)
+					bytes = codec.encode(image, mode, encoded.data(), encoded.size());
+				double encode_time = seconds(Clock::now() - start)/iterations;
+				cv::Mat decoded(height, width, image.type());
+				start = Clock::now();
+				for(size_t i=0; i<iterations; ++i)
+					codec.decode(encoded.data(), bytes, mode, decoded);
+				double decode_time = seconds(Clock::now() - start)/iterations;
+				bool identical = std::memcmp(decoded.data, image.data, raw_bytes) == 0;
+				std::cout<<modes[m].Name<<(threaded ? " pool" : " single")<<" : ratio "<<(double)raw_bytes/bytes
+					<<", encode "<<encode_time*1e3<<" ms ("<<raw_bytes/encode_time/1e6<<" MB/s), decode "<<decode_time*1e3<<" ms ("
+					<<raw_bytes/decode_time/1e6<<" MB/s)"<<(identical ? "" : ", MISMATCH")<<std::endl;
+			}
+		}
+		return 0;
+	}
+
+	// recording at path played back : frames served per second as fast as they
+	// are consumed, in place or decoded, and converted to BGR, then the real time schedule
+	// error against the recorded device timestamps ; last, the frames recorded
+	// again from a CaptureDispatcher callback, failing when they differ
+	int benchPlayback(int argc, char **argv)
+	{
+		const char *path = argc > 0 ? argv[0] : "ueye_bench.rec";
+		size_t frames = argc > 1 ? std::atoi(argv[1]) : 100;
+
+		ueye::RecordingReader reader(path);
+		std::cout<<"Frames : "<<reader.size()<<(reader.isComplete() ? "" : " (index rebuilt)")<<std::endl;
+		if(reader.size() == 0)
+			return 1;
+
+		ueye::WorkerPool pool;
+		ueye::Playback playback(reader, ueye::PLAYBACK_MAX_THROUGHPUT, false, &pool);
+		ueye::Frame frame;
+		size_t count = 0;
+		uint64_t checksum = 0;
+		Clock::time_point start = Clock::now();
+		while(playback.tryWaitNextFrame(frame) == IS_SUCCESS)
+		{
+			cv::Mat view = frame.memory()->view();
+			checksum += view.data[view.step[0]*(view.rows/2)];
+			++count;
+		}
+		double elapsed = seconds(Clock::now() - start);
+		std::cout<<(reader.frame(0).Encoding == ueye::ENCODING_RAW ? "In place : " : "Decoded : ")<<count/elapsed<<" fps ("<<checksum%256<<")"<<std::endl;
+
+		if(ueye::FormatConverter::isSupported(reader.frame(0).ColorMode))
+		{
+			cv::Mat bgr;
+			playback.seek(0);
+			count = 0;
+			start = Clock::now();
+			while(playback.tryWaitNextFrame(frame) == IS_SUCCESS)
+			{
+				frame.memory()->copyToMat(bgr, ueye::MAT_BGR);
+				++count;
+			}
+			elapsed = seconds(Clock::now() - start);
+			std::cout<<"BGR : "<<count/elapsed<<" fps, "<<count*bgr.total()*bgr.elemSize()/elapsed/1e6<<" MB/s"<<std::endl;
+		}
+
+		playback.setMode(ueye::PLAYBACK_REAL_TIME);
+		playback.seek(reader.size()/2);
+		frames = std::min(frames, reader.size() - playback.position());
+		double max_error = 0.0;
+		uint64_t lost = 0;
+		ueye::Frame first;
+		playback.tryWaitNextFrame(first);
+		for(size_t i=1; i<frames; ++i)
+		{
+			if(playback.tryWaitNextFrame(frame) != IS_SUCCESS)
+				break;
+			double recorded = (frame.info().DeviceTimestamp - first.info().DeviceTimestamp)*1e-7;
+			double served = seconds(frame.info().HostTimestamp - first.info().HostTimestamp);
+			max_error = std::max(max_error, std::abs(served - recorded));
+			lost += frame.info().LostBefore;
+		}
+		std::cout<<"Real time : "<<frames<<" frames, max schedule error : "<<max_error*1e3<<" ms, lost in recording : "<<lost<<std::endl;
+		first = ueye::Frame();
+		frame = ueye::Frame();
+
+		// one worker, so that the frames are recorded in order
+		std::string replay_path = std::string(path) + ".replay";
+		size_t frame_bytes = 0;
+		for(size_t i=0; i<reader.size(); ++i)
+			frame_bytes = std::max<size_t>(frame_bytes, (size_t)reader.frame(i).Pitch*reader.frame(i).Height);
+		ueye::WorkerPool dispatch_pool(1);
+		ueye::CaptureDispatcher dispatcher(dispatch_pool);
+		{
+			ueye::Recorder recorder(replay_path, frame_bytes);
+			playback.setMode(ueye::PLAYBACK_MAX_THROUGHPUT);
+			playback.seek(0);
+			std::atomic<size_t> dispatched(0);
+			dispatcher.addSource(playback, [&recorder, &dispatched](ueye::FrameSource&, ueye::Frame &frame){
+				recorder.write(frame, true);
+				++dispatched;
+			});
+			dispatcher.start();
+			while(dispatched < reader.size())
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			dispatcher.removeSource(playback);
+			dispatcher.stop();
+			recorder.close();
+		}
+		ueye::RecordingReader replay(replay_path);
+		size_t differences = replay.size() == reader.size() ? 0 : 1;
+		cv::Mat original, replayed;
+		for(size_t i=0; i<replay.size() && i<reader.size(); ++i)
+		{
+			reader.decode(i, original);
+			replay.decode(i, replayed);
+			bool identical = original.rows == replayed.rows && original.cols == replayed.cols && original.type() == replayed.type();
+			for(int y=0; y<original.rows && identical; ++y)
+				identical = std::memcmp(original.ptr(y), replayed.ptr(y), original.cols*original.elemSize()) == 0;
+			if(!identical)
+				++differences;
+		}
+		std::remove(replay_path.c_str());
+		std::cout<<"Dispatched and recorded again : "<<replay.size()<<" frames"<<(differences ? ", DIFFERS FROM THE RECORDING" : "")<<std::endl;
+		return differences ? 1 : 0;
+	}
+
+	// camera at its highest frame rate kept in a history of history seconds,
+	// with an event in the middle of the run : cost of the copy into the
+	// history, then the frames of the event recording around the trigger
+	int benchHistory(int argc, char **argv)
+	{
+		const char *path = argc > 0 ? argv[0] : "ueye_bench_event.rec";
+		double history_seconds = argc > 1 ? std::atof(argv[1]) : 1.0;
+		double post_seconds = argc > 2 ? std::atof(argv[2]) : 1.0;
+		double duration = argc > 3 ? std::atof(argv[3]) : 4.0;
+
+		ueye::Camera camera(0);
+		setMaxFrameRate(camera);
+		ueye::ImageMemory prototype(camera);
+		size_t frame_bytes = ueye::Recorder::frameBytes(prototype);
+		size_t capacity = camera.getFrameRate()*history_seconds + 1;
+		ueye::FrameHistory history(frame_bytes, capacity, history_seconds);
+		std::cout<<"FrameRate : "<<camera.getFrameRate()<<", history : "<<capacity<<" frames, "<<capacity*frame_bytes/1e6<<" MB"<<std::endl;
+
+		camera.videoCaptureStart();
+		ueye::Frame frame;
+		double push_time = 0.0, max_push_time = 0.0;
+		size_t pushes = 0;
+		bool triggered = false;
+		Clock::time_point trigger_time;
+		Clock::time_point start = Clock::now();
+		while(Clock::now() - start < std::chrono::duration<double>(duration))
+		{
+			INT err = camera.tryWaitNextFrame(frame);
+			if(err == IS_CAPTURE_STATUS)
+				continue;
+			if(err != IS_SUCCESS)
+				throw ueye::Exception(camera.handle(), err, "tryWaitNextFrame");
+			Clock::time_point push_start = Clock::now();
+			history.push(frame);
+			frame = ueye::Frame();
+			double elapsed = seconds(Clock::now() - push_start);
+			push_time += elapsed;
+			max_push_time = std::max(max_push_time, elapsed);
+			++pushes;
+			if(!triggered && Clock::now() - start > std::chrono::duration<double>(duration/2))
+			{
+				trigger_time = Clock::now();
+				history.trigger(path, post_seconds);
+				triggered = true;
+				std::cout<<"Trigger : "<<seconds(Clock::now() - trigger_time)*1e3<<" ms"<<std::endl;
+			}
+		}
+		camera.videoCaptureStop();
+		history.waitFlushed();
+		ueye::CaptureStatistics::Snapshot capture = camera.getStatistics().snapshot();
+		ueye::HistoryStatistics stats = history.getStatistics();
+		std::cout<<"Captured : "<<capture.Delivered<<" frames, lost : "<<capture.Lost<<std::endl;
+		std::cout<<"Push : "<<push_time/pushes*1e3<<" ms mean, "<<max_push_time*1e3<<" ms max, dropped : "<<stats.Dropped<<std::endl;
+
+		ueye::RecordingReader reader(path);
+		int64_t trigger_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(trigger_time.time_since_epoch()).count();
+		size_t before = 0, gaps = 0;
+		for(size_t i=0; i<reader.size(); ++i)
+		{
+			if(reader.frame(i).HostTimestamp <= trigger_ns)
+				++before;
+			if(i > 0 && reader.frame(i).FrameNumber != reader.frame(i-1).FrameNumber + 1)
+				++gaps;
+		}
+		std::cout<<"Event : "<<stats.Flushed<<" frames flushed, "<<before<<" before and "<<reader.size()-before<<" after the trigger, "
+			<<gaps<<" gaps"<<std::endl;
+		if(reader.size())
+			std::cout<<"Event span : "<<(trigger_ns - reader.frame(0).HostTimestamp)*1e-9<<" s before, "
+				<<(reader.frame(reader.size()-1).HostTimestamp - trigger_ns)*1e-9<<" s after"<<std::endl;
+		return 0;
+	}
+
+	// event driven shots : imageCapture (is_FreezeVideo) per shot, against
+	// software triggers into the armed sequence, with bursts of burst frames
+	int benchTrigger(int argc, char **argv)
+	{
+		size_t shots = argc > 0 ? std::atoi(argv[0]) : 100;
+		uint32_t burst = argc > 1 ? std::atoi(argv[1]) : 1;
+		uint32_t delay = argc > 2 ? std::atoi(argv[2]) : 0;
+
+		ueye::Camera camera(0);
+		setMaxFrameRate(camera);
+		std::cout<<"FrameRate : "<<camera.getFrameRate()<<std::endl;
+
+		ueye::ImageMemory memory(camera);
+		Clock::time_point start = Clock::now();
+		for(size_t i=0; i<shots; ++i)
+			camera.imageCapture(memory);
+		std::cout<<"imageCapture : "<<seconds(Clock::now() - start)/shots*1e3<<" ms per shot"<<std::endl;
+
+		camera.setTriggerMode(ueye::TRIGGER_SOFTWARE);
+		camera.setTriggerBurst(burst);
+		camera.setTriggerDelay(delay);
+		camera.videoCaptureStart();
+		std::cout<<"Burst : "<<camera.getTriggerBurst()<<" frames, delay : "<<camera.getTriggerDelay()<<" us"<<std::endl;
+		ueye::Frame frame;
+		size_t frames = 0;
+		start = Clock::now();
+		for(size_t i=0; i<shots; ++i)
+		{
+			camera.forceTrigger();
+			for(uint32_t f=0; f<camera.getTriggerBurst(); ++f)
+			{
+				INT err = camera.tryWaitNextFrame(frame);
+				if(err == IS_SUCCESS)
+					++frames;
+				else if(err != IS_CAPTURE_STATUS)
+					throw ueye::Exception(camera.handle(), err, "tryWaitNextFrame");
+			}
+		}
+		double total = seconds(Clock::now() - start);
+		frame = ueye::Frame();
+		ueye::CaptureStatistics::Snapshot stats = camera.getStatistics().snapshot();
+		camera.videoCaptureStop();
+		camera.setTriggerMode(ueye::TRIGGER_OFF);
+		std::cout<<"forceTrigger : "<<total/shots*1e3<<" ms per shot, "<<frames<<" frames";
+		std::cout<<", trigger to frame latency mean "<<stats.MeanTriggerLatency*1e3<<" ms, max "<<stats.MaxTriggerLatency*1e3<<" ms"<<std::endl;
+		return 0;
+	}
+
+	// all cameras in a group, in free run then fired by a software trigger at
+	// trigger_rate : rate of the matched sets, their spread and the frames
+	// left unmatched
+	int benchGroup(int argc, char **argv)
+	{
+		double duration = argc > 0 ? std::atof(argv[0]) : 5.0;
+		double trigger_rate = argc > 1 ? std::atof(argv[1]) : 20.0;
+		double tolerance = argc > 2 ? std::atof(argv[2]) : 0.002;
+
+		std::vector<ueye::CameraInfo> list = ueye::getCameraList();
+		std::vector<std::unique_ptr<ueye::Camera> > cameras;
+		ueye::WorkerPool pool(2);
+		ueye::CameraGroup group(pool, tolerance);
+		for(size_t i=0; i<list.size(); ++i)
+		{
+			cameras.push_back(std::unique_ptr<ueye::Camera>(new ueye::Camera(list[i].CameraId)));
+			setMaxFrameRate(*cameras[i]);
+			group.addCamera(*cameras[i]);
+		}
+		std::cout<<"Cameras : "<<cameras.size()<<", tolerance : "<<tolerance*1e3<<" ms"<<std::endl;
+
+		for(int triggered=0; triggered<2; ++triggered)
+		{
+			group.resetStatistics();
+			group.start(ueye::SequenceSizing(), triggered != 0);
+			std::atomic<bool> triggering(triggered != 0);
+			std::thread trigger_thread([&group, &triggering, trigger_rate]{
+				Clock::time_point next = Clock::now();
+				while(triggering)
+				{
+					group.trigger();
+					next += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0/trigger_rate));
+					std::this_thread::sleep_until(next);
+				}
+			});
+
+			ueye::FrameSet set;
+			double spread = 0.0;
+			Clock::time_point start = Clock::now();
+			while(Clock::now() - start < std::chrono::duration<double>(duration))
+			{
+				if(group.nextSet(set, 100))
+					spread += set.Spread;
+			}
+			double total = seconds(Clock::now() - start);
+			triggering = false;
+			trigger_thread.join();
+			set = ueye::FrameSet();
+			group.stop();
+
+			ueye::GroupStatistics stats = group.getStatistics();
+			std::cout<<(triggered ? "Software trigger" : "Free run")<<" : "<<stats.Sets/total<<" sets/s";
+			if(triggered)
+				std::cout<<" for "<<stats.Triggers/total<<" triggers/s";
+			std::cout<<", mean spread "<<(stats.Sets ? spread/stats.Sets*1e6 : 0.0)<<" us, max "<<stats.MaxSpread*1e6<<" us";
+			std::cout<<", unmatched frames "<<stats.Unmatched<<", late "<<stats.Late<<", dropped sets "<<stats.Dropped<<std::endl;
+		}
+		return 0;
+	}
+
+	// videoCaptureStart/videoCaptureStop cycles, with sequence buffers built
+	// from copies of a prototype or recycled through the camera memory pool
+	int benchRestart(int argc, char **argv)
+	{
+		size_t cycles = argc > 0 ? std::atoi(argv[0]) : 100;
+		size_t buffers = argc > 1 ? std::atoi(argv[1]) : 3;
+
+		ueye::Camera camera(0);
+		Clock::duration copy_time(0), pool_time(0);
+		for(size_t i=0; i<cycles; ++i)
+		{
+			Clock::time_point start = Clock::now();
+			std::vector<ueye::ImageMemory> buffer(buffers, ueye::ImageMemory(camera));
+			camera.videoCaptureStart(buffer);
+			camera.videoCaptureStop();
+			buffer.clear();
+			copy_time += Clock::now() - start;
+		}
+		std::vector<ueye::ImageMemory> buffer;
+		for(size_t i=0; i<cycles; ++i)
+		{
+			Clock::time_point start = Clock::now();
+			camera.memoryPool().acquire(buffer, buffers);
+			camera.videoCaptureStart(buffer);
+			camera.videoCaptureStop();
+			camera.memoryPool().release(buffer);
+			pool_time += Clock::now() - start;
+		}
+		std::cout<<"Prototype copies : "<<seconds(copy_time)/cycles*1e6<<" us/cycle"<<std::endl;
+		std::cout<<"Memory pool : "<<seconds(pool_time)/cycles*1e6<<" us/cycle, "<<camera.memoryPool().allocationCount()<<" allocations"<<std::endl;
+		return 0;
+	}
+
+	// leases across videoCaptureStop and the camera : the stop is refused while
+	// a frame or a view is leased, and leases outliving their camera are
+	// dropped without touching it. Exits with 1 when either is not handled.
+	int benchLease(int argc, char **argv)
+	{
+		int failures = 0;
+		std::unique_ptr<ueye::Camera> camera(new ueye::Camera(0));
+		camera->videoCaptureStart();
+		ueye::Frame frame = camera->nextFrame();
+		cv::Mat view = camera->waitNextView();
+		try
+		{
+			camera->videoCaptureStop();
+			std::cout<<"videoCaptureStop with leased frames : not refused"<<std::endl;
+			++failures;
+		}
+		catch(const ueye::Exception &e)
+		{
+			std::cout<<"videoCaptureStop with leased frames : refused, "<<e.what()<<std::endl;
+		}
+		// the leases and the stream are still usable
+		int checksum = frame.memory()->view().ptr<uint8_t>(0)[0] + view.ptr<uint8_t>(0)[0];
+		frame = camera->nextFrame();
+		frame.unlock();
+		view.release();
+		// a buffer held past the others through waitNextFrame is counted too
+		for(int i=0; i<5; ++i)
+			camera->nextFrame();
+		uint64_t late = camera->getStatistics().snapshot().UnlockedLate;
+		ueye::ImageMemory *memory = camera->waitNextFrame();
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		camera->unlockFrame(memory);
+		bool counted = camera->getStatistics().snapshot().UnlockedLate == late + 1;
+		std::cout<<"waitNextFrame held 200 ms : "<<(counted ? "unlocked late" : "NOT COUNTED")<<std::endl;
+		if(!counted)
+			++failures;
+		camera->videoCaptureStop();
+		std::cout<<"videoCaptureStop once released : stopped, checksum "<<checksum<<std::endl;
+
+		camera->videoCaptureStart();
+		size_t length = camera->getSequenceLength();
+		try
+		{
+			camera->videoCaptureStart();
+			std::cout<<"videoCaptureStart while capturing : not refused"<<std::endl;
+			++failures;
+		}
+		catch(const ueye::Exception &e)
+		{
+			bool kept = camera->getSequenceLength() == length && camera->nextFrame().valid();
+			std::cout<<"videoCaptureStart while capturing : refused, "<<(kept ? "capture kept" : "CAPTURE BROKEN")<<std::endl;
+			if(!kept)
+				++failures;
+		}
+		frame = camera->nextFrame();
+		view = camera->waitNextView();
+		camera.reset();
+		if(frame.valid())
+		{
+			std::cout<<"Frame outliving its camera : still valid"<<std::endl;
+			++failures;
+		}
+		frame = ueye::Frame();
+		view.release();
+		std::cout<<"Leases outliving their camera : released"<<std::endl;
+		return failures ? 1 : 0;
+	}
+
+	// copy (copyToMat) and scan throughput of a captured frame, in image
+	// memories from the SDK, a 64 bytes aligned heap and huge pages
+	int benchAlloc(int argc, char **argv)
+	{
+		size_t iterations = argc > 0 ? std::atoi(argv[0]) : 200;
+		int numa_node = argc > 1 ? std::atoi(argv[1]) : -1;
+
+		ueye::Camera camera(0);
+		ueye::AlignedAllocator aligned;
+		ueye::HugePageAllocator huge_pages(numa_node);
+		const char *names[] = {"is_AllocImageMem", "aligned", "huge pages"};
+		ueye::ImageAllocator *allocators[] = {NULL, &aligned, &huge_pages};
+		std::cout<<"Frame : "<<camera.getAOIWidth()<<"x"<<camera.getAOIHeight()<<std::endl;
+		for(size_t a=0; a<3; ++a)
+		{
+			ueye::ImageMemory memory = allocators[a] ? ueye::ImageMemory(camera, *allocators[a]) : ueye::ImageMemory(camera);
+			camera.imageCapture(memory);
+			size_t size = (size_t)memory.pitch()*memory.height();
+			cv::Mat mat;
+			memory.copyToMat(mat);
+
+			Clock::time_point start = Clock::now();
+			for(size_t i=0; i<iterations; ++i)
+				memory.copyToMat(mat);
+			double copy_time = seconds(Clock::now() - start);
+
+			// sum of 64 bits words, auto-vectorized by the compiler
+			uint64_t sum = 0;
+			start = Clock::now();
+			for(size_t i=0; i<iterations; ++i)
+			{
+				const uint64_t *words = reinterpret_cast<const uint64_t*>(memory.ptr());
+				for(size_t j=0; j<size/8; ++j)
+					sum += words[j];
+			}
+			double scan_time = seconds(Clock::now() - start);
+
+			std::cout<<names[a]<<" ("<<(reinterpret_cast<uintptr_t>(memory.ptr()) % 4096 == 0 ? "page" : reinterpret_cast<uintptr_t>(memory.ptr()) % 64 == 0 ? "64 bytes" : "unaligned")<<" aligned) : ";
+			std::cout<<"copy "<<size*iterations/copy_time/1e6<<" MB/s, scan "<<size*iterations/scan_time/1e6<<" MB/s (checksum "<<sum<<")"<<std::endl;
+		}
+		std::cout<<"Huge page allocations : "<<huge_pages.hugePageCount()<<", fallbacks to regular pages : "<<huge_pages.fallbackCount()<<std::endl;
+		return 0;
+	}
+
+	// camera owned sequence sized for a short hold time, with a consumer
+	// stalling regularly : the sequence grows until the stalls stop losing frames
+	int benchAdaptive(int argc, char **argv)
+	{
+		double duration = argc > 0 ? std::atof(argv[0]) : 5.0;
+		double stall = argc > 1 ? std::atof(argv[1]) : 0.02;
+		size_t stall_period = argc > 2 ? std::atoi(argv[2]) : 100;
+
+		ueye::Camera camera(0);
+		setMaxFrameRate(camera);
+		ueye::SequenceSizing sizing;
+		sizing.HoldTime = 0;
+		camera.videoCaptureStart(sizing);
+		std::cout<<"FrameRate : "<<camera.getFrameRate()<<", initial sequence : "<<camera.getSequenceLength()<<" buffers"<<std::endl;
+
+		ueye::Frame frame;
+		size_t frames = 0;
+		uint64_t lost = 0;
+		Clock::time_point start = Clock::now();
+		Clock::time_point next_report = start + std::chrono::seconds(1);
+		while(Clock::now() - start < std::chrono::duration<double>(duration))
+		{
+			INT err = camera.tryWaitNextFrame(frame);
+			if(err != IS_SUCCESS && err != IS_CAPTURE_STATUS)
+				throw ueye::Exception(camera.handle(), err, "tryWaitNextFrame");
+			if(err == IS_SUCCESS && ++frames % stall_period == 0)
+				std::this_thread::sleep_for(std::chrono::duration<double>(stall));
+			if(Clock::now() >= next_report)
+			{
+				uint64_t total_lost = camera.getLostFrameCount();
+				std::cout<<"  sequence : "<<camera.getSequenceLength()<<" buffers, lost frames : "<<total_lost - lost<<std::endl;
+				lost = total_lost;
+				next_report += std::chrono::seconds(1);
+			}
+		}
+		frame.unlock();
+		camera.videoCaptureStop();
+		std::cout<<"Frames : "<<frames<<", lost : "<<camera.getLostFrameCount()<<", sequence grown "<<camera.getSequenceGrowCount()<<" times"<<std::endl;
+		return 0;
+	}
+
+	// SDK calls and time of the timing setters, as driven by the GUI sliders :
+	// exposure changes with the exposure range read back, and pixel clock changes
+	int benchTiming(int argc, char **argv)
+	{
+		size_t iterations = argc > 0 ? std::atoi(argv[0]) : 1000;
+
+		ueye::Camera camera(0);
+		ueye::Range<double> exposure_range = camera.getExposureRange();
+		uint64_t calls = camera.getSdkCallCount();
+		Clock::time_point start = Clock::now();
+		for(size_t i=0; i<iterations; ++i)
+		{
+			camera.setExposure(exposure_range.min() + (exposure_range.max()-exposure_range.min())*(i%100)/100.0);
+			exposure_range = camera.getExposureRange();
+		}
+		double exposure_time = seconds(Clock::now() - start);
+		uint64_t exposure_calls = camera.getSdkCallCount() - calls;
+
+		std::vector<uint32_t> pixel_clocks = camera.getPixelClockList();
+		calls = camera.getSdkCallCount();
+		start = Clock::now();
+		for(size_t i=0; i<iterations; ++i)
+		{
+			camera.setPixelClock(pixel_clocks[i%pixel_clocks.size()]);
+			camera.getFrameTimeRange();
+		}
+		double pixel_clock_time = seconds(Clock::now() - start);
+		uint64_t pixel_clock_calls = camera.getSdkCallCount() - calls;
+
+		calls = camera.getSdkCallCount();
+		start = Clock::now();
+		for(size_t i=0; i<iterations; ++i)
+			camera.timing().pixelClock(pixel_clocks[i%pixel_clocks.size()]).maxFrameRate().maxExposure().commit();
+		double transaction_time = seconds(Clock::now() - start);
+		uint64_t transaction_calls = camera.getSdkCallCount() - calls;
+
+		std::cout<<"setExposure : "<<exposure_time/iterations*1e6<<" us, "<<(double)exposure_calls/iterations<<" SDK calls"<<std::endl;
+		std::cout<<"setPixelClock : "<<pixel_clock_time/iterations*1e6<<" us, "<<(double)pixel_clock_calls/iterations<<" SDK calls"<<std::endl;
+		std::cout<<"TimingTransaction : "<<transaction_time/iterations*1e6<<" us, "<<(double)transaction_calls/iterations<<" SDK calls"<<std::endl;
+		return 0;
+	}
+
+	double measureFrameRate(ueye::Camera &camera, size_t frames)
+	{
+		camera.nextFrame().unlock();
+		Clock::time_point start = Clock::now();
+		for(size_t i=0; i<frames; ++i)
+			camera.nextFrame().unlock();
+		return frames/seconds(Clock::now() - start);
+	}
+
+	// frame rate with the full and a quarter AOI, cost of a stream restarting
+	// AOI change, and latency of in-stream AOI moves : time of the call, and
+	// until the second frame after it, the first one started after the move
+	int benchAOI(int argc, char **argv)
+	{
+		size_t frames = argc > 0 ? std::atoi(argv[0]) : 300;
+		size_t moves = argc > 1 ? std::atoi(argv[1]) : 100;
+
+		ueye::Camera camera(0);
+		setMaxFrameRate(camera);
+		int32_t width = camera.getAOIWidth(), height = camera.getAOIHeight();
+		camera.videoCaptureStart(ueye::SequenceSizing());
+		std::cout<<"AOI "<<width<<"x"<<height<<" : "<<measureFrameRate(camera, frames)<<" fps"<<std::endl;
+
+		Clock::time_point start = Clock::now();
+		camera.setAOI(width/4, height/4, width/2, height/2);
+		double set_time = seconds(Clock::now() - start);
+		setMaxFrameRate(camera);
+		std::cout<<"AOI "<<camera.getAOIWidth()<<"x"<<camera.getAOIHeight()<<" : "<<measureFrameRate(camera, frames)<<" fps, setAOI "<<set_time*1e3<<" ms"<<std::endl;
+
+		double call_time = 0, latency = 0, max_latency = 0;
+		bool fast = true;
+		for(size_t i=0; i<moves; ++i)
+		{
+			start = Clock::now();
+			fast = camera.setAOIPosition((i%2) ? width/4 : width/2, height/4) && fast;
+			call_time += seconds(Clock::now() - start);
+			camera.nextFrame().unlock();
+			ueye::Frame frame = camera.nextFrame();
+			double move_latency = seconds(frame.info().HostTimestamp - start);
+			latency += move_latency;
+			max_latency = std::max(max_latency, move_latency);
+		}
+		std::cout<<"setAOIPosition ("<<(fast ? "fast" : "restart")<<") : "<<call_time/moves*1e6<<" us/call, latency "<<latency/moves*1e3<<" ms mean, "<<max_latency*1e3<<" ms max"<<std::endl;
+
+		camera.setAOI(0, 0, width, height);
+		std::cout<<"Sequence : "<<camera.getSequenceLength()<<" buffers, lost frames : "<<camera.getLostFrameCount()<<std::endl;
+		camera.videoCaptureStop();
+		return 0;
+	}
+
+	// frame rate and bandwidth with each binning and subsampling mode, switched
+	// while capturing
+	int benchDecimation(int argc, char **argv)
+	{
+		size_t frames = argc > 0 ? std::atoi(argv[0]) : 300;
+
+		ueye::Camera camera(0);
+		struct Mode
+		{
+			const char *Name;
+			INT Binning;
+			INT Subsampling;
+		};
+		const Mode modes[] = {
+			{"full", IS_BINNING_DISABLE, IS_SUBSAMPLING_DISABLE},
+			{"binning 2x2", camera.binningMode(2, 2), IS_SUBSAMPLING_DISABLE},
+			{"subsampling 2x2", IS_BINNING_DISABLE, camera.subsamplingMode(2, 2)},
+			{"binning 2x2 + subsampling 2x2", camera.binningMode(2, 2), camera.subsamplingMode(2, 2)},
+			{"full", IS_BINNING_DISABLE, IS_SUBSAMPLING_DISABLE}
+		};
+		camera.videoCaptureStart(ueye::SequenceSizing());
+		for(size_t i=0; i<sizeof(modes)/sizeof(modes[0]); ++i)
+		{
+			if(modes[i].Binning < 0 || modes[i].Subsampling < 0)
+			{
+				std::cout<<modes[i].Name<<" : not supported"<<std::endl;
+				continue;
+			}
+			Clock::time_point start = Clock::now();
+			// disable first, so that the combination of both is never invalid
+			if(modes[i].Binning == IS_BINNING_DISABLE)
+				camera.setBinning(modes[i].Binning);
+			if(modes[i].Subsampling == IS_SUBSAMPLING_DISABLE)
+				camera.setSubsampling(modes[i].Subsampling);
+			camera.setBinning(modes[i].Binning);
+			camera.setSubsampling(modes[i].Subsampling);
+			double switch_time = seconds(Clock::now() - start);
+			setMaxFrameRate(camera);
+			double fps = measureFrameRate(camera, frames);
+			cv::Mat view = camera.nextFrame().memory()->view();
+			double frame_size = view.total()*view.elemSize();
+			std::cout<<modes[i].Name<<" : "<<camera.getAOIWidth()<<"x"<<camera.getAOIHeight()<<", "<<fps<<" fps, "<<fps*frame_size/1e6<<" MB/s, switch "<<switch_time*1e3<<" ms"<<std::endl;
+		}
+		std::cout<<"Sequence : "<<camera.getSequenceLength()<<" buffers, lost frames : "<<camera.getLostFrameCount()<<std::endl;
+
+		// a mode the sensor rejects leaves the stream as it was
+		size_t length = camera.getSequenceLength();
+		bool rejected = false;
+		try
+		{
+			camera.setBinning(IS_BINNING_3X_HORIZONTAL | IS_BINNING_3X_VERTICAL);
+		}
+		catch(const ueye::Exception&)
+		{
+			rejected = true;
+		}
+		bool restored = camera.getSequenceLength() == length && camera.getDecimationX() == 1;
+		if(restored)
+			camera.nextFrame();
+		std::cout<<"binning 3x3 : "<<(rejected ? "rejected" : "accepted")<<", capture "<<(restored ? "restored" : "NOT RESTORED")<<std::endl;
+		camera.videoCaptureStop();
+		return restored ? 0 : 1;
+	}
+
+	// Demosaicing cost by method, instruction set and thread count on a random
+	// mosaic, failing when a result differs from the scalar one ; then capture
+	// with the SDK delivering BGR8 compared to RAW8 demosaiced on the host
+	int benchDemosaic(int argc, char **argv)
+	{
+		size_t iterations = argc > 0 ? std::atoi(argv[0]) : 50;
+		size_t workers = argc > 1 ? std::atoi(argv[1]) : std::thread::hardware_concurrency();
+
+		ueye::WorkerPool pool(workers);
+		int failures = 0;
+		const int depths[] = {CV_8U, CV_16U};
+		const ueye::DemosaicMethod methods[] = {ueye::DEMOSAIC_BILINEAR, ueye::DEMOSAIC_EDGE_AWARE};
+		const char *method_names[] = {"bilinear", "edge-aware"};
+		uint32_t seed = 1;
+		for(size_t d=0; d<2; ++d)
+		{
+			cv::Mat raw(1024, 1280, CV_MAKETYPE(depths[d], 1));
+			for(int y=0; y<raw.rows; ++y)
+			{
+				for(int x=0; x<raw.cols; ++x)
+				{
+					seed = seed*1664525u + 1013904223u;
+					if(depths[d] == CV_8U)
+						raw.ptr<uint8_t>(y)[x] = seed >> 24;
+					else
+						raw.ptr<uint16_t>(y)[x] = seed >> 20;
+				}
+			}
+			for(size_t m=0; m<2; ++m)
+			{
+				cv::Mat reference;
+				ueye::Demosaicer(methods[m]).convert(raw, reference, ueye::BAYER_RGGB);
+				for(int level=ueye::SIMD_NONE; level<=ueye::supportedSimd(); ++level)
+				{
+					for(int threaded=0; threaded<2; ++threaded)
+					{
+						ueye::Demosaicer demosaicer(methods[m], threaded ? &pool : NULL);
+						demosaicer.setSimd(ueye::SimdLevel(level));
+						cv::Mat bgr;
+						demosaicer.convert(raw, bgr, ueye::BAYER_RGGB);
+						Clock::time_point start = Clock::now();
+						for(size_t i=0; i<iterations; ++i)
+							demosaicer.convert(raw, bgr, ueye::BAYER_RGGB);
+						double time = seconds(Clock::now() - start)/iterations;
+						bool identical = true;
+						for(int y=0; y<bgr.rows && identical; ++y)
+							identical = std::memcmp(bgr.ptr(y), reference.ptr(y), bgr.cols*bgr.elemSize()) == 0;
+						std::cout<<(depths[d] == CV_8U ? "8" : "16")<<" bit "<<method_names[m]<<" "<<ueye::simdName(ueye::SimdLevel(level))<<" "<<(threaded ? pool.size()+1 : 1)<<" thread(s) : ";
+						std::cout<<time*1e3<<" ms/frame, "<<raw.total()/time/1e6<<" Mpixel/s"<<(identical ? "" : ", DIFFERS FROM SCALAR")<<std::endl;
+						if(!identical)
+							++failures;
+					}
+				}
+			}
+		}
+
+		ueye::Camera camera(0);
+		ueye::Demosaicer demosaicer(ueye::DEMOSAIC_BILINEAR, &pool);
+		const int32_t modes[] = {IS_CM_BGR8_PACKED, IS_CM_SENSOR_RAW8};
+		for(size_t i=0; i<2; ++i)
+		{
+			camera.setColorMode(modes[i]);
+			setMaxFrameRate(camera);
+			camera.videoCaptureStart(ueye::SequenceSizing());
+			ueye::BayerPattern pattern = ueye::bayerPattern(camera);
+			cv::Mat bgr;
+			size_t frames = 0;
+			double convert_time = 0, bytes = 0;
+			Clock::time_point start = Clock::now();
+			while(seconds(Clock::now() - start) < 2.0)
+			{
+				ueye::Frame frame = camera.nextFrame();
+				bytes += frame.memory()->pitch() * frame.memory()->height();
+				Clock::time_point convert_start = Clock::now();
+				if(modes[i] == IS_CM_SENSOR_RAW8)
+					demosaicer.convert(*frame.memory(), bgr, pattern);
+				else
+					frame.memory()->copyToMat(bgr);
+				convert_time += seconds(Clock::now() - convert_start);
+				++frames;
+			}
+			double total = seconds(Clock::now() - start);
+			std::cout<<(modes[i] == IS_CM_SENSOR_RAW8 ? "RAW8 + host demosaic" : "BGR8 from the SDK")<<" : "<<frames/total<<" fps, "<<bytes/total/1e6<<" MB/s transferred, ";
+			std::cout<<convert_time/frames*1e3<<" ms/frame to BGR Mat, lost frames : "<<camera.getLostFrameCount()<<std::endl;
+			camera.videoCaptureStop();
+		}
+		return failures ? 1 : 0;
+	}
+
+	// Unpacking cost of 10, 12 and 16 bit images to 16 bit and to an 8 bit
+	// window, by instruction set and thread count, failing when a result
+	// differs from the scalar one ; then capture of MONO12 unpacked by the SDK
+	// compared to the packed source unpacked on the host
+	int benchUnpack(int argc, char **argv)
+	{
+		size_t iterations = argc > 0 ? std::atoi(argv[0]) : 50;
+		size_t workers = argc > 1 ? std::atoi(argv[1]) : std::thread::hardware_concurrency();
+
+		ueye::WorkerPool pool(workers);
+		int failures = 0;
+		const int width = 1280, height = 1024;
+		const int depths[] = {10, 12, 16};
+		uint32_t seed = 1;
+		for(size_t d=0; d<3; ++d)
+		{
+			int bits = depths[d];
+			cv::Mat packed = bits == 16 ? cv::Mat(height, width, CV_16UC1) : cv::Mat(height, (width*bits+7)/8, CV_8UC1);
+			for(int y=0; y<packed.rows; ++y)
+			{
+				for(size_t x=0; x<packed.cols*packed.elemSize(); ++x)
+				{
+					seed = seed*1664525u + 1013904223u;
+					packed.ptr(y)[x] = seed >> 24;
+				}
+			}
+			for(int window=0; window<2; ++window)
+			{
+				int shift = bits - 8;
+				cv::Mat reference;
+				ueye::Unpacker scalar;
+				scalar.setSimd(ueye::SIMD_NONE);
+				if(window)
+					scalar.unpack(packed, bits, width, reference, shift);
+				else
+					scalar.unpack(packed, bits, width, reference);
+				for(int level=ueye::SIMD_NONE; level<=ueye::supportedSimd(); ++level)
+				{
+					for(int threaded=0; threaded<2; ++threaded)
+					{
+						ueye::Unpacker unpacker(threaded ? &pool : NULL);
+						unpacker.setSimd(ueye::SimdLevel(level));
+						cv::Mat unpacked;
+						Clock::time_point start = Clock::now();
+						for(size_t i=0; i<iterations; ++i)
+						{
+							if(window)
+								unpacker.unpack(packed, bits, width, unpacked, shift);
+							else
+								unpacker.unpack(packed, bits, width, unpacked);
+						}
+						double time = seconds(Clock::now() - start)/iterations;
+						bool identical = true;
+						for(int y=0; y<unpacked.rows && identical; ++y)
+							identical = std::memcmp(unpacked.ptr(y), reference.ptr(y), unpacked.cols*unpacked.elemSize()) == 0;
+						std::cout<<bits<<" bit to "<<(window ? "8" : "16")<<" bit "<<ueye::simdName(ueye::SimdLevel(level))<<" "<<(threaded ? pool.size()+1 : 1)<<" thread(s) : ";
+						std::cout<<time*1e3<<" ms/frame, "<<(double)width*height/time/1e6<<" Mpixel/s"<<(identical ? "" : ", DIFFERS FROM SCALAR")<<std::endl;
+						if(!identical)
+							++failures;
+					}
+				}
+			}
+		}
+
+		ueye::Camera camera(0);
+		ueye::Unpacker unpacker(&pool);
+		const int32_t modes[] = {IS_CM_MONO12, IS_CM_MONO12 | IS_CM_PREFER_PACKED_SOURCE_FORMAT};
+		for(size_t i=0; i<2; ++i)
+		{
+			camera.setColorMode(modes[i]);
+			setMaxFrameRate(camera);
+			camera.videoCaptureStart(ueye::SequenceSizing());
+			cv::Mat unpacked;
+			size_t frames = 0;
+			double convert_time = 0, bytes = 0;
+			Clock::time_point start = Clock::now();
+			while(seconds(Clock::now() - start) < 2.0)
+			{
+				ueye::Frame frame = camera.nextFrame();
+				bytes += frame.memory()->pitch() * frame.memory()->height();
+				Clock::time_point convert_start = Clock::now();
+				unpacker.unpack(*frame.memory(), unpacked);
+				convert_time += seconds(Clock::now() - convert_start);
+				++frames;
+			}
+			double total = seconds(Clock::now() - start);
+			std::cout<<(i ? "MONO12 packed + host unpack" : "MONO12 from the SDK")<<" : "<<frames/total<<" fps, "<<bytes/total/1e6<<" MB/s transferred, ";
+			std::cout<<convert_time/frames*1e3<<" ms/frame to 16 bit Mat, lost frames : "<<camera.getLostFrameCount()<<std::endl;
+			camera.videoCaptureStop();
+		}
+		return failures ? 1 : 0;
+	}
+
+	// copyToMat with a conversion to BGR, gray and BGRA, done in one pass or
+	// after a native copy, by instruction set, failing when a result differs
+	// from the scalar one, on frames captured in planar RGB, UYVY and BGR565
+	int benchFormats(int argc, char **argv)
+	{
+		size_t iterations = argc > 0 ? std::atoi(argv[0]) : 100;
+
+		ueye::Camera camera(0);
+		int failures = 0;
+		const struct
+		{
+			int32_t Mode;
+			const char *Name;
+		} modes[] = {
+			{IS_CM_RGB8_PLANAR, "RGB8 planar"},
+			{IS_CM_UYVY_PACKED, "UYVY"},
+			{IS_CM_BGR565_PACKED, "BGR565"},
+		};
+		const ueye::MatFormat formats[] = {ueye::MAT_BGR, ueye::MAT_GRAY, ueye::MAT_BGRA};
+		const char *format_names[] = {"BGR", "gray", "BGRA"};
+		for(size_t i=0; i<sizeof(modes)/sizeof(modes[0]); ++i)
+		{
+			camera.setColorMode(modes[i].Mode);
+			camera.videoCaptureStart(ueye::SequenceSizing());
+			ueye::Frame frame = camera.nextFrame();
+			const ueye::ImageMemory &memory = *frame.memory();
+			for(size_t f=0; f<3; ++f)
+			{
+				cv::Mat reference;
+				ueye::FormatConverter scalar;
+				scalar.setSimd(ueye::SIMD_NONE);
+				scalar.convert(memory, reference, formats[f]);
+				for(int level=ueye::SIMD_NONE; level<=ueye::supportedSimd(); ++level)
+				{
+					ueye::FormatConverter converter;
+					converter.setSimd(ueye::SimdLevel(level));
+					cv::Mat native, converted;
+					Clock::time_point start = Clock::now();
+					for(size_t n=0; n<iterations; ++n)
+					{
+						memory.copyToMat(native);
+						converter.convert(native, memory.colorMode(), converted, formats[f]);
+					}
+					double two_pass = seconds(Clock::now() - start)/iterations;
+					start = Clock::now();
+					for(size_t n=0; n<iterations; ++n)
+						converter.convert(memory, converted, formats[f]);
+					double one_pass = seconds(Clock::now() - start)/iterations;
+					bool identical = true;
+					for(int y=0; y<converted.rows && identical; ++y)
+						identical = std::memcmp(converted.ptr(y), reference.ptr(y), converted.cols*converted.elemSize()) == 0;
+					std::cout<<modes[i].Name<<" to "<<format_names[f]<<" "<<ueye::simdName(ueye::SimdLevel(level))<<" : copy then convert "<<two_pass*1e3<<" ms, ";
+					std::cout<<"during the copy "<<one_pass*1e3<<" ms, "<<memory.width()*memory.height()/one_pass/1e6<<" Mpixel/s"<<(identical ? "" : ", DIFFERS FROM SCALAR")<<std::endl;
+					if(!identical)
+						++failures;
+				}
+			}
+			frame = ueye::Frame();
+			camera.videoCaptureStop();
+		}
+		return failures ? 1 : 0;
+	}
+
+	// statistics with the layout read from the color mode at every pixel, as
+	// without the format traits
+	void genericStatistics(const ueye::ImageMemory &memory, ueye::ImageStatistics &statistics)
+	{
+		ueye::PixelFormat format = ueye::pixelFormat(memory.colorMode());
+		ueye::PixelPacking packing = ueye::pixelPacking(memory.colorMode());
+		int bits = memory.bitsPerPixel();
+		cv::Mat view = memory.view();
+		size_t plane_step = view.step*memory.height();
+		statistics.Channels = packing == ueye::PACKING_BITS ? 1 : format.Channels;
+		for(int c=0; c<4; ++c)
+		{
+			statistics.Count[c] = statistics.Sum[c] = 0;
+			statistics.Min[c] = 0xFFFFFFFF;
+			statistics.Max[c] = 0;
+		}
+		for(uint32_t y=0; y<memory.height(); ++y)
+		{
+			const unsigned char *line = view.ptr(y);
+			for(uint32_t x=0; x<memory.width(); ++x)
+			{
+				for(int c=0; c<statistics.Channels; ++c)
+				{
+					unsigned int value;
+					switch(packing)
+					{
+						case ueye::PACKING_BITS:
+						{
+							size_t bit = (size_t)x*bits;
+							value = ((line[bit/8] | line[bit/8+1] << 8) >> (bit%8)) & ((1 << bits) - 1);
+							break;
+						}
+						case ueye::PACKING_PLANAR:
+							value = line[c*plane_step + x];
+							break;
+						case ueye::PACKING_YUV422:
+							if(c > 0 && (x & 1))
+								continue;
+							value = line[c == 0 ? 2*x+1 : c == 1 ? 2*x : 2*x+2];
+							break;
+						default:
+							value = format.Depth == CV_16U ? reinterpret_cast<const uint16_t*>(line)[format.Channels*x+c] : line[format.Channels*x+c];
+							break;
+					}
+					++statistics.Count[c];
+					statistics.Sum[c] += value;
+					statistics.Min[c] = std::min(statistics.Min[c], value);
+					statistics.Max[c] = std::max(statistics.Max[c], value);
+				}
+			}
+		}
+	}
+
+	// per frame statistics with the kernels of the color mode chosen once,
+	// against the generic loop branching on the layout, failing when they
+	// disagree ; the kernels only pay off once inlined, so the timings of an
+	// unoptimized build are not representative
+	int benchTraits(int argc, char **argv)
+	{
+		size_t iterations = argc > 0 ? std::atoi(argv[0]) : 50;
+		size_t workers = argc > 1 ? std::atoi(argv[1]) : std::thread::hardware_concurrency();
+
+		ueye::WorkerPool pool(workers);
+		ueye::Camera camera(0);
+		const struct
+		{
+			int32_t Mode;
+			const char *Name;
+		} modes[] = {
+			{IS_CM_MONO8, "MONO8"},
+			{IS_CM_MONO16, "MONO16"},
+			{IS_CM_MONO12 | IS_CM_PREFER_PACKED_SOURCE_FORMAT, "MONO12 packed"},
+			{IS_CM_BGR8_PACKED, "BGR8"},
+			{IS_CM_RGB8_PLANAR, "RGB8 planar"},
+			{IS_CM_UYVY_PACKED, "UYVY"},
+		};
+#ifndef __OPTIMIZE__
+		std::cout<<"unoptimized build, timings not representative"<<std::endl;
+#endif
+		int failures = 0;
+		for(size_t i=0; i<sizeof(modes)/sizeof(modes[0]); ++i)
+		{
+			camera.setColorMode(modes[i].Mode);
+			camera.videoCaptureStart(ueye::SequenceSizing());
+			ueye::Frame frame = camera.nextFrame();
+			const ueye::ImageMemory &memory = *frame.memory();
+
+			ueye::ImageStatistics generic, specialized;
+			Clock::time_point start = Clock::now();
+			for(size_t n=0; n<iterations; ++n)
+				genericStatistics(memory, generic);
+			double generic_time = seconds(Clock::now() - start)/iterations;
+			std::cout<<modes[i].Name<<" : generic "<<generic_time*1e3<<" ms";
+			for(int threaded=0; threaded<2; ++threaded)
+			{
+				// once per stream
+				ueye::FormatKernels kernels(memory.colorMode(), threaded ? &pool : NULL);
+				start = Clock::now();
+				for(size_t n=0; n<iterations; ++n)
+					kernels.statistics(memory, specialized);
+				double time = seconds(Clock::now() - start)/iterations;
+				std::cout<<", specialized "<<(threaded ? pool.size()+1 : 1)<<" thread(s) "<<time*1e3<<" ms";
+			}
+			bool identical = generic.Channels == specialized.Channels;
+			for(int c=0; c<generic.Channels && identical; ++c)
+				identical = generic.Count[c] == specialized.Count[c] && generic.Sum[c] == specialized.Sum[c] && generic.Min[c] == specialized.Min[c] && generic.Max[c] == specialized.Max[c];
+			std::cout<<", mean";
+			for(int c=0; c<specialized.Channels; ++c)
+				std::cout<<" "<<specialized.mean(c);
+			std::cout<<(identical ? "" : ", DIFFERS FROM GENERIC")<<std::endl;
+			if(!identical)
+				++failures;
+			frame = ueye::Frame();
+			camera.videoCaptureStop();
+		}
+		return failures ? 1 : 0;
+	}
+
+	// camera at its highest frame rate published to subscribers forked
+	// processes : cost of the copy into the ring on the capture side, then the
+	// frames, gaps and latency seen by each subscriber ; with stall_ms, the
+	// first subscriber takes that long per frame, and only it should lose
+	// frames
+	int subscribeFrames(const char *name, int index, int stall_ms)
+	{
+		ueye::SharedFrameSubscriber subscriber(name);
+		ueye::SharedFrame frame;
+		size_t frames = 0, gaps = 0, lost = 0;
+		uint64_t previous = 0, checksum = 0;
+		double latency = 0.0, max_latency = 0.0;
+		for(;;)
+		{
+			int err = subscriber.tryWaitNextFrame(frame, 5000);
+			if(err != IS_SUCCESS)
+				break;
+			if(index == 0 && stall_ms > 0)
+				std::this_thread::sleep_for(std::chrono::milliseconds(stall_ms));
+			double elapsed = seconds(Clock::now() - frame.info().HostTimestamp);
+			latency += elapsed;
+			max_latency = std::max(max_latency, elapsed);
+			cv::Mat view = frame.view();
+			checksum += view.ptr<uint8_t>(view.rows/2)[view.cols/2];
+			if(frames && frame.info().FrameNumber != previous + 1 + frame.info().LostBefore)
+				++gaps;
+			previous = frame.info().FrameNumber;
+			lost += frame.info().LostBefore;
+			++frames;
+		}
+		std::cout<<"Subscriber "<<index<<" : "<<frames<<" frames, lost : "<<lost<<", gaps : "<<gaps<<", latency : "
+			<<(frames ? latency/frames*1e3 : 0.0)<<" ms mean, "<<max_latency*1e3<<" ms max, checksum : "<<checksum<<std::endl;
+		return gaps ? 1 : 0;
+	}
+
+	int benchShm(int argc, char **argv)
+	{
+		double duration = argc > 0 ? std::atof(argv[0]) : 5.0;
+		int subscribers = argc > 1 ? std::atoi(argv[1]) : 2;
+		size_t slots = argc > 2 ? std::atoi(argv[2]) : 8;
+		int stall_ms = argc > 3 ? std::atoi(argv[3]) : 0;
+		const char *name = "/ueye_bench";
+
+		// subscribers are forked before the camera is opened, the SDK state is
+		// not meant to be shared with children
+		std::unique_ptr<ueye::SharedFramePublisher> publisher;
+		{
+			ueye::Camera camera(0);
+			setMaxFrameRate(camera);
+			ueye::ImageMemory prototype(camera);
+			publisher.reset(new ueye::SharedFramePublisher(name, ueye::Recorder::frameBytes(prototype), slots));
+		}
+		std::cout.flush();
+		std::vector<pid_t> children;
+		for(int i=0; i<subscribers; ++i)
+		{
+			pid_t pid = ::fork();
+			if(pid < 0)
+				throw std::system_error(errno, std::system_category(), "fork");
+			if(pid == 0)
+			{
+				int status = 1;
+				try
+				{
+					status = subscribeFrames(name, i, stall_ms);
+				}
+				catch(const std::exception &e)
+				{
+					std::cerr<<"Subscriber "<<i<<" : "<<e.what()<<std::endl;
+				}
+				std::cout.flush();
+				::_exit(status);
+			}
+			children.push_back(pid);
+		}
+		Clock::time_point wait_start = Clock::now();
+		while(publisher->getStatistics().Subscribers < (size_t)subscribers && Clock::now() - wait_start < std::chrono::seconds(5))
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		ueye::Camera camera(0);
+		setMaxFrameRate(camera);
+		std::cout<<"FrameRate : "<<camera.getFrameRate()<<", subscribers : "<<publisher->getStatistics().Subscribers<<", slots : "<<slots<<std::endl;
+		camera.videoCaptureStart();
+		ueye::Frame frame;
+		double publish_time = 0.0, max_publish_time = 0.0;
+		size_t publishes = 0;
+		Clock::time_point start = Clock::now();
+		while(Clock::now() - start < std::chrono::duration<double>(duration))
+		{
+			INT err = camera.tryWaitNextFrame(frame);
+			if(err == IS_CAPTURE_STATUS)
+				continue;
+			if(err != IS_SUCCESS)
+				throw ueye::Exception(camera.handle(), err, "tryWaitNextFrame");
+			Clock::time_point publish_start = Clock::now();
+			publisher->publish(frame);
+			frame = ueye::Frame();
+			double elapsed = seconds(Clock::now() - publish_start);
+			publish_time += elapsed;
+			max_publish_time = std::max(max_publish_time, elapsed);
+			++publishes;
+		}
+		camera.videoCaptureStop();
+		ueye::PublisherStatistics stats = publisher->getStatistics();
+		ueye::CaptureStatistics::Snapshot capture = camera.getStatistics().snapshot();
+		std::cout<<"Captured : "<<capture.Delivered<<" frames, lost : "<<capture.Lost<<std::endl;
+		std::cout<<"Publish : "<<publish_time/publishes*1e3<<" ms mean, "<<max_publish_time*1e3<<" ms max, published : "
+			<<stats.Published<<", dropped : "<<stats.Dropped<<std::endl;
+		std::cout.flush();
+		// subscribers drain the ring, then see it closed
+		publisher.reset();
+		int failed = 0;
+		for(size_t i=0; i<children.size(); ++i)
+		{
+			int status = 0;
+			::waitpid(children[i], &status, 0);
+			if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+				++failed;
+		}
+		return failed ? 1 : 0;
+	}
+
+	struct Benchmark
+	{
+		const char *Name;
+		const char *Arguments;
+		int (*Run)(int argc, char **argv);
+	};
+
+	const Benchmark Benchmarks[] = {
+		{"capture", "[frames=1000] [buffers=3]", benchCapture},
+		{"view", "[frames=1000] [buffers=3]", benchView},
+		{"alloc", "[iterations=200] [numa_node=-1]", benchAlloc},
+		{"timing", "[iterations=1000]", benchTiming},
+		{"aoi", "[frames=300] [moves=100]", benchAOI},
+		{"decimation", "[frames=300]", benchDecimation},
+		{"demosaic", "[iterations=50] [workers=hardware threads]", benchDemosaic},
+		{"unpack", "[iterations=50] [workers=hardware threads]", benchUnpack},
+		{"formats", "[iterations=100]", benchFormats},
+		{"traits", "[iterations=50] [workers=hardware threads]", benchTraits},
+		{"restart", "[cycles=100] [buffers=3]", benchRestart},
+		{"lease", "", benchLease},
+		{"adaptive", "[seconds=5] [stall=0.02] [stall_period=100]", benchAdaptive},
+		{"dispatch", "[seconds=5] [workers=2] [buffers=4]", benchDispatch},
+		{"record", "[path=ueye_bench.rec] [seconds=5] [staging=16] [direct_io=1] [compress=0]", benchRecord},
+		{"codec", "[iterations=20] [workers=hardware threads] [noise=16]", benchCodec},
+		{"playback", "[path=ueye_bench.rec] [real_time_frames=100]", benchPlayback},
+		{"history", "[path=ueye_bench_event.rec] [history_seconds=1] [post_seconds=1] [seconds=4]", benchHistory},
+		{"trigger", "[shots=100] [burst=1] [delay_us=0]", benchTrigger},
+		{"group", "[seconds=5] [trigger_rate=20] [tolerance=0.002]", benchGroup},
+		{"shm", "[seconds=5] [subscribers=2] [slots=8] [stall_ms=0]", benchShm},
+	};
+}
+
+int main(int argc, char **argv)
+{
+	for(size_t i=0; argc > 1 && i<sizeof(Benchmarks)/sizeof(Benchmarks[0]); ++i)
+	{
+		if(std::strcmp(argv[1], Benchmarks[i].Name) == 0)
+			return Benchmarks[i].Run(argc-2, argv+2);
+	}
+	std::cerr<<"Usage :"<<std::endl;
+	for(size_t i=0; i<sizeof(Benchmarks)/sizeof(Benchmarks[0]); ++i)
+		std::cerr<<"  "<<argv[0]<<" "<<Benchmarks[i].Name<<" "<<Benchmarks[i].Arguments<<std::endl;
+	return 1;
+}
@@ -8,20 +8,19 @@ int main(int argc, char **argv)
 	is_SetErrorReport(0, IS_ENABLE_ERR_REP);
 	ueye::Camera ueye_camera(0);
 	
-	std::vector<ueye::ImageMemory> buffer(2, ueye::ImageMemory(ueye_camera));
-	ueye_camera.videoCaptureStart(buffer);
-	ueye_camera.setPixelClock(ueye_camera.getPixelClockRange().max());
-	ueye_camera.setFrameRate(1.0/ueye_camera.getFrameTimeRange().min());
-	ueye_camera.setExposure(ueye_camera.getExposureRange().max());
-	std::cout<<"Pixel clock : "<<ueye_camera.getPixelClock()<<std::endl;
-	std::cout<<"FrameRate : "<<ueye_camera.getFrameRate()<<std::endl;
-	std::cout<<"Exposure : "<<ueye_camera.getExposure()<<std::endl;
-	cv::Mat mat;
+	ueye::TimingSettings timing = ueye_camera.timing().maxPixelClock().maxFrameRate().maxExposure().commit();
+	// the sequence is sized from the frame rate, set before starting
+	ueye::SequenceSizing sizing;
+	sizing.HoldTime = 0.02;
+	ueye_camera.videoCaptureStart(sizing);
+	std::cout<<"Pixel clock : "<<timing.PixelClock<<std::endl;
+	std::cout<<"FrameRate : "<<timing.FrameRate<<std::endl;
+	std::cout<<"Exposure : "<<timing.Exposure<<std::endl;
+	std::cout<<"Sequence : "<<ueye_camera.getSequenceLength()<<" buffers"<<std::endl;
 	while(1)
 	{
-		ueye::ImageMemory *frame = ueye_camera.waitNextFrame();
-		frame->copyToMat(mat);
-		ueye_camera.unlockFrame(frame);
+		// released at the end of the iteration, imshow keeps its own copy
+		cv::Mat mat = ueye_camera.waitNextView();
 		cv::imshow("image", mat);
 		char c=cv::waitKey(10);
 		if(c == 27)
@@ -0,0 +1,270 @@
+#include "ueye_codec.hpp"
+#include "ueye_async.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace{
+	// residuals packed at a common width
+	const size_t BLOCK_SIZE = 32;
+	// first byte of a tile
+	const uint8_t TILE_PACKED = 0;
+	const uint8_t TILE_STORED = 1;
+
+	// residual of value, modulo the pixel range, with small magnitudes of
+	// either sign mapped to small codes
+	template<typename T>
+	uint16_t zigzag(T value, T prediction)
+	{
+		T delta = static_cast<T>(value - prediction);
+		// all ones for a negative residual
+		T sign = static_cast<T>(-(delta >> (8*sizeof(T)-1)));
+		return static_cast<T>(static_cast<T>(delta << 1) ^ sign);
+	}
+
+	template<typename T>
+	T unzigzag(uint16_t code, T prediction)
+	{
+		T delta = static_cast<T>((code >> 1) ^ static_cast<T>(-(code & 1)));
+		return static_cast<T>(prediction + delta);
+	}
+
+	// a width byte, then BLOCK_SIZE codes of width bits in little endian words
+	bool packBlock(const uint16_t *codes, uint8_t *&out, const uint8_t *limit)
+	{
+		uint16_t any = 0;
+		for(size_t i=0; i<BLOCK_SIZE; ++i)
+			any |= codes[i];
+		int bits = 0;
+		while(any >> bits)
+			++bits;
+		if(limit - out < 1 + 4*bits)
+			return false;
+		*out++ = bits;
+		uint64_t word = 0;
+		int filled = 0;
+		for(size_t i=0; i<BLOCK_SIZE && bits; ++i)
+		{
+			word |= (uint64_t)codes[i] << filled;
+			filled += bits;
+			if(filled >= 32)
+			{
+				uint32_t low = static_cast<uint32_t>(word);
+				std::memcpy(out, &low, 4);
+				out += 4;
+				word >>= 32;
+				filled -= 32;
+			}
+		}
+		return true;
+	}
+
+	bool unpackBlock(uint16_t *codes, const uint8_t *&in, const uint8_t *limit)
+	{
+		if(in == limit || *in > 16 || limit - in < 1 + 4 * *in)
+			return false;
+		int bits = *in++;
+		uint64_t word = 0;
+		int filled = 0;
+		uint16_t mask = (1u << bits) - 1;
+		for(size_t i=0; i<BLOCK_SIZE; ++i)
+		{
+			if(filled < bits)
+			{
+				uint32_t next;
+				std::memcpy(&next, in, 4);
+				in += 4;
+				word |= (uint64_t)next << filled;
+				filled += 32;
+			}
+			codes[i] = word & mask;
+			word >>= bits;
+			filled -= bits;
+		}
+		return true;
+	}
+
+	// Codes the rows begin to end of view into out, predicting each pixel from
+	// the one distance columns to the left, or distance rows above for the
+	// first columns. Returns the bytes written, 0 when more than capacity.
+	template<typename T>
+	size_t encodeTile(const cv::Mat &view, int begin, int end, int distance, uint8_t *out, size_t capacity)
+	{
+		uint8_t *position = out;
+		const uint8_t *limit = out + capacity;
+		*position++ = TILE_PACKED;
+		uint16_t codes[BLOCK_SIZE];
+		size_t count = 0;
+		int width = view.cols, first = std::min(distance, width);
+		for(int y=begin; y<end; ++y)
+		{
+			const T *row = view.ptr<T>(y);
+			const T *above = y - distance >= begin ? view.ptr<T>(y - distance) : NULL;
+			for(int x=0; x<width; ++x)
+			{
+				codes[count++] = x < first ? zigzag<T>(row[x], above ? above[x] : 0) : zigzag<T>(row[x], row[x-distance]);
+				if(count == BLOCK_SIZE)
+				{
+					if(!packBlock(codes, position, limit))
+						return 0;
+					count = 0;
+				}
+			}
+		}
+		if(count)
+		{
+			std::fill(codes + count, codes + BLOCK_SIZE, 0);
+			if(!packBlock(codes, position, limit))
+				return 0;
+		}
+		return position - out;
+	}
+
+	template<typename T>
+	bool decodeTile(const uint8_t *in, const uint8_t *limit, cv::Mat &view, int begin, int end, int distance)
+	{
+		size_t line = view.cols*sizeof(T);
+		if(in == limit)
+			return false;
+		if(*in++ == TILE_STORED)
+		{
+			if((size_t)(limit - in) != line*(end - begin))
+				return false;
+			for(int y=begin; y<end; ++y, in += line)
+				std::memcpy(view.ptr(y), in, line);
+			return true;
+		}
+		uint16_t codes[BLOCK_SIZE];
+		size_t count = BLOCK_SIZE;
+		int width = view.cols, first = std::min(distance, width);
+		for(int y=begin; y<end; ++y)
+		{
+			T *row = view.ptr<T>(y);
+			const T *above = y - distance >= begin ? view.ptr<T>(y - distance) : NULL;
+			for(int x=0; x<width; ++x)
+			{
+				if(count == BLOCK_SIZE)
+				{
+					if(!unpackBlock(codes, in, limit))
+						return false;
+					count = 0;
+				}
+				row[x] = x < first ? unzigzag<T>(codes[count++], above ? above[x] : 0) : unzigzag<T>(codes[count++], row[x-distance]);
+			}
+		}
+		return true;
+	}
+
+	// same color neighbours are two pixels apart in a Bayer mosaic
+	int predictionDistance(int32_t color_mode)
+	{
+		return ueye::pixelFormat(color_mode).Raw ? 2 : 1;
+	}
+}
+
+namespace ueye{
+
+TileCodec::TileCodec(WorkerPool *pool, uint32_t tile_rows):
+	Pool(pool), TileRows(std::max<uint32_t>(tile_rows, 2))
+{}
+
+bool TileCodec::isSupported(int32_t color_mode)
+{
+	return pixelFormat(color_mode).ColorMode >= 0 && pixelPacking(color_mode) != PACKING_BITS && pixelFormat(color_mode).ViewChannels == 1;
+}
+
+size_t TileCodec::encode(const cv::Mat &view, int32_t color_mode, void *encoded, size_t capacity) const
+{
+	CV_Assert(isSupported(color_mode) && view.type() == pixelMatType(color_mode));
+	uint32_t rows = view.rows;
+	uint32_t tiles = (rows + TileRows - 1) / TileRows;
+	size_t line = view.cols*view.elemSize();
+	size_t table = sizeof(Header) + tiles*sizeof(uint32_t);
+	// every tile has room for its storage byte and its pixels
+	if(capacity < table + tiles + rows*line)
+		return 0;
+	uint8_t *data = static_cast<uint8_t*>(encoded);
+	int distance = predictionDistance(color_mode);
+	bool wide = view.depth() == CV_16U;
+	std::vector<uint32_t> sizes(tiles);
+	auto body = [&](size_t begin, size_t end){
+		for(size_t tile=begin; tile<end; ++tile)
+		{
+			int first = tile*TileRows, last = std::min(first + TileRows, rows);
+			uint8_t *out = data + table + first*line + tile;
+			size_t room = (last - first)*line + 1;
+			size_t bytes = wide ? encodeTile<uint16_t>(view, first, last, distance, out, room) : encodeTile<uint8_t>(view, first, last, distance, out, room);
+			if(!bytes)
+			{
+				out[0] = TILE_STORED;
+				for(int y=first; y<last; ++y)
+					std::memcpy(out + 1 + (y - first)*line, view.ptr(y), line);
+				bytes = room;
+			}
+			sizes[tile] = bytes;
+		}
+	};
+	if(Pool)
+		Pool->parallelFor(tiles, body);
+	else
+		body(0, tiles);
+
+	// tiles moved down next to each other, in order
+	Header header = {TileRows, tiles};
+	std::memcpy(data, &header, sizeof(header));
+	size_t offset = table;
+	for(uint32_t tile=0; tile<tiles; ++tile)
+	{
+		uint8_t *source = data + table + tile*TileRows*line + tile;
+		if(source != data + offset)
+			std::memmove(data + offset, source, sizes[tile]);
+		offset += sizes[tile];
+		uint32_t tile_end = offset;
+		std::memcpy(data + sizeof(Header) + tile*sizeof(uint32_t), &tile_end, sizeof(uint32_t));
+	}
+	return offset;
+}
+
+void TileCodec::decode(const void *encoded, size_t bytes, int32_t color_mode, cv::Mat &view) const
+{
+	CV_Assert(isSupported(color_mode) && view.type() == pixelMatType(color_mode));
+	const uint8_t *data = static_cast<const uint8_t*>(encoded);
+	Header header;
+	if(bytes < sizeof(header))
+		throw std::runtime_error("truncated encoded frame");
+	std::memcpy(&header, data, sizeof(header));
+	uint32_t rows = view.rows;
+	size_t table = sizeof(Header) + (size_t)header.TileCount*sizeof(uint32_t);
+	if(header.TileRows < 2 || header.TileCount != (rows + header.TileRows - 1) / header.TileRows || bytes < table)
+		throw std::runtime_error("encoded frame does not match the image");
+	std::vector<uint32_t> ends(header.TileCount);
+	std::memcpy(ends.data(), data + sizeof(Header), ends.size()*sizeof(uint32_t));
+	for(uint32_t tile=0; tile<header.TileCount; ++tile)
+	{
+		if(ends[tile] < (tile ? ends[tile-1] : table) || ends[tile] > bytes)
+			throw std::runtime_error("corrupt tile offsets");
+	}
+
+	int distance = predictionDistance(color_mode);
+	bool wide = view.depth() == CV_16U;
+	// the body must not throw, failures are reported per tile
+	std::vector<char> failed(header.TileCount, 0);
+	auto body = [&](size_t begin, size_t end){
+		for(size_t tile=begin; tile<end; ++tile)
+		{
+			int first = tile*header.TileRows, last = std::min(first + header.TileRows, rows);
+			const uint8_t *in = data + (tile ? ends[tile-1] : table), *limit = data + ends[tile];
+			bool decoded = wide ? decodeTile<uint16_t>(in, limit, view, first, last, distance) : decodeTile<uint8_t>(in, limit, view, first, last, distance);
+			failed[tile] = !decoded;
+		}
+	};
+	if(Pool)
+		Pool->parallelFor(header.TileCount, body);
+	else
+		body(0, header.TileCount);
+	if(std::find(failed.begin(), failed.end(), 1) != failed.end())
+		throw std::runtime_error("corrupt tile");
+}
+
+}
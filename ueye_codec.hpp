@@ -0,0 +1,46 @@
+#ifndef UEYE_CODEC_HPP
+#define UEYE_CODEC_HPP
+
+#include "ueye_format.hpp"
+
+namespace ueye{
+
+class WorkerPool;
+
+// Lossless codec for single channel images : mono, Bayer and planar modes of
+// 8 to 16 bits. Each pixel is predicted from its left neighbour of the same
+// color, and the zigzag coded residuals are bit packed by blocks of 32 at the
+// width of the largest one, so that the unused high bits of 10 and 12 bit
+// pixels and the low noise of smooth areas take no room. The image is split
+// in bands of rows, the tiles, coded independently and in parallel on the
+// pool ; a tile that would not be smaller is stored as is. Encoded data : a
+// TileCodec::Header, the end offset of every tile, then the tiles.
+class TileCodec
+{
+	public:
+	struct Header
+	{
+		uint32_t TileRows; // rows of the view per tile
+		uint32_t TileCount;
+	};
+
+	explicit TileCodec(WorkerPool *pool=NULL, uint32_t tile_rows=32);
+
+	static bool isSupported(int32_t color_mode);
+
+	// Encodes view, laid out as by ImageMemory::view() for color_mode, into
+	// encoded. Returns the encoded bytes, or 0 when capacity is smaller than
+	// the pixels of view and the tile offsets.
+	size_t encode(const cv::Mat &view, int32_t color_mode, void *encoded, size_t capacity) const;
+	// decodes into view, allocated by the caller with the size and type of
+	// the encoded one ; throws std::runtime_error on corrupt data
+	void decode(const void *encoded, size_t bytes, int32_t color_mode, cv::Mat &view) const;
+
+	private:
+	WorkerPool *Pool;
+	uint32_t TileRows;
+};
+
+}
+
+#endif
@@ -0,0 +1,654 @@
+#include "ueye_convert.hpp"
+#include "ueye_convert_kernels.hpp"
+#include "ueye_async.hpp"
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+namespace{
+	// rows of a band converted by one task, enough to amortize the dispatch
+	const int BAND_ROWS = 16;
+	
+	typedef void (*DemosaicFunction)(const ueye::DemosaicRows &rows, int begin, int end);
+	typedef void (*UnpackFunction)(const ueye::UnpackRows &rows, int begin, int end);
+	typedef void (*ConvertFunction)(const ueye::ConvertRows &rows, int begin, int end);
+	
+	DemosaicFunction demosaicFunction(ueye::SimdLevel level)
+	{
+		switch(level)
+		{
+#ifdef UEYE_CONVERT_X86
+			case ueye::SIMD_AVX2:
+				return ueye::demosaicRowsAvx2;
+			case ueye::SIMD_SSSE3:
+				return ueye::demosaicRowsSsse3;
+#endif
+			default:
+				return ueye::demosaicRowsScalar;
+		}
+	}
+	
+	UnpackFunction unpackFunction(ueye::SimdLevel level)
+	{
+		switch(level)
+		{
+#ifdef UEYE_CONVERT_X86
+			case ueye::SIMD_AVX2:
+				return ueye::unpackRowsAvx2;
+			case ueye::SIMD_SSSE3:
+				return ueye::unpackRowsSsse3;
+#endif
+			default:
+				return ueye::unpackRowsScalar;
+		}
+	}
+	
+	ConvertFunction convertFunction(ueye::SimdLevel level)
+	{
+		switch(level)
+		{
+#ifdef UEYE_CONVERT_X86
+			case ueye::SIMD_AVX2:
+				return ueye::convertRowsAvx2;
+			case ueye::SIMD_SSSE3:
+				return ueye::convertRowsSsse3;
+#endif
+			default:
+				return ueye::convertRowsScalar;
+		}
+	}
+	
+	// false for the color modes the format conversions do not read
+	bool convertSource(int32_t color_mode, ueye::ConvertSource &source)
+	{
+		switch(color_mode & ~IS_CM_PREFER_PACKED_SOURCE_FORMAT)
+		{
+			case IS_CM_MONO8:
+				source = ueye::SOURCE_GRAY;
+				return true;
+			case IS_CM_BGR8_PACKED:
+				source = ueye::SOURCE_BGR;
+				return true;
+			case IS_CM_RGB8_PACKED:
+				source = ueye::SOURCE_RGB;
+				return true;
+			case IS_CM_BGRA8_PACKED:
+			case IS_CM_BGRY8_PACKED:
+				source = ueye::SOURCE_BGRX;
+				return true;
+			case IS_CM_RGBA8_PACKED:
+			case IS_CM_RGBY8_PACKED:
+				source = ueye::SOURCE_RGBX;
+				return true;
+			case IS_CM_RGB8_PLANAR:
+				source = ueye::SOURCE_RGB_PLANAR;
+				return true;
+			case IS_CM_UYVY_PACKED:
+			case IS_CM_CBYCRY_PACKED:
+				source = ueye::SOURCE_UYVY;
+				return true;
+			case IS_CM_BGR565_PACKED:
+				source = ueye::SOURCE_BGR565;
+				return true;
+			default:
+				return false;
+		}
+	}
+	
+	int channels(ueye::MatFormat format)
+	{
+		switch(format)
+		{
+			case ueye::MAT_GRAY:
+				return 1;
+			case ueye::MAT_BGRA:
+				return 4;
+			default:
+				return 3;
+		}
+	}
+	
+	// rows split in bands over the pool, or all converted by the calling thread
+	template<typename Rows>
+	void runBands(void (*function)(const Rows &rows, int begin, int end), const Rows &rows, int height, ueye::WorkerPool *pool)
+	{
+		if(!pool)
+		{
+			function(rows, 0, height);
+			return;
+		}
+		size_t bands = (height + BAND_ROWS - 1) / BAND_ROWS;
+		pool->parallelFor(bands, [&rows, function, height](size_t begin, size_t end){
+			function(rows, begin*BAND_ROWS, std::min<int>(end*BAND_ROWS, height));
+		});
+	}
+	
+	// Components of a pixel, specialized on the packing of MODE so that the
+	// statistics loops have compile time channel counts, offsets and shifts.
+	// read() gives each component of pixel x to accumulate(channel, value),
+	// samples() is the number of values of a channel in a line.
+	template<int32_t MODE, ueye::PixelPacking PACKING = ueye::pixelPacking(MODE)>
+	struct Components;
+	
+	template<int32_t MODE>
+	struct Components<MODE, ueye::PACKING_NONE>
+	{
+		static const int CHANNELS = ueye::pixelFormat(MODE).Channels;
+		static_assert(CHANNELS == ueye::pixelFormat(MODE).ViewChannels, "interleaved components");
+		typedef typename std::conditional<ueye::pixelFormat(MODE).Depth == CV_16U, uint16_t, uint8_t>::type T;
+		
+		template<class Accumulate>
+		static void read(const unsigned char *line, size_t plane_step, int x, Accumulate &accumulate)
+		{
+			const T *pixel = reinterpret_cast<const T*>(line) + CHANNELS*x;
+			for(int c=0; c<CHANNELS; ++c)
+				accumulate(c, pixel[c]);
+		}
+		static int samples(int channel, int width)
+		{
+			return width;
+		}
+	};
+	
+	template<int32_t MODE>
+	struct Components<MODE, ueye::PACKING_BITS>
+	{
+		static const int CHANNELS = 1;
+		static const int BITS = ueye::pixelBits(MODE);
+		
+		template<class Accumulate>
+		static void read(const unsigned char *line, size_t plane_step, int x, Accumulate &accumulate)
+		{
+			accumulate(0, unpackPixel(line, BITS, x));
+		}
+		static int samples(int channel, int width)
+		{
+			return width;
+		}
+	};
+	
+	template<int32_t MODE>
+	struct Components<MODE, ueye::PACKING_PLANAR>
+	{
+		static const int CHANNELS = ueye::pixelFormat(MODE).Channels;
+		
+		template<class Accumulate>
+		static void read(const unsigned char *line, size_t plane_step, int x, Accumulate &accumulate)
+		{
+			for(int c=0; c<CHANNELS; ++c)
+				accumulate(c, line[c*plane_step + x]);
+		}
+		static int samples(int channel, int width)
+		{
+			return width;
+		}
+	};
+	
+	// Y, U and V, the chroma counted once per pixel pair
+	template<int32_t MODE>
+	struct Components<MODE, ueye::PACKING_YUV422>
+	{
+		static const int CHANNELS = 3;
+		
+		template<class Accumulate>
+		static void read(const unsigned char *line, size_t plane_step, int x, Accumulate &accumulate)
+		{
+			accumulate(0, line[2*x+1]);
+			if((x & 1) == 0)
+			{
+				accumulate(1, line[2*x]);
+				accumulate(2, line[2*x+2]);
+			}
+		}
+		static int samples(int channel, int width)
+		{
+			return channel == 0 ? width : (width+1)/2;
+		}
+	};
+	
+	// B, G and R fields of a 16 bit word, blue in the low bits
+	template<int32_t MODE>
+	struct Components<MODE, ueye::PACKING_BITFIELDS>
+	{
+		static_assert(ueye::pixelFormat(MODE).BitsPerPixel <= 16, "fields of a 16 bit word");
+		static const int CHANNELS = 3;
+		static const int GREEN_BITS = ueye::pixelFormat(MODE).BitsPerPixel - 10;
+		
+		template<class Accumulate>
+		static void read(const unsigned char *line, size_t plane_step, int x, Accumulate &accumulate)
+		{
+			unsigned int word = line[2*x] | line[2*x+1] << 8;
+			accumulate(0, word & 31);
+			accumulate(1, (word >> 5) & ((1 << GREEN_BITS) - 1));
+			accumulate(2, (word >> (5 + GREEN_BITS)) & 31);
+		}
+		static int samples(int channel, int width)
+		{
+			return width;
+		}
+	};
+	
+	template<int CHANNELS>
+	struct Accumulator
+	{
+		Accumulator()
+		{
+			for(int c=0; c<CHANNELS; ++c)
+			{
+				Sum[c] = 0;
+				Min[c] = std::numeric_limits<unsigned int>::max();
+				Max[c] = 0;
+			}
+		}
+		void operator()(int channel, unsigned int value)
+		{
+			Sum[channel] += value;
+			Min[channel] = std::min(Min[channel], value);
+			Max[channel] = std::max(Max[channel], value);
+		}
+		
+		uint64_t Sum[CHANNELS];
+		unsigned int Min[CHANNELS];
+		unsigned int Max[CHANNELS];
+	};
+	
+	template<int32_t MODE>
+	void statisticsRows(const cv::Mat &view, int width, int begin, int end, ueye::ImageStatistics &statistics)
+	{
+		typedef Components<MODE> C;
+		size_t plane_step = view.step*(view.rows/ueye::pixelViewRows(MODE));
+		Accumulator<C::CHANNELS> accumulator;
+		for(int y=begin; y<end; ++y)
+		{
+			const unsigned char *line = view.ptr(y);
+			for(int x=0; x<width; ++x)
+				C::read(line, plane_step, x, accumulator);
+		}
+		statistics.Channels = C::CHANNELS;
+		for(int c=0; c<C::CHANNELS; ++c)
+		{
+			statistics.Count[c] += (uint64_t)C::samples(c, width)*(end - begin);
+			statistics.Sum[c] += accumulator.Sum[c];
+			statistics.Min[c] = std::min(statistics.Min[c], accumulator.Min[c]);
+			statistics.Max[c] = std::max(statistics.Max[c], accumulator.Max[c]);
+		}
+	}
+	
+	void clearStatistics(ueye::ImageStatistics &statistics)
+	{
+		statistics.Channels = 0;
+		for(int c=0; c<4; ++c)
+		{
+			statistics.Count[c] = 0;
+			statistics.Sum[c] = 0;
+			statistics.Min[c] = std::numeric_limits<unsigned int>::max();
+			statistics.Max[c] = 0;
+		}
+	}
+	
+#define STATISTICS_CASE(mode) \
+	case mode: \
+		return statisticsRows<mode>;
+	
+	ueye::FormatKernels::StatisticsFunction statisticsFunction(int32_t color_mode)
+	{
+		// the packed source flag only matters to the packable modes
+		if(ueye::pixelPacking(color_mode) != ueye::PACKING_BITS)
+			color_mode &= ~IS_CM_PREFER_PACKED_SOURCE_FORMAT;
+		switch(color_mode)
+		{
+			STATISTICS_CASE(IS_CM_SENSOR_RAW8)
+			STATISTICS_CASE(IS_CM_SENSOR_RAW10)
+			STATISTICS_CASE(IS_CM_SENSOR_RAW10 | IS_CM_PREFER_PACKED_SOURCE_FORMAT)
+			STATISTICS_CASE(IS_CM_SENSOR_RAW12)
+			STATISTICS_CASE(IS_CM_SENSOR_RAW12 | IS_CM_PREFER_PACKED_SOURCE_FORMAT)
+			STATISTICS_CASE(IS_CM_SENSOR_RAW16)
+			STATISTICS_CASE(IS_CM_MONO8)
+			STATISTICS_CASE(IS_CM_MONO10)
+			STATISTICS_CASE(IS_CM_MONO10 | IS_CM_PREFER_PACKED_SOURCE_FORMAT)
+			STATISTICS_CASE(IS_CM_MONO12)
+			STATISTICS_CASE(IS_CM_MONO12 | IS_CM_PREFER_PACKED_SOURCE_FORMAT)
+			STATISTICS_CASE(IS_CM_MONO16)
+			STATISTICS_CASE(IS_CM_BGR5_PACKED)
+			STATISTICS_CASE(IS_CM_BGR565_PACKED)
+			STATISTICS_CASE(IS_CM_RGB8_PACKED)
+			STATISTICS_CASE(IS_CM_BGR8_PACKED)
+			STATISTICS_CASE(IS_CM_RGBA8_PACKED)
+			STATISTICS_CASE(IS_CM_BGRA8_PACKED)
+			STATISTICS_CASE(IS_CM_RGBY8_PACKED)
+			STATISTICS_CASE(IS_CM_BGRY8_PACKED)
+			STATISTICS_CASE(IS_CM_UYVY_PACKED)
+			STATISTICS_CASE(IS_CM_CBYCRY_PACKED)
+			STATISTICS_CASE(IS_CM_RGB8_PLANAR)
+			default:
+				return NULL;
+		}
+	}
+	
+#undef STATISTICS_CASE
+}
+
+namespace ueye{
+
+void demosaicRowsScalar(const DemosaicRows &rows, int begin, int end)
+{
+	demosaicRowsDispatch<NoVector>(rows, begin, end);
+}
+
+void unpackRowsScalar(const UnpackRows &rows, int begin, int end)
+{
+	unpackRowsT<NoUnpackVector>(rows, begin, end);
+}
+
+void convertRowsScalar(const ConvertRows &rows, int begin, int end)
+{
+	convertRowsDispatch<NoConvertVector>(rows, begin, end);
+}
+
+SimdLevel supportedSimd()
+{
+#ifdef UEYE_CONVERT_X86
+	static const SimdLevel level = __builtin_cpu_supports("avx2") ? SIMD_AVX2 : __builtin_cpu_supports("ssse3") ? SIMD_SSSE3 : SIMD_NONE;
+	return level;
+#else
+	return SIMD_NONE;
+#endif
+}
+
+const char* simdName(SimdLevel level)
+{
+	switch(level)
+	{
+		case SIMD_AVX2:
+			return "avx2";
+		case SIMD_SSSE3:
+			return "ssse3";
+		default:
+			return "scalar";
+	}
+}
+
+BayerPattern bayerPattern(const Camera &camera)
+{
+	// parity of the red pixels on the sensor, a green first pixel being on a red row
+	int red_x = 0, red_y = 0;
+	switch(camera.getSensorBayerPixel())
+	{
+		case BAYER_PIXEL_GREEN:
+			red_x = 1;
+			break;
+		case BAYER_PIXEL_BLUE:
+			red_x = 1;
+			red_y = 1;
+			break;
+	}
+	red_x ^= camera.getAOIPosX() & 1;
+	red_y ^= camera.getAOIPosY() & 1;
+	return BayerPattern(red_x + 2*red_y);
+}
+
+
+Demosaicer::Demosaicer(DemosaicMethod method, WorkerPool *pool):
+	Method(method), Simd(supportedSimd()), Pool(pool)
+{}
+
+DemosaicMethod Demosaicer::method() const
+{
+	return Method;
+}
+
+void Demosaicer::setMethod(DemosaicMethod method)
+{
+	Method = method;
+}
+
+SimdLevel Demosaicer::simd() const
+{
+	return Simd;
+}
+
+void Demosaicer::setSimd(SimdLevel level)
+{
+	Simd = std::min(level, supportedSimd());
+}
+
+void Demosaicer::convert(const cv::Mat &raw, cv::Mat &bgr, BayerPattern pattern) const
+{
+	CV_Assert((raw.type() == CV_8UC1 || raw.type() == CV_16UC1) && raw.rows >= 2 && raw.cols >= 2);
+	bgr.create(raw.rows, raw.cols, CV_MAKETYPE(raw.depth(), 3));
+	
+	DemosaicRows rows;
+	rows.Src = raw.ptr();
+	rows.SrcStep = raw.step;
+	rows.Dst = bgr.ptr();
+	rows.DstStep = bgr.step;
+	rows.Width = raw.cols;
+	rows.Height = raw.rows;
+	rows.ElementSize = (int)raw.elemSize();
+	rows.RedX = pattern & 1;
+	rows.RedY = pattern >> 1;
+	rows.EdgeAware = Method == DEMOSAIC_EDGE_AWARE;
+	
+	runBands(demosaicFunction(Simd), rows, rows.Height, Pool);
+}
+
+void Demosaicer::convert(const ImageMemory &memory, cv::Mat &bgr, BayerPattern pattern) const
+{
+	CV_Assert(pixelFormat(memory.colorMode()).Raw);
+	if(memory.bitsPerPixel() == 16 || memory.bitsPerPixel() == 8)
+	{
+		convert(memory.view(), bgr, pattern);
+		return;
+	}
+	// packed source
+	Unpacker unpacker(Pool);
+	unpacker.setSimd(Simd);
+	cv::Mat raw;
+	unpacker.unpack(memory, raw);
+	convert(raw, bgr, pattern);
+}
+
+Unpacker::Unpacker(WorkerPool *pool):
+	Simd(supportedSimd()), Pool(pool)
+{}
+
+SimdLevel Unpacker::simd() const
+{
+	return Simd;
+}
+
+void Unpacker::setSimd(SimdLevel level)
+{
+	Simd = std::min(level, supportedSimd());
+}
+
+void Unpacker::unpack(const cv::Mat &packed, int bits, int width, cv::Mat &unpacked) const
+{
+	run(packed, bits, width, unpacked, -1);
+}
+
+void Unpacker::unpack(const cv::Mat &packed, int bits, int width, cv::Mat &unpacked, int shift) const
+{
+	CV_Assert(shift >= 0 && shift <= bits-8);
+	run(packed, bits, width, unpacked, shift);
+}
+
+void Unpacker::unpack(const ImageMemory &memory, cv::Mat &unpacked) const
+{
+	run(memory.view(), memory.bitsPerPixel(), memory.width(), unpacked, -1);
+}
+
+void Unpacker::unpack(const ImageMemory &memory, cv::Mat &unpacked, int shift) const
+{
+	unpack(memory.view(), memory.bitsPerPixel(), memory.width(), unpacked, shift);
+}
+
+void Unpacker::run(const cv::Mat &packed, int bits, int width, cv::Mat &unpacked, int shift) const
+{
+	if(bits == 16)
+		CV_Assert(packed.type() == CV_16UC1 && packed.cols >= width);
+	else
+		CV_Assert((bits == 10 || bits == 12) && packed.type() == CV_8UC1 && (size_t)packed.cols >= packedBytes(width, bits));
+	// a packed image can not be unpacked in place
+	CV_Assert(packed.data != unpacked.data || packed.empty());
+	unpacked.create(packed.rows, width, shift < 0 ? CV_16UC1 : CV_8UC1);
+	
+	UnpackRows rows;
+	rows.Src = packed.ptr();
+	rows.SrcStep = packed.step;
+	rows.Dst = unpacked.ptr();
+	rows.DstStep = unpacked.step;
+	rows.Width = width;
+	rows.Bits = bits;
+	rows.Shift = shift;
+	runBands(unpackFunction(Simd), rows, packed.rows, Pool);
+}
+
+
+FormatConverter::FormatConverter(WorkerPool *pool):
+	Simd(supportedSimd()), Pool(pool)
+{}
+
+SimdLevel FormatConverter::simd() const
+{
+	return Simd;
+}
+
+void FormatConverter::setSimd(SimdLevel level)
+{
+	Simd = std::min(level, supportedSimd());
+}
+
+bool FormatConverter::isSupported(int32_t color_mode)
+{
+	ConvertSource source;
+	return convertSource(color_mode, source);
+}
+
+void FormatConverter::convert(const cv::Mat &source, int32_t color_mode, cv::Mat &converted, MatFormat format) const
+{
+	ConvertSource layout = SOURCE_GRAY;
+	CV_Assert(format != MAT_NATIVE && convertSource(color_mode, layout));
+	CV_Assert(source.depth() == CV_8U && source.data != converted.data);
+	bool planar = layout == SOURCE_RGB_PLANAR;
+	CV_Assert(!planar || source.rows % 3 == 0);
+	int height = planar ? source.rows/3 : source.rows;
+	int width = source.cols;
+	if(layout == SOURCE_UYVY || layout == SOURCE_BGR565)
+		width = source.cols*source.channels()/2;
+	
+	// nothing to convert
+	if((layout == SOURCE_GRAY && format == MAT_GRAY) || (layout == SOURCE_BGR && format == MAT_BGR))
+	{
+		source.copyTo(converted);
+		return;
+	}
+	converted.create(height, width, CV_MAKETYPE(CV_8U, channels(format)));
+	
+	ConvertRows rows;
+	rows.Src = source.ptr();
+	rows.SrcStep = source.step;
+	rows.PlaneStep = source.step*height;
+	rows.Dst = converted.ptr();
+	rows.DstStep = converted.step;
+	rows.Width = width;
+	rows.Source = layout;
+	rows.Channels = converted.channels();
+	runBands(convertFunction(Simd), rows, height, Pool);
+}
+
+void FormatConverter::convert(const ImageMemory &memory, cv::Mat &converted, MatFormat format) const
+{
+	if(format == MAT_NATIVE)
+		memory.copyToMat(converted);
+	else
+		convert(memory.view(), memory.colorMode(), converted, format);
+}
+
+void ImageMemory::copyToMat(cv::Mat &mat, MatFormat format) const
+{
+	FormatConverter().convert(*this, mat, format);
+}
+
+
+double ImageStatistics::mean(int channel) const
+{
+	return Count[channel] ? (double)Sum[channel]/Count[channel] : 0;
+}
+
+FormatKernels::FormatKernels(int32_t color_mode, WorkerPool *pool):
+	ColorMode(color_mode), Format(pixelFormat(color_mode)), Convertible(FormatConverter::isSupported(color_mode)),
+	Statistics(statisticsFunction(color_mode)), Pool(pool), Unpack(pool), Converter(pool)
+{}
+
+int32_t FormatKernels::colorMode() const
+{
+	return ColorMode;
+}
+
+const PixelFormat& FormatKernels::format() const
+{
+	return Format;
+}
+
+bool FormatKernels::isConvertible() const
+{
+	return Convertible;
+}
+
+bool FormatKernels::hasStatistics() const
+{
+	return Statistics != NULL;
+}
+
+void FormatKernels::copy(const ImageMemory &memory, cv::Mat &mat) const
+{
+	CV_Assert(memory.colorMode() == ColorMode);
+	if(pixelPacking(ColorMode) == PACKING_BITS)
+		Unpack.unpack(memory, mat);
+	else
+		memory.copyToMat(mat);
+}
+
+void FormatKernels::convert(const ImageMemory &memory, cv::Mat &converted, MatFormat format) const
+{
+	CV_Assert(memory.colorMode() == ColorMode && (Convertible || format == MAT_NATIVE));
+	Converter.convert(memory, converted, format);
+}
+
+void FormatKernels::statistics(const ImageMemory &memory, ImageStatistics &statistics) const
+{
+	CV_Assert(memory.colorMode() == ColorMode && Statistics);
+	cv::Mat view = memory.view();
+	int width = memory.width(), height = memory.height();
+	clearStatistics(statistics);
+	if(!Pool)
+	{
+		Statistics(view, width, 0, height, statistics);
+		return;
+	}
+	// one partial result per band, merged in band order
+	size_t bands = (height + BAND_ROWS - 1) / BAND_ROWS;
+	std::vector<ImageStatistics> partials(bands);
+	StatisticsFunction function = Statistics;
+	Pool->parallelFor(bands, [&](size_t begin, size_t end){
+		for(size_t band=begin; band<end; ++band)
+		{
+			clearStatistics(partials[band]);
+			function(view, width, band*BAND_ROWS, std::min<int>((band+1)*BAND_ROWS, height), partials[band]);
+		}
+	});
+	for(size_t band=0; band<bands; ++band)
+	{
+		statistics.Channels = partials[band].Channels;
+		for(int c=0; c<statistics.Channels; ++c)
+		{
+			statistics.Count[c] += partials[band].Count[c];
+			statistics.Sum[c] += partials[band].Sum[c];
+			statistics.Min[c] = std::min(statistics.Min[c], partials[band].Min[c]);
+			statistics.Max[c] = std::max(statistics.Max[c], partials[band].Max[c]);
+		}
+	}
+}
+
+}
@@ -0,0 +1,166 @@
+#ifndef UEYE_CONVERT_HPP
+#define UEYE_CONVERT_HPP
+
+#include "ueye.hpp"
+#include "ueye_format.hpp"
+
+namespace ueye{
+
+class WorkerPool;
+
+// color of the first two pixels of the first two rows
+enum BayerPattern
+{
+	BAYER_RGGB,
+	BAYER_GRBG,
+	BAYER_GBRG,
+	BAYER_BGGR
+};
+
+enum DemosaicMethod
+{
+	DEMOSAIC_BILINEAR,
+	// green interpolated along the direction of the smaller gradient, which
+	// avoids most of the zipper effect on edges for a small cost
+	DEMOSAIC_EDGE_AWARE
+};
+
+enum SimdLevel
+{
+	SIMD_NONE,
+	SIMD_SSSE3,
+	SIMD_AVX2
+};
+
+// best level supported by both the build and the processor
+SimdLevel supportedSimd();
+const char* simdName(SimdLevel level);
+
+// pattern of the camera images, from the sensor and the AOI position
+BayerPattern bayerPattern(const Camera &camera);
+
+// Host side demosaicing of IS_CM_SENSOR_RAW* images, so that the camera
+// transfers one value per pixel instead of three. The vector paths give the
+// same result as the scalar one. With a worker pool, images are split in
+// bands of rows converted in parallel.
+class Demosaicer
+{
+	public:
+	explicit Demosaicer(DemosaicMethod method=DEMOSAIC_BILINEAR, WorkerPool *pool=NULL);
+
+	DemosaicMethod method() const;
+	void setMethod(DemosaicMethod method);
+	SimdLevel simd() const;
+	// for comparisons, limited to supportedSimd()
+	void setSimd(SimdLevel level);
+
+	// CV_8UC1 to CV_8UC3, CV_16UC1 to CV_16UC3 (the values keep their bit
+	// depth), in BGR order ; raw is at least 2x2
+	void convert(const cv::Mat &raw, cv::Mat &bgr, BayerPattern pattern) const;
+	// memory in IS_CM_SENSOR_RAW8, RAW10, RAW12 or RAW16
+	void convert(const ImageMemory &memory, cv::Mat &bgr, BayerPattern pattern) const;
+
+	private:
+	DemosaicMethod Method;
+	SimdLevel Simd;
+	WorkerPool *Pool;
+};
+
+// Unpacking of 10 and 12 bit images transferred packed, requested with the
+// color mode or'ed with IS_CM_PREFER_PACKED_SOURCE_FORMAT. The memory is then
+// assumed to receive the source format, each line being a little endian bit
+// stream : 4 pixels in 5 bytes at 10 bit, 2 pixels in 3 bytes at 12 bit.
+// Unpacked 16 bit images are accepted too, for the 8 bit window.
+class Unpacker
+{
+	public:
+	explicit Unpacker(WorkerPool *pool=NULL);
+
+	SimdLevel simd() const;
+	void setSimd(SimdLevel level);
+
+	// packed is CV_8UC1 with lines of at least (width*bits+7)/8 bytes for 10
+	// and 12 bits, or CV_16UC1 for 16 bits ; unpacked is CV_16UC1
+	void unpack(const cv::Mat &packed, int bits, int width, cv::Mat &unpacked) const;
+	// to CV_8UC1, keeping bits [shift, shift+8) of each value, saturated
+	void unpack(const cv::Mat &packed, int bits, int width, cv::Mat &unpacked, int shift) const;
+	// IS_CM_MONO10/12/16 and IS_CM_SENSOR_RAW10/12/16 memories, packed or not
+	void unpack(const ImageMemory &memory, cv::Mat &unpacked) const;
+	void unpack(const ImageMemory &memory, cv::Mat &unpacked, int shift) const;
+
+	private:
+	void run(const cv::Mat &packed, int bits, int width, cv::Mat &unpacked, int shift) const;
+
+	SimdLevel Simd;
+	WorkerPool *Pool;
+};
+
+// Conversions of 8 bit color modes to BGR, gray or BGRA, read and written in
+// a single pass : MONO8, BGR8/RGB8, BGRA8/RGBA8 (BGRY8/RGBY8 ignoring Y),
+// RGB8_PLANAR, UYVY/CBYCRY (BT.601 limited range) and BGR565. Planar, UYVY
+// and BGR565 have vector paths, giving the same result as the scalar one.
+class FormatConverter
+{
+	public:
+	explicit FormatConverter(WorkerPool *pool=NULL);
+
+	SimdLevel simd() const;
+	void setSimd(SimdLevel level);
+
+	static bool isSupported(int32_t color_mode);
+
+	// source laid out like ImageMemory::view() for color_mode
+	void convert(const cv::Mat &source, int32_t color_mode, cv::Mat &converted, MatFormat format) const;
+	void convert(const ImageMemory &memory, cv::Mat &converted, MatFormat format) const;
+
+	private:
+	SimdLevel Simd;
+	WorkerPool *Pool;
+};
+
+// per component of the pixels as stored, in memory order (Y, U, V for UYVY,
+// the fields for BGR565), packed values unpacked
+struct ImageStatistics
+{
+	int Channels;
+	uint64_t Count[4];
+	uint64_t Sum[4];
+	unsigned int Min[4];
+	unsigned int Max[4];
+
+	double mean(int channel) const;
+};
+
+// Kernels of one color mode, chosen once for a stream rather than per frame
+// or per pixel : the statistics loops are specialized for each mode with the
+// traits of ueye_format.hpp, the copy and conversions are resolved up front.
+class FormatKernels
+{
+	public:
+	explicit FormatKernels(int32_t color_mode, WorkerPool *pool=NULL);
+
+	int32_t colorMode() const;
+	const PixelFormat& format() const;
+	bool isConvertible() const;
+	bool hasStatistics() const;
+
+	// memories of the color mode only ; packed sources are unpacked to 16 bit
+	void copy(const ImageMemory &memory, cv::Mat &mat) const;
+	void convert(const ImageMemory &memory, cv::Mat &converted, MatFormat format) const;
+	void statistics(const ImageMemory &memory, ImageStatistics &statistics) const;
+
+	typedef void (*StatisticsFunction)(const cv::Mat &view, int width, int begin, int end, ImageStatistics &statistics);
+
+	private:
+	int32_t ColorMode;
+	PixelFormat Format;
+	bool Convertible;
+	StatisticsFunction Statistics;
+	WorkerPool *Pool;
+	Unpacker Unpack;
+	FormatConverter Converter;
+};
+
+}
+
+#endif
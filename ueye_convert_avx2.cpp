@@ -0,0 +1,21 @@
+// compiled with -mavx2
+#include "ueye_convert_kernels.hpp"
+
+namespace ueye{
+
+void demosaicRowsAvx2(const DemosaicRows &rows, int begin, int end)
+{
+	demosaicRowsDispatch<VectorPath<Avx8, Avx16> >(rows, begin, end);
+}
+
+void unpackRowsAvx2(const UnpackRows &rows, int begin, int end)
+{
+	unpackRowsT<UnpackVector<AvxUnpack> >(rows, begin, end);
+}
+
+void convertRowsAvx2(const ConvertRows &rows, int begin, int end)
+{
+	convertRowsDispatch<ConvertVector<AvxConvert> >(rows, begin, end);
+}
+
+}
@@ -0,0 +1,1142 @@
+#ifndef UEYE_CONVERT_KERNELS_HPP
+#define UEYE_CONVERT_KERNELS_HPP
+
+// Conversion kernels shared by ueye_convert.cpp and its instruction set
+// specific sources, each compiled with its own target flags. Everything that
+// may be instantiated with vector instructions stays in an anonymous
+// namespace, so that the linker never picks an AVX2 copy for the scalar path.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace ueye{
+
+// rows [begin, end) of a Bayer mosaic to interleaved BGR
+struct DemosaicRows
+{
+	const unsigned char *Src;
+	size_t SrcStep;
+	unsigned char *Dst;
+	size_t DstStep;
+	int Width;
+	int Height;
+	int ElementSize; // 1 or 2 bytes
+	// position parity of the red pixels
+	int RedX;
+	int RedY;
+	bool EdgeAware;
+};
+
+// rows [begin, end) of 10 or 12 bit packed pixels, or of 16 bit pixels, to
+// 16 bit values, or to 8 bit values made of bits [Shift, Shift+8)
+struct UnpackRows
+{
+	const unsigned char *Src;
+	size_t SrcStep;
+	unsigned char *Dst;
+	size_t DstStep;
+	int Width;
+	int Bits;
+	int Shift; // -1 for 16 bit values
+};
+
+// 8 bit color layouts read by the format conversions
+enum ConvertSource
+{
+	SOURCE_GRAY,
+	SOURCE_BGR,
+	SOURCE_RGB,
+	SOURCE_BGRX, // fourth byte ignored
+	SOURCE_RGBX,
+	SOURCE_RGB_PLANAR,
+	SOURCE_UYVY,
+	SOURCE_BGR565
+};
+
+// rows [begin, end) of a source to gray, BGR or BGRA
+struct ConvertRows
+{
+	const unsigned char *Src;
+	size_t SrcStep;
+	size_t PlaneStep; // between the planes of SOURCE_RGB_PLANAR
+	unsigned char *Dst;
+	size_t DstStep;
+	int Width;
+	ConvertSource Source;
+	int Channels; // 1, 3 or 4
+};
+
+void demosaicRowsScalar(const DemosaicRows &rows, int begin, int end);
+void unpackRowsScalar(const UnpackRows &rows, int begin, int end);
+void convertRowsScalar(const ConvertRows &rows, int begin, int end);
+#ifdef UEYE_CONVERT_X86
+void demosaicRowsSsse3(const DemosaicRows &rows, int begin, int end);
+void demosaicRowsAvx2(const DemosaicRows &rows, int begin, int end);
+void unpackRowsSsse3(const UnpackRows &rows, int begin, int end);
+void unpackRowsAvx2(const UnpackRows &rows, int begin, int end);
+void convertRowsSsse3(const ConvertRows &rows, int begin, int end);
+void convertRowsAvx2(const ConvertRows &rows, int begin, int end);
+#endif
+
+}
+
+namespace{
+
+// Values are averaged with rounding, (a+b+1)/2, and four neighbours as the
+// average of two averages : this is what pavgb/pavgw compute, so that the
+// scalar and vector paths give identical images.
+template<typename T>
+inline T average(T a, T b)
+{
+	return (T)(((unsigned int)a + b + 1) >> 1);
+}
+
+template<typename T>
+inline T absoluteDifference(T a, T b)
+{
+	return a > b ? a - b : b - a;
+}
+
+// neighbourhood of a row, borders mirrored so that the Bayer parity is kept
+template<typename T>
+struct RowContext
+{
+	const T *North;
+	const T *Center;
+	const T *South;
+	T *Out;
+	int Width;
+	// parity of the red or blue pixels of the row, the others being green
+	int Primary;
+	bool RedRow;
+	bool EdgeAware;
+};
+
+// green at a red or blue pixel : bilinear, or along the direction of the
+// smaller gradient when EdgeAware
+template<typename T>
+inline T interpolateGreen(T west, T east, T north, T south, bool edge_aware)
+{
+	T horizontal = average(west, east);
+	T vertical = average(north, south);
+	if(edge_aware)
+	{
+		T dh = absoluteDifference(west, east);
+		T dv = absoluteDifference(north, south);
+		if(dh < dv)
+			return horizontal;
+		if(dv < dh)
+			return vertical;
+	}
+	return average(horizontal, vertical);
+}
+
+template<typename T>
+inline void demosaicPixel(const RowContext<T> &row, int x)
+{
+	int w = x > 0 ? x-1 : 1;
+	int e = x < row.Width-1 ? x+1 : row.Width-2;
+	const T *n = row.North, *c = row.Center, *s = row.South;
+	T row_color, green, other_color;
+	if((x & 1) == row.Primary)
+	{
+		row_color = c[x];
+		green = interpolateGreen(c[w], c[e], n[x], s[x], row.EdgeAware);
+		other_color = average(average(n[w], n[e]), average(s[w], s[e]));
+	}
+	else
+	{
+		row_color = average(c[w], c[e]);
+		green = c[x];
+		other_color = average(n[x], s[x]);
+	}
+	T *out = row.Out + 3*x;
+	out[0] = row.RedRow ? other_color : row_color;
+	out[1] = green;
+	out[2] = row.RedRow ? row_color : other_color;
+}
+
+// Interior pixels of a row with the vector operations of Ops, from x=1 (odd)
+// by Ops::LANES, returns the first pixel left to the scalar path.
+// Ops provides the vector type V of T elements and :
+//  load, average, select(mask, a, b), lessOrEqual (mask), and, storeBGR,
+//  oddLanes (mask of the lanes at an odd offset from the first one)
+template<typename T, class Ops>
+inline int demosaicVector(const RowContext<T> &row)
+{
+	typedef typename Ops::V V;
+	const T *n = row.North, *c = row.Center, *s = row.South;
+	// x is always odd : the lanes of the primary pixels are fixed for the row
+	V primary = Ops::oddLanes();
+	if(row.Primary != 0)
+		primary = Ops::select(primary, Ops::zero(), Ops::ones());
+	int x = 1;
+	for(; x + Ops::LANES <= row.Width-1; x += Ops::LANES)
+	{
+		V west = Ops::load(c+x-1), center = Ops::load(c+x), east = Ops::load(c+x+1);
+		V north = Ops::load(n+x), south = Ops::load(s+x);
+		V horizontal = Ops::average(west, east);
+		V vertical = Ops::average(north, south);
+		V green = Ops::average(horizontal, vertical);
+		if(row.EdgeAware)
+		{
+			V dh = Ops::absoluteDifference(west, east);
+			V dv = Ops::absoluteDifference(north, south);
+			V h_le = Ops::lessOrEqual(dh, dv), v_le = Ops::lessOrEqual(dv, dh);
+			green = Ops::select(Ops::bitAnd(h_le, v_le), green, Ops::select(h_le, horizontal, vertical));
+		}
+		V diagonal = Ops::average(Ops::average(Ops::load(n+x-1), Ops::load(n+x+1)), Ops::average(Ops::load(s+x-1), Ops::load(s+x+1)));
+
+		V row_color = Ops::select(primary, center, horizontal);
+		green = Ops::select(primary, green, center);
+		V other_color = Ops::select(primary, diagonal, vertical);
+		if(row.RedRow)
+			Ops::storeBGR(row.Out + 3*x, other_color, green, row_color);
+		else
+			Ops::storeBGR(row.Out + 3*x, row_color, green, other_color);
+	}
+	return x;
+}
+
+struct NoVector
+{
+	template<typename T>
+	static int run(const RowContext<T> &row)
+	{
+		return 1;
+	}
+};
+
+template<class Ops8, class Ops16>
+struct VectorPath
+{
+	static int run(const RowContext<uint8_t> &row)
+	{
+		return demosaicVector<uint8_t, Ops8>(row);
+	}
+	static int run(const RowContext<uint16_t> &row)
+	{
+		return demosaicVector<uint16_t, Ops16>(row);
+	}
+};
+
+template<typename T, class Path>
+void demosaicRowsT(const ueye::DemosaicRows &rows, int begin, int end)
+{
+	for(int y=begin; y<end; ++y)
+	{
+		int north = y > 0 ? y-1 : 1;
+		int south = y < rows.Height-1 ? y+1 : rows.Height-2;
+		RowContext<T> row;
+		row.North = reinterpret_cast<const T*>(rows.Src + north*rows.SrcStep);
+		row.Center = reinterpret_cast<const T*>(rows.Src + y*rows.SrcStep);
+		row.South = reinterpret_cast<const T*>(rows.Src + south*rows.SrcStep);
+		row.Out = reinterpret_cast<T*>(rows.Dst + y*rows.DstStep);
+		row.Width = rows.Width;
+		row.RedRow = (y & 1) == rows.RedY;
+		row.Primary = row.RedRow ? rows.RedX : rows.RedX ^ 1;
+		row.EdgeAware = rows.EdgeAware;
+
+		demosaicPixel(row, 0);
+		for(int x=Path::run(row); x<rows.Width; ++x)
+			demosaicPixel(row, x);
+	}
+}
+
+template<class Path>
+void demosaicRowsDispatch(const ueye::DemosaicRows &rows, int begin, int end)
+{
+	if(rows.ElementSize == 1)
+		demosaicRowsT<uint8_t, Path>(rows, begin, end);
+	else
+		demosaicRowsT<uint16_t, Path>(rows, begin, end);
+}
+
+// Packed pixels form a little endian bit stream : at 10 bit, 4 pixels in 5
+// bytes, at 12 bit, 2 pixels in 3 bytes. A pixel always lies within two
+// consecutive bytes.
+inline size_t packedBytes(int width, int bits)
+{
+	return ((size_t)width*bits + 7) / 8;
+}
+
+inline uint16_t unpackPixel(const unsigned char *src, int bits, int x)
+{
+	if(bits == 16)
+		return reinterpret_cast<const uint16_t*>(src)[x];
+	size_t bit = (size_t)x*bits;
+	unsigned int pair = src[bit >> 3] | (unsigned int)src[(bit >> 3) + 1] << 8;
+	return (pair >> (bit & 7)) & ((1u << bits) - 1);
+}
+
+inline uint8_t windowPixel(uint16_t value, int shift)
+{
+	unsigned int window = value >> shift;
+	return window > 255 ? 255 : window;
+}
+
+struct NoUnpackVector
+{
+	explicit NoUnpackVector(int bits)
+	{}
+	int run(const ueye::UnpackRows &rows, const unsigned char *src, unsigned char *dst) const
+	{
+		return 0;
+	}
+};
+
+// Groups of Ops::PIXELS pixels, as long as the loads of Ops::loadBytes stay
+// within the line. Ops provides the vector type V of 16 bit lanes and :
+//  gatherMask and multipliers, the constants of a bit depth
+//  unpack, the values of a group with those constants
+//  store16, and store8 with the window shift
+template<class Ops>
+struct UnpackVector
+{
+	explicit UnpackVector(int bits):
+		Bits(bits), Gather(Ops::gatherMask(bits)), Multipliers(Ops::multipliers(bits))
+	{}
+	
+	int run(const ueye::UnpackRows &rows, const unsigned char *src, unsigned char *dst) const
+	{
+		size_t line = packedBytes(rows.Width, Bits);
+		int x = 0;
+		for(; x + Ops::PIXELS <= rows.Width && (size_t)x*Bits/8 + Ops::loadBytes(Bits) <= line; x += Ops::PIXELS)
+		{
+			typename Ops::V values = Ops::unpack(src + (size_t)x*Bits/8, Bits, Gather, Multipliers);
+			if(rows.Shift < 0)
+				Ops::store16(dst + 2*x, values);
+			else
+				Ops::store8(dst + x, values, rows.Shift);
+		}
+		return x;
+	}
+	
+	int Bits;
+	typename Ops::V Gather;
+	typename Ops::V Multipliers;
+};
+
+template<class Path>
+void unpackRowsT(const ueye::UnpackRows &rows, int begin, int end)
+{
+	Path path(rows.Bits);
+	for(int y=begin; y<end; ++y)
+	{
+		const unsigned char *src = rows.Src + y*rows.SrcStep;
+		unsigned char *dst = rows.Dst + y*rows.DstStep;
+		int x = path.run(rows, src, dst);
+		if(rows.Shift < 0)
+		{
+			for(; x<rows.Width; ++x)
+				reinterpret_cast<uint16_t*>(dst)[x] = unpackPixel(src, rows.Bits, x);
+		}
+		else
+		{
+			for(; x<rows.Width; ++x)
+				dst[x] = windowPixel(unpackPixel(src, rows.Bits, x), rows.Shift);
+		}
+	}
+}
+
+// BT.601 luma with 8 bit weights
+const int LUMA_B = 29, LUMA_G = 150, LUMA_R = 77;
+
+inline uint8_t luma(int b, int g, int r)
+{
+	return (LUMA_B*b + LUMA_G*g + LUMA_R*r + 128) >> 8;
+}
+
+// BT.601 limited range YUV to RGB with 6 bit weights, in 16 bit lanes : the
+// sums saturate like paddsw, which only happens far above 255 ; 75 rather than
+// 74.5 keeps white at 255
+const int YUV_Y = 75, YUV_RV = 102, YUV_GU = -25, YUV_GV = -52, YUV_BU = 129;
+
+inline int saturate16(int value)
+{
+	return value > 32767 ? 32767 : value < -32768 ? -32768 : value;
+}
+
+inline uint8_t clamp8(int value)
+{
+	return value > 255 ? 255 : value < 0 ? 0 : value;
+}
+
+struct ConvertLine
+{
+	const unsigned char *Src;
+	size_t PlaneStep;
+	unsigned char *Dst;
+	int Width;
+	int Channels;
+};
+
+// Sources give B, G and R of pixel x, and its gray value, the luma unless
+// the source has its own
+template<class Source>
+struct ColorSource
+{
+	static uint8_t gray(const ConvertLine &line, int x)
+	{
+		uint8_t b, g, r;
+		Source::bgr(line, x, b, g, r);
+		return luma(b, g, r);
+	}
+};
+
+struct SourceGray
+{
+	static void bgr(const ConvertLine &line, int x, uint8_t &b, uint8_t &g, uint8_t &r)
+	{
+		b = g = r = line.Src[x];
+	}
+	static uint8_t gray(const ConvertLine &line, int x)
+	{
+		return line.Src[x];
+	}
+};
+
+template<int BYTES, int B, int R>
+struct SourceInterleaved: public ColorSource<SourceInterleaved<BYTES, B, R> >
+{
+	static void bgr(const ConvertLine &line, int x, uint8_t &b, uint8_t &g, uint8_t &r)
+	{
+		const unsigned char *pixel = line.Src + BYTES*x;
+		b = pixel[B];
+		g = pixel[1];
+		r = pixel[R];
+	}
+};
+
+// planes in R, G, B order
+struct SourcePlanar: public ColorSource<SourcePlanar>
+{
+	static void bgr(const ConvertLine &line, int x, uint8_t &b, uint8_t &g, uint8_t &r)
+	{
+		r = line.Src[x];
+		g = line.Src[line.PlaneStep + x];
+		b = line.Src[2*line.PlaneStep + x];
+	}
+};
+
+// U Y0 V Y1 : chroma shared by pixel pairs
+struct SourceUyvy
+{
+	static void bgr(const ConvertLine &line, int x, uint8_t &b, uint8_t &g, uint8_t &r)
+	{
+		const unsigned char *pair = line.Src + 4*(x/2);
+		int y = std::max(line.Src[2*x+1] - 16, 0)*YUV_Y + 32;
+		int u = pair[0] - 128, v = pair[2] - 128;
+		b = clamp8(saturate16(y + YUV_BU*u) >> 6);
+		g = clamp8(saturate16(y + YUV_GU*u + YUV_GV*v) >> 6);
+		r = clamp8(saturate16(y + YUV_RV*v) >> 6);
+	}
+	static uint8_t gray(const ConvertLine &line, int x)
+	{
+		return line.Src[2*x+1];
+	}
+};
+
+// blue in the low bits, components widened by replicating their high bits
+struct SourceBgr565: public ColorSource<SourceBgr565>
+{
+	static void bgr(const ConvertLine &line, int x, uint8_t &b, uint8_t &g, uint8_t &r)
+	{
+		unsigned int pixel = line.Src[2*x] | line.Src[2*x+1] << 8;
+		unsigned int b5 = pixel & 31, g6 = (pixel >> 5) & 63, r5 = pixel >> 11;
+		b = b5 << 3 | b5 >> 2;
+		g = g6 << 2 | g6 >> 4;
+		r = r5 << 3 | r5 >> 2;
+	}
+};
+
+typedef SourceInterleaved<3, 0, 2> SourceBgr;
+typedef SourceInterleaved<3, 2, 0> SourceRgb;
+typedef SourceInterleaved<4, 0, 2> SourceBgrx;
+typedef SourceInterleaved<4, 2, 0> SourceRgbx;
+
+struct NoConvertVector
+{
+	template<class Source>
+	static int run(Source, const ConvertLine &line)
+	{
+		return 0;
+	}
+};
+
+template<class Source, class Path>
+void convertRowsT(const ueye::ConvertRows &rows, int begin, int end)
+{
+	for(int y=begin; y<end; ++y)
+	{
+		ConvertLine line;
+		line.Src = rows.Src + y*rows.SrcStep;
+		line.PlaneStep = rows.PlaneStep;
+		line.Dst = rows.Dst + y*rows.DstStep;
+		line.Width = rows.Width;
+		line.Channels = rows.Channels;
+		
+		unsigned char *dst = line.Dst;
+		int x = Path::run(Source(), line);
+		if(rows.Channels == 1)
+		{
+			for(; x<rows.Width; ++x)
+				dst[x] = Source::gray(line, x);
+		}
+		else if(rows.Channels == 3)
+		{
+			for(; x<rows.Width; ++x)
+				Source::bgr(line, x, dst[3*x], dst[3*x+1], dst[3*x+2]);
+		}
+		else
+		{
+			for(; x<rows.Width; ++x)
+			{
+				Source::bgr(line, x, dst[4*x], dst[4*x+1], dst[4*x+2]);
+				dst[4*x+3] = 255;
+			}
+		}
+	}
+}
+
+template<class Path>
+void convertRowsDispatch(const ueye::ConvertRows &rows, int begin, int end)
+{
+	switch(rows.Source)
+	{
+		case ueye::SOURCE_GRAY:
+			convertRowsT<SourceGray, Path>(rows, begin, end);
+			break;
+		case ueye::SOURCE_BGR:
+			convertRowsT<SourceBgr, Path>(rows, begin, end);
+			break;
+		case ueye::SOURCE_RGB:
+			convertRowsT<SourceRgb, Path>(rows, begin, end);
+			break;
+		case ueye::SOURCE_BGRX:
+			convertRowsT<SourceBgrx, Path>(rows, begin, end);
+			break;
+		case ueye::SOURCE_RGBX:
+			convertRowsT<SourceRgbx, Path>(rows, begin, end);
+			break;
+		case ueye::SOURCE_RGB_PLANAR:
+			convertRowsT<SourcePlanar, Path>(rows, begin, end);
+			break;
+		case ueye::SOURCE_UYVY:
+			convertRowsT<SourceUyvy, Path>(rows, begin, end);
+			break;
+		case ueye::SOURCE_BGR565:
+			convertRowsT<SourceBgr565, Path>(rows, begin, end);
+			break;
+	}
+}
+
+// Vector conversions of the planar, UYVY and BGR565 sources, by groups of
+// Ops::LANES pixels. Besides the 8 bit operations of the demosaicing, Ops
+// provides 16 bit lane arithmetic, shuffle (pshufb within 128 bit lanes),
+// widen (8 bit lanes to two registers of 16 bit lanes), pack16 (the
+// reverse, saturated), store and storeBGRA.
+template<class Ops>
+inline void storePixels(const ConvertLine &line, int x, typename Ops::V b, typename Ops::V g, typename Ops::V r)
+{
+	if(line.Channels == 3)
+		Ops::storeBGR(line.Dst + 3*x, b, g, r);
+	else
+		Ops::storeBGRA(line.Dst + 4*x, b, g, r);
+}
+
+template<class Ops>
+inline typename Ops::V luma16(typename Ops::V b, typename Ops::V g, typename Ops::V r)
+{
+	typedef typename Ops::V V;
+	V sum = Ops::add16(Ops::mul16(b, Ops::set16(LUMA_B)), Ops::mul16(g, Ops::set16(LUMA_G)));
+	sum = Ops::add16(sum, Ops::add16(Ops::mul16(r, Ops::set16(LUMA_R)), Ops::set16(128)));
+	return Ops::shiftRightLogical16(sum, 8);
+}
+
+template<class Ops>
+inline int planarVector(const ConvertLine &line)
+{
+	typedef typename Ops::V V;
+	const unsigned char *red = line.Src, *green = red + line.PlaneStep, *blue = green + line.PlaneStep;
+	int x = 0;
+	for(; x + Ops::LANES <= line.Width; x += Ops::LANES)
+	{
+		V r = Ops::load(red + x), g = Ops::load(green + x), b = Ops::load(blue + x);
+		if(line.Channels != 1)
+		{
+			storePixels<Ops>(line, x, b, g, r);
+			continue;
+		}
+		V b0, b1, g0, g1, r0, r1;
+		Ops::widen(b, b0, b1);
+		Ops::widen(g, g0, g1);
+		Ops::widen(r, r0, r1);
+		Ops::store(line.Dst + x, Ops::pack16(luma16<Ops>(b0, g0, r0), luma16<Ops>(b1, g1, r1)));
+	}
+	return x;
+}
+
+alignas(16) const unsigned char UYVY_Y[16] = {1, 0x80, 3, 0x80, 5, 0x80, 7, 0x80, 9, 0x80, 11, 0x80, 13, 0x80, 15, 0x80};
+alignas(16) const unsigned char UYVY_U[16] = {0, 0x80, 0, 0x80, 4, 0x80, 4, 0x80, 8, 0x80, 8, 0x80, 12, 0x80, 12, 0x80};
+alignas(16) const unsigned char UYVY_V[16] = {2, 0x80, 2, 0x80, 6, 0x80, 6, 0x80, 10, 0x80, 10, 0x80, 14, 0x80, 14, 0x80};
+
+template<class Ops>
+inline void yuvToBgr(typename Ops::V uyvy, typename Ops::V &b, typename Ops::V &g, typename Ops::V &r)
+{
+	typedef typename Ops::V V;
+	V y = Ops::mul16(Ops::subSaturatedUnsigned16(Ops::shuffle(uyvy, UYVY_Y), Ops::set16(16)), Ops::set16(YUV_Y));
+	y = Ops::add16(y, Ops::set16(32));
+	V u = Ops::sub16(Ops::shuffle(uyvy, UYVY_U), Ops::set16(128));
+	V v = Ops::sub16(Ops::shuffle(uyvy, UYVY_V), Ops::set16(128));
+	b = Ops::shiftRight16(Ops::addSaturated16(y, Ops::mul16(u, Ops::set16(YUV_BU))), 6);
+	g = Ops::shiftRight16(Ops::addSaturated16(y, Ops::add16(Ops::mul16(u, Ops::set16(YUV_GU)), Ops::mul16(v, Ops::set16(YUV_GV)))), 6);
+	r = Ops::shiftRight16(Ops::addSaturated16(y, Ops::mul16(v, Ops::set16(YUV_RV))), 6);
+}
+
+template<class Ops>
+inline int uyvyVector(const ConvertLine &line)
+{
+	typedef typename Ops::V V;
+	int x = 0;
+	for(; x + Ops::LANES <= line.Width; x += Ops::LANES)
+	{
+		// each register holds LANES/2 pixels
+		V first = Ops::load(line.Src + 2*x), second = Ops::load(line.Src + 2*x + Ops::LANES);
+		if(line.Channels == 1)
+		{
+			Ops::store(line.Dst + x, Ops::pack16(Ops::shuffle(first, UYVY_Y), Ops::shuffle(second, UYVY_Y)));
+			continue;
+		}
+		V b0, b1, g0, g1, r0, r1;
+		yuvToBgr<Ops>(first, b0, g0, r0);
+		yuvToBgr<Ops>(second, b1, g1, r1);
+		storePixels<Ops>(line, x, Ops::pack16(b0, b1), Ops::pack16(g0, g1), Ops::pack16(r0, r1));
+	}
+	return x;
+}
+
+template<class Ops>
+inline void expand565(typename Ops::V pixels, typename Ops::V &b, typename Ops::V &g, typename Ops::V &r)
+{
+	b = Ops::and16(pixels, Ops::set16(31));
+	g = Ops::and16(Ops::shiftRightLogical16(pixels, 5), Ops::set16(63));
+	r = Ops::shiftRightLogical16(pixels, 11);
+	b = Ops::or16(Ops::shiftLeft16(b, 3), Ops::shiftRightLogical16(b, 2));
+	g = Ops::or16(Ops::shiftLeft16(g, 2), Ops::shiftRightLogical16(g, 4));
+	r = Ops::or16(Ops::shiftLeft16(r, 3), Ops::shiftRightLogical16(r, 2));
+}
+
+template<class Ops>
+inline int bgr565Vector(const ConvertLine &line)
+{
+	typedef typename Ops::V V;
+	int x = 0;
+	for(; x + Ops::LANES <= line.Width; x += Ops::LANES)
+	{
+		V b0, b1, g0, g1, r0, r1;
+		expand565<Ops>(Ops::load(line.Src + 2*x), b0, g0, r0);
+		expand565<Ops>(Ops::load(line.Src + 2*x + Ops::LANES), b1, g1, r1);
+		if(line.Channels == 1)
+			Ops::store(line.Dst + x, Ops::pack16(luma16<Ops>(b0, g0, r0), luma16<Ops>(b1, g1, r1)));
+		else
+			storePixels<Ops>(line, x, Ops::pack16(b0, b1), Ops::pack16(g0, g1), Ops::pack16(r0, r1));
+	}
+	return x;
+}
+
+// the other sources are plain byte moves, left to the compiler
+template<class Ops>
+struct ConvertVector
+{
+	template<class Source>
+	static int run(Source, const ConvertLine &line)
+	{
+		return 0;
+	}
+	static int run(SourcePlanar, const ConvertLine &line)
+	{
+		return planarVector<Ops>(line);
+	}
+	static int run(SourceUyvy, const ConvertLine &line)
+	{
+		return uyvyVector<Ops>(line);
+	}
+	static int run(SourceBgr565, const ConvertLine &line)
+	{
+		return bgr565Vector<Ops>(line);
+	}
+};
+
+}
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+
+namespace{
+
+// pshufb masks interleaving 16 bytes of B, G and R planes into 48 bytes of
+// BGR : [output block][plane], for 8 and 16 bit elements
+alignas(16) const unsigned char INTERLEAVE_8[3][3][16] = {
+	{
+		{0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80, 0x80, 5},
+		{0x80, 0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80, 0x80},
+		{0x80, 0x80, 0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80}
+	},
+	{
+		{0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80, 10, 0x80},
+		{5, 0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80, 10},
+		{0x80, 5, 0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80}
+	},
+	{
+		{0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15, 0x80, 0x80},
+		{0x80, 0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15, 0x80},
+		{10, 0x80, 0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15}
+	}
+};
+alignas(16) const unsigned char INTERLEAVE_16[3][3][16] = {
+	{
+		{0, 1, 0x80, 0x80, 0x80, 0x80, 2, 3, 0x80, 0x80, 0x80, 0x80, 4, 5, 0x80, 0x80},
+		{0x80, 0x80, 0, 1, 0x80, 0x80, 0x80, 0x80, 2, 3, 0x80, 0x80, 0x80, 0x80, 4, 5},
+		{0x80, 0x80, 0x80, 0x80, 0, 1, 0x80, 0x80, 0x80, 0x80, 2, 3, 0x80, 0x80, 0x80, 0x80}
+	},
+	{
+		{0x80, 0x80, 6, 7, 0x80, 0x80, 0x80, 0x80, 8, 9, 0x80, 0x80, 0x80, 0x80, 10, 11},
+		{0x80, 0x80, 0x80, 0x80, 6, 7, 0x80, 0x80, 0x80, 0x80, 8, 9, 0x80, 0x80, 0x80, 0x80},
+		{4, 5, 0x80, 0x80, 0x80, 0x80, 6, 7, 0x80, 0x80, 0x80, 0x80, 8, 9, 0x80, 0x80}
+	},
+	{
+		{0x80, 0x80, 0x80, 0x80, 12, 13, 0x80, 0x80, 0x80, 0x80, 14, 15, 0x80, 0x80, 0x80, 0x80},
+		{10, 11, 0x80, 0x80, 0x80, 0x80, 12, 13, 0x80, 0x80, 0x80, 0x80, 14, 15, 0x80, 0x80},
+		{0x80, 0x80, 10, 11, 0x80, 0x80, 0x80, 0x80, 12, 13, 0x80, 0x80, 0x80, 0x80, 14, 15}
+	}
+};
+
+inline __m128i interleaveBlock(const unsigned char (&masks)[3][16], __m128i b, __m128i g, __m128i r)
+{
+	__m128i out = _mm_shuffle_epi8(b, _mm_load_si128(reinterpret_cast<const __m128i*>(masks[0])));
+	out = _mm_or_si128(out, _mm_shuffle_epi8(g, _mm_load_si128(reinterpret_cast<const __m128i*>(masks[1]))));
+	return _mm_or_si128(out, _mm_shuffle_epi8(r, _mm_load_si128(reinterpret_cast<const __m128i*>(masks[2]))));
+}
+
+inline void storeInterleaved(const unsigned char (&masks)[3][3][16], void *out, __m128i b, __m128i g, __m128i r)
+{
+	__m128i *dst = static_cast<__m128i*>(out);
+	_mm_storeu_si128(dst, interleaveBlock(masks[0], b, g, r));
+	_mm_storeu_si128(dst+1, interleaveBlock(masks[1], b, g, r));
+	_mm_storeu_si128(dst+2, interleaveBlock(masks[2], b, g, r));
+}
+
+struct Sse
+{
+	typedef __m128i V;
+	static V zero()
+	{
+		return _mm_setzero_si128();
+	}
+	static V ones()
+	{
+		return _mm_set1_epi32(-1);
+	}
+	static V select(V mask, V a, V b)
+	{
+		return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+	}
+	static V bitAnd(V a, V b)
+	{
+		return _mm_and_si128(a, b);
+	}
+};
+
+struct Sse8: public Sse
+{
+	static const int LANES = 16;
+	static V load(const uint8_t *ptr)
+	{
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+	}
+	static V oddLanes()
+	{
+		return _mm_set1_epi16((short)0xFF00);
+	}
+	static V average(V a, V b)
+	{
+		return _mm_avg_epu8(a, b);
+	}
+	static V absoluteDifference(V a, V b)
+	{
+		return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+	}
+	static V lessOrEqual(V a, V b)
+	{
+		return _mm_cmpeq_epi8(_mm_subs_epu8(a, b), _mm_setzero_si128());
+	}
+	static void storeBGR(uint8_t *out, V b, V g, V r)
+	{
+		storeInterleaved(INTERLEAVE_8, out, b, g, r);
+	}
+};
+
+struct Sse16: public Sse
+{
+	static const int LANES = 8;
+	static V load(const uint16_t *ptr)
+	{
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+	}
+	static V oddLanes()
+	{
+		return _mm_set1_epi32((int)0xFFFF0000);
+	}
+	static V average(V a, V b)
+	{
+		return _mm_avg_epu16(a, b);
+	}
+	static V absoluteDifference(V a, V b)
+	{
+		return _mm_or_si128(_mm_subs_epu16(a, b), _mm_subs_epu16(b, a));
+	}
+	static V lessOrEqual(V a, V b)
+	{
+		return _mm_cmpeq_epi16(_mm_subs_epu16(a, b), _mm_setzero_si128());
+	}
+	static void storeBGR(uint16_t *out, V b, V g, V r)
+	{
+		storeInterleaved(INTERLEAVE_16, out, b, g, r);
+	}
+};
+
+// each lane gathers the two bytes holding its pixel, and the multiplication
+// moves the pixel bits to the top of the lane before the right shift
+struct SseUnpack
+{
+	typedef __m128i V;
+	static const int PIXELS = 8;
+	static int loadBytes(int bits)
+	{
+		return 16;
+	}
+	static V gatherMask(int bits)
+	{
+		alignas(16) unsigned char mask[16];
+		for(int i=0; i<8; ++i)
+		{
+			mask[2*i] = bits*i/8;
+			mask[2*i+1] = bits*i/8 + 1;
+		}
+		return _mm_load_si128(reinterpret_cast<const __m128i*>(mask));
+	}
+	static V multipliers(int bits)
+	{
+		alignas(16) uint16_t multipliers[8];
+		for(int i=0; i<8; ++i)
+			multipliers[i] = bits == 16 ? 1 : 1 << (16 - bits - bits*i%8);
+		return _mm_load_si128(reinterpret_cast<const __m128i*>(multipliers));
+	}
+	static V unpack(const unsigned char *src, int bits, V gather, V multipliers)
+	{
+		V values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		if(bits == 16)
+			return values;
+		values = _mm_mullo_epi16(_mm_shuffle_epi8(values, gather), multipliers);
+		return _mm_srl_epi16(values, _mm_cvtsi32_si128(16 - bits));
+	}
+	static void store16(unsigned char *dst, V values)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), values);
+	}
+	static void store8(unsigned char *dst, V values, int shift)
+	{
+		values = _mm_srl_epi16(values, _mm_cvtsi32_si128(shift));
+		// min(values, 255), SSE2 having no unsigned 16 bit min
+		values = _mm_sub_epi16(values, _mm_subs_epu16(values, _mm_set1_epi16(255)));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(values, values));
+	}
+};
+
+inline void storeBGRA(unsigned char *out, __m128i b, __m128i g, __m128i r)
+{
+	__m128i *dst = reinterpret_cast<__m128i*>(out);
+	__m128i alpha = _mm_set1_epi32(-1);
+	__m128i bg = _mm_unpacklo_epi8(b, g), ra = _mm_unpacklo_epi8(r, alpha);
+	_mm_storeu_si128(dst, _mm_unpacklo_epi16(bg, ra));
+	_mm_storeu_si128(dst+1, _mm_unpackhi_epi16(bg, ra));
+	bg = _mm_unpackhi_epi8(b, g);
+	ra = _mm_unpackhi_epi8(r, alpha);
+	_mm_storeu_si128(dst+2, _mm_unpacklo_epi16(bg, ra));
+	_mm_storeu_si128(dst+3, _mm_unpackhi_epi16(bg, ra));
+}
+
+struct SseConvert: public Sse8
+{
+	static void store(unsigned char *out, V v)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+	}
+	static void storeBGRA(unsigned char *out, V b, V g, V r)
+	{
+		::storeBGRA(out, b, g, r);
+	}
+	static V shuffle(V v, const unsigned char (&mask)[16])
+	{
+		return _mm_shuffle_epi8(v, _mm_load_si128(reinterpret_cast<const __m128i*>(mask)));
+	}
+	static void widen(V v, V &low, V &high)
+	{
+		low = _mm_unpacklo_epi8(v, _mm_setzero_si128());
+		high = _mm_unpackhi_epi8(v, _mm_setzero_si128());
+	}
+	static V pack16(V low, V high)
+	{
+		return _mm_packus_epi16(low, high);
+	}
+	static V set16(int value)
+	{
+		return _mm_set1_epi16((short)value);
+	}
+	static V add16(V a, V b)
+	{
+		return _mm_add_epi16(a, b);
+	}
+	static V addSaturated16(V a, V b)
+	{
+		return _mm_adds_epi16(a, b);
+	}
+	static V sub16(V a, V b)
+	{
+		return _mm_sub_epi16(a, b);
+	}
+	static V subSaturatedUnsigned16(V a, V b)
+	{
+		return _mm_subs_epu16(a, b);
+	}
+	static V mul16(V a, V b)
+	{
+		return _mm_mullo_epi16(a, b);
+	}
+	static V and16(V a, V b)
+	{
+		return _mm_and_si128(a, b);
+	}
+	static V or16(V a, V b)
+	{
+		return _mm_or_si128(a, b);
+	}
+	static V shiftLeft16(V v, int count)
+	{
+		return _mm_slli_epi16(v, count);
+	}
+	static V shiftRight16(V v, int count)
+	{
+		return _mm_srai_epi16(v, count);
+	}
+	static V shiftRightLogical16(V v, int count)
+	{
+		return _mm_srli_epi16(v, count);
+	}
+};
+
+}
+#endif
+
+#ifdef __AVX2__
+#include <immintrin.h>
+
+namespace{
+
+struct Avx
+{
+	typedef __m256i V;
+	static V zero()
+	{
+		return _mm256_setzero_si256();
+	}
+	static V ones()
+	{
+		return _mm256_set1_epi32(-1);
+	}
+	static V select(V mask, V a, V b)
+	{
+		return _mm256_blendv_epi8(b, a, mask);
+	}
+	static V bitAnd(V a, V b)
+	{
+		return _mm256_and_si256(a, b);
+	}
+};
+
+// pshufb only shuffles within 128 bit lanes : each half is interleaved apart
+struct Avx8: public Avx
+{
+	static const int LANES = 32;
+	static V load(const uint8_t *ptr)
+	{
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+	}
+	static V oddLanes()
+	{
+		return _mm256_set1_epi16((short)0xFF00);
+	}
+	static V average(V a, V b)
+	{
+		return _mm256_avg_epu8(a, b);
+	}
+	static V absoluteDifference(V a, V b)
+	{
+		return _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+	}
+	static V lessOrEqual(V a, V b)
+	{
+		return _mm256_cmpeq_epi8(_mm256_subs_epu8(a, b), _mm256_setzero_si256());
+	}
+	static void storeBGR(uint8_t *out, V b, V g, V r)
+	{
+		storeInterleaved(INTERLEAVE_8, out, _mm256_castsi256_si128(b), _mm256_castsi256_si128(g), _mm256_castsi256_si128(r));
+		storeInterleaved(INTERLEAVE_8, out+48, _mm256_extracti128_si256(b, 1), _mm256_extracti128_si256(g, 1), _mm256_extracti128_si256(r, 1));
+	}
+};
+
+struct Avx16: public Avx
+{
+	static const int LANES = 16;
+	static V load(const uint16_t *ptr)
+	{
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+	}
+	static V oddLanes()
+	{
+		return _mm256_set1_epi32((int)0xFFFF0000);
+	}
+	static V average(V a, V b)
+	{
+		return _mm256_avg_epu16(a, b);
+	}
+	static V absoluteDifference(V a, V b)
+	{
+		return _mm256_or_si256(_mm256_subs_epu16(a, b), _mm256_subs_epu16(b, a));
+	}
+	static V lessOrEqual(V a, V b)
+	{
+		return _mm256_cmpeq_epi16(_mm256_subs_epu16(a, b), _mm256_setzero_si256());
+	}
+	static void storeBGR(uint16_t *out, V b, V g, V r)
+	{
+		storeInterleaved(INTERLEAVE_16, out, _mm256_castsi256_si128(b), _mm256_castsi256_si128(g), _mm256_castsi256_si128(r));
+		storeInterleaved(INTERLEAVE_16, out+24, _mm256_extracti128_si256(b, 1), _mm256_extracti128_si256(g, 1), _mm256_extracti128_si256(r, 1));
+	}
+};
+
+// two groups of 8 pixels, one per 128 bit lane
+struct AvxUnpack
+{
+	typedef __m256i V;
+	static const int PIXELS = 16;
+	static int loadBytes(int bits)
+	{
+		return bits + 16;
+	}
+	static V gatherMask(int bits)
+	{
+		return _mm256_broadcastsi128_si256(SseUnpack::gatherMask(bits));
+	}
+	static V multipliers(int bits)
+	{
+		return _mm256_broadcastsi128_si256(SseUnpack::multipliers(bits));
+	}
+	static V unpack(const unsigned char *src, int bits, V gather, V multipliers)
+	{
+		// the second group starts 8*bits/8 bytes further
+		V values = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + bits)), 1);
+		if(bits == 16)
+			return values;
+		values = _mm256_mullo_epi16(_mm256_shuffle_epi8(values, gather), multipliers);
+		return _mm256_srl_epi16(values, _mm_cvtsi32_si128(16 - bits));
+	}
+	static void store16(unsigned char *dst, V values)
+	{
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), values);
+	}
+	static void store8(unsigned char *dst, V values, int shift)
+	{
+		values = _mm256_min_epu16(_mm256_srl_epi16(values, _mm_cvtsi32_si128(shift)), _mm256_set1_epi16(255));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1)));
+	}
+};
+
+struct AvxConvert: public Avx8
+{
+	static void store(unsigned char *out, V v)
+	{
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), v);
+	}
+	static void storeBGRA(unsigned char *out, V b, V g, V r)
+	{
+		::storeBGRA(out, _mm256_castsi256_si128(b), _mm256_castsi256_si128(g), _mm256_castsi256_si128(r));
+		::storeBGRA(out+64, _mm256_extracti128_si256(b, 1), _mm256_extracti128_si256(g, 1), _mm256_extracti128_si256(r, 1));
+	}
+	static V shuffle(V v, const unsigned char (&mask)[16])
+	{
+		return _mm256_shuffle_epi8(v, _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(mask))));
+	}
+	static void widen(V v, V &low, V &high)
+	{
+		low = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v));
+		high = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1));
+	}
+	// packus works within 128 bit lanes, the permutation restores the order
+	static V pack16(V low, V high)
+	{
+		return _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+	}
+	static V set16(int value)
+	{
+		return _mm256_set1_epi16((short)value);
+	}
+	static V add16(V a, V b)
+	{
+		return _mm256_add_epi16(a, b);
+	}
+	static V addSaturated16(V a, V b)
+	{
+		return _mm256_adds_epi16(a, b);
+	}
+	static V sub16(V a, V b)
+	{
+		return _mm256_sub_epi16(a, b);
+	}
+	static V subSaturatedUnsigned16(V a, V b)
+	{
+		return _mm256_subs_epu16(a, b);
+	}
+	static V mul16(V a, V b)
+	{
+		return _mm256_mullo_epi16(a, b);
+	}
+	static V and16(V a, V b)
+	{
+		return _mm256_and_si256(a, b);
+	}
+	static V or16(V a, V b)
+	{
+		return _mm256_or_si256(a, b);
+	}
+	static V shiftLeft16(V v, int count)
+	{
+		return _mm256_slli_epi16(v, count);
+	}
+	static V shiftRight16(V v, int count)
+	{
+		return _mm256_srai_epi16(v, count);
+	}
+	static V shiftRightLogical16(V v, int count)
+	{
+		return _mm256_srli_epi16(v, count);
+	}
+};
+
+}
+#endif
+
+#endif
@@ -0,0 +1,21 @@
+// compiled with -mssse3
+#include "ueye_convert_kernels.hpp"
+
+namespace ueye{
+
+void demosaicRowsSsse3(const DemosaicRows &rows, int begin, int end)
+{
+	demosaicRowsDispatch<VectorPath<Sse8, Sse16> >(rows, begin, end);
+}
+
+void unpackRowsSsse3(const UnpackRows &rows, int begin, int end)
+{
+	unpackRowsT<UnpackVector<SseUnpack> >(rows, begin, end);
+}
+
+void convertRowsSsse3(const ConvertRows &rows, int begin, int end)
+{
+	convertRowsDispatch<ConvertVector<SseConvert> >(rows, begin, end);
+}
+
+}
@@ -0,0 +1,125 @@
+#ifndef UEYE_FORMAT_HPP
+#define UEYE_FORMAT_HPP
+
+extern "C"{
+#include <ueye.h>
+}
+#include <cstddef>
+#include <cstdint>
+
+#include <opencv2/core/core.hpp>
+
+namespace ueye{
+
+// how the components of a pixel are laid out in an image memory
+enum PixelPacking
+{
+	PACKING_NONE, // interleaved components of 8 or 16 bits
+	PACKING_BITS, // little endian bit stream of 10 or 12 bit values, see Unpacker
+	PACKING_PLANAR, // one plane per component
+	PACKING_YUV422, // U Y0 V Y1
+	PACKING_BITFIELDS // components in the bit fields of a word
+};
+
+// Layout of the pixels of a color mode, known at compile time so that
+// kernels can be specialized per mode and chosen once per stream.
+struct PixelFormat
+{
+	int32_t ColorMode; // without IS_CM_PREFER_PACKED_SOURCE_FORMAT, -1 when unknown
+	uint8_t BitsPerPixel;
+	// with IS_CM_PREFER_PACKED_SOURCE_FORMAT, BitsPerPixel when not packable
+	uint8_t PackedBits;
+	int Depth; // CV_8U or CV_16U, of ImageMemory::view()
+	uint8_t ViewChannels;
+	uint8_t ViewRows; // rows of view() per image line, the planes
+	uint8_t Channels; // components of a pixel
+	PixelPacking Packing;
+	bool Raw; // Bayer mosaic
+};
+
+constexpr PixelFormat PIXEL_FORMATS[] = {
+	{IS_CM_SENSOR_RAW8, 8, 8, CV_8U, 1, 1, 1, PACKING_NONE, true},
+	{IS_CM_SENSOR_RAW10, 16, 10, CV_16U, 1, 1, 1, PACKING_NONE, true},
+	{IS_CM_SENSOR_RAW12, 16, 12, CV_16U, 1, 1, 1, PACKING_NONE, true},
+	{IS_CM_SENSOR_RAW16, 16, 16, CV_16U, 1, 1, 1, PACKING_NONE, true},
+	{IS_CM_MONO8, 8, 8, CV_8U, 1, 1, 1, PACKING_NONE, false},
+	{IS_CM_MONO10, 16, 10, CV_16U, 1, 1, 1, PACKING_NONE, false},
+	{IS_CM_MONO12, 16, 12, CV_16U, 1, 1, 1, PACKING_NONE, false},
+	{IS_CM_MONO16, 16, 16, CV_16U, 1, 1, 1, PACKING_NONE, false},
+	{IS_CM_BGR5_PACKED, 15, 15, CV_8U, 2, 1, 3, PACKING_BITFIELDS, false},
+	{IS_CM_BGR565_PACKED, 16, 16, CV_8U, 2, 1, 3, PACKING_BITFIELDS, false},
+	{IS_CM_RGB8_PACKED, 24, 24, CV_8U, 3, 1, 3, PACKING_NONE, false},
+	{IS_CM_BGR8_PACKED, 24, 24, CV_8U, 3, 1, 3, PACKING_NONE, false},
+	{IS_CM_RGBA8_PACKED, 32, 32, CV_8U, 4, 1, 4, PACKING_NONE, false},
+	{IS_CM_BGRA8_PACKED, 32, 32, CV_8U, 4, 1, 4, PACKING_NONE, false},
+	{IS_CM_RGBY8_PACKED, 32, 32, CV_8U, 4, 1, 4, PACKING_NONE, false},
+	{IS_CM_BGRY8_PACKED, 32, 32, CV_8U, 4, 1, 4, PACKING_NONE, false},
+	{IS_CM_RGB10_PACKED, 30, 30, CV_16U, 3, 1, 3, PACKING_BITFIELDS, false},
+	{IS_CM_BGR10_PACKED, 30, 30, CV_16U, 3, 1, 3, PACKING_BITFIELDS, false},
+	{IS_CM_RGB10_UNPACKED, 30, 30, CV_16U, 1, 3, 3, PACKING_NONE, false},
+	{IS_CM_BGR10_UNPACKED, 30, 30, CV_16U, 1, 3, 3, PACKING_NONE, false},
+	{IS_CM_RGB12_UNPACKED, 36, 36, CV_16U, 1, 3, 3, PACKING_NONE, false},
+	{IS_CM_BGR12_UNPACKED, 36, 36, CV_16U, 1, 3, 3, PACKING_NONE, false},
+	{IS_CM_RGBA12_UNPACKED, 48, 48, CV_16U, 1, 4, 4, PACKING_NONE, false},
+	{IS_CM_BGRA12_UNPACKED, 48, 48, CV_16U, 1, 4, 4, PACKING_NONE, false},
+	{IS_CM_UYVY_PACKED, 16, 16, CV_8U, 2, 1, 3, PACKING_YUV422, false},
+	{IS_CM_CBYCRY_PACKED, 16, 16, CV_8U, 2, 1, 3, PACKING_YUV422, false},
+	{IS_CM_RGB8_PLANAR, 24, 24, CV_8U, 1, 3, 3, PACKING_PLANAR, false},
+};
+
+constexpr size_t PIXEL_FORMAT_COUNT = sizeof(PIXEL_FORMATS)/sizeof(PIXEL_FORMATS[0]);
+constexpr PixelFormat UNKNOWN_PIXEL_FORMAT = {-1, 0, 0, CV_8U, 1, 1, 0, PACKING_NONE, false};
+
+constexpr size_t pixelFormatIndex(int32_t color_mode, size_t index=0)
+{
+	return index == PIXEL_FORMAT_COUNT || PIXEL_FORMATS[index].ColorMode == (color_mode & ~IS_CM_PREFER_PACKED_SOURCE_FORMAT) ?
+		index : pixelFormatIndex(color_mode, index+1);
+}
+
+constexpr PixelFormat pixelFormat(int32_t color_mode)
+{
+	return pixelFormatIndex(color_mode) == PIXEL_FORMAT_COUNT ? UNKNOWN_PIXEL_FORMAT : PIXEL_FORMATS[pixelFormatIndex(color_mode)];
+}
+
+// bits per pixel in memory, 10 and 12 for packed sources
+constexpr uint8_t pixelBits(int32_t color_mode)
+{
+	return color_mode & IS_CM_PREFER_PACKED_SOURCE_FORMAT ? pixelFormat(color_mode).PackedBits : pixelFormat(color_mode).BitsPerPixel;
+}
+
+constexpr PixelPacking pixelPacking(int32_t color_mode)
+{
+	return pixelBits(color_mode) == 10 || pixelBits(color_mode) == 12 ? PACKING_BITS : pixelFormat(color_mode).Packing;
+}
+
+// type of the view() Mat, which has pixelViewRows() rows per image line
+constexpr int pixelMatType(int32_t color_mode)
+{
+	return pixelPacking(color_mode) == PACKING_BITS ? CV_8UC1 : CV_MAKETYPE(pixelFormat(color_mode).Depth, pixelFormat(color_mode).ViewChannels);
+}
+
+constexpr int pixelViewRows(int32_t color_mode)
+{
+	return pixelFormat(color_mode).ViewRows;
+}
+
+// bytes of the pixels of a line, packed sources being bit streams
+constexpr size_t pixelLineBytes(uint32_t width, int32_t color_mode)
+{
+	return pixelPacking(color_mode) == PACKING_BITS ? ((size_t)width*pixelBits(color_mode) + 7) / 8 : (size_t)width*((pixelBits(color_mode)+7)/8);
+}
+
+// Mat over image data laid out as by the SDK, see ImageMemory::view()
+inline cv::Mat pixelView(void *data, uint32_t width, uint32_t height, int32_t pitch, int32_t color_mode)
+{
+	if(pixelPacking(color_mode) == PACKING_BITS)
+		return cv::Mat(height, pixelLineBytes(width, color_mode), CV_8U, data, pitch);
+	int rows = pixelViewRows(color_mode);
+	// the pitch of a planar format covers the pixels of all its planes
+	size_t step = color_mode & IS_CM_FORMAT_PLANAR ? pitch/rows : pitch;
+	return cv::Mat(height*rows, width, pixelMatType(color_mode), data, step);
+}
+
+}
+
+#endif
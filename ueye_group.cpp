@@ -0,0 +1,307 @@
+#include "ueye_group.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace{
+	int64_t nanoseconds(std::chrono::steady_clock::time_point time)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+	}
+}
+
+namespace ueye{
+
+CameraGroup::CameraGroup(WorkerPool &pool, double tolerance, size_t max_sets):
+	Dispatcher(pool), Tolerance((int64_t)(tolerance*1e9)), MaxSets(std::max<size_t>(max_sets, 1)),
+	LastMatched(std::numeric_limits<int64_t>::min()), Running(false), Triggered(false)
+{
+	resetStatistics();
+}
+
+CameraGroup::~CameraGroup()
+{
+	try
+	{
+		stop();
+	}
+	catch(const std::exception&)
+	{
+		// the cameras are being closed anyway, each was stopped
+	}
+}
+
+void CameraGroup::addCamera(Camera &camera)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	if(Running)
+		throw std::logic_error("CameraGroup::addCamera while running");
+	Member member;
+	member.Cam = &camera;
+	member.Offset = 0;
+	member.OffsetValid = false;
+	member.MaxPending = 1;
+	member.Started = false;
+	Members.push_back(std::move(member));
+}
+
+size_t CameraGroup::size() const
+{
+	return Members.size();
+}
+
+Camera& CameraGroup::camera(size_t index)
+{
+	return *Members[index].Cam;
+}
+
+void CameraGroup::start(const SequenceSizing &sizing, bool software_trigger)
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		if(Running)
+			return;
+		for(size_t i=0; i<Members.size(); ++i)
+			Members[i].OffsetValid = false;
+		LastMatched = std::numeric_limits<int64_t>::min();
+		Running = true;
+		Triggered = software_trigger;
+	}
+	try
+	{
+		setTriggerMode(software_trigger ? TRIGGER_SOFTWARE : TRIGGER_OFF);
+		// the sequences are left idle in the memory pools, where
+		// videoCaptureStart takes them from
+		std::vector<ImageMemory> buffers;
+		for(size_t i=0; i<Members.size(); ++i)
+		{
+			ImageMemoryPool &pool = Members[i].Cam->memoryPool();
+			pool.acquire(buffers, Members[i].Cam->sequenceLength(sizing));
+			pool.release(buffers);
+		}
+		for(size_t i=0; i<Members.size(); ++i)
+		{
+			Members[i].Cam->videoCaptureStart(sizing);
+			Members[i].Started = true;
+			// frames waiting for the other cameras hold sequence buffers, a
+			// camera that is not matched anymore must keep one being filled
+			// and one waiting in the queue ; read before the dispatcher runs
+			size_t length = Members[i].Cam->getSequenceLength();
+			Members[i].MaxPending = length > 2 ? length - 2 : 1;
+		}
+		for(size_t i=0; i<Members.size(); ++i)
+			Dispatcher.addSource(*Members[i].Cam, [this, i](FrameSource&, Frame &frame){receive(i, frame);});
+		Dispatcher.start();
+	}
+	catch(...)
+	{
+		// only the cameras started are stopped, the error reported being
+		// the one of the start
+		try
+		{
+			stop();
+		}
+		catch(...)
+		{
+		}
+		throw;
+	}
+}
+
+void CameraGroup::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		if(!Running)
+			return;
+	}
+	Dispatcher.stop();
+	for(size_t i=0; i<Members.size(); ++i)
+		Dispatcher.removeSource(*Members[i].Cam);
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Running = false;
+		Triggered = false;
+		// releases the frames still waiting, before their sequences go
+		for(size_t i=0; i<Members.size(); ++i)
+			Members[i].Queue.clear();
+		Sets.clear();
+	}
+	SetReady.notify_all();
+	std::exception_ptr error;
+	resetCameras(error);
+	if(error)
+		std::rethrow_exception(error);
+}
+
+bool CameraGroup::isRunning() const
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	return Running;
+}
+
+bool CameraGroup::isTriggered() const
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	return Triggered;
+}
+
+void CameraGroup::trigger()
+{
+	for(size_t i=0; i<Members.size(); ++i)
+	{
+		INT err = Members[i].Cam->tryForceTrigger();
+		if(err != IS_SUCCESS)
+			throw Exception(Members[i].Cam->handle(), err, "tryForceTrigger");
+	}
+	std::lock_guard<std::mutex> lock(Mutex);
+	++Statistics.Triggers;
+}
+
+bool CameraGroup::nextSet(FrameSet &set, uint32_t timeout)
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	if(!SetReady.wait_for(lock, std::chrono::milliseconds(timeout), [this]{return !Sets.empty() || !Running;}) || Sets.empty())
+		return false;
+	set = std::move(Sets.front());
+	Sets.pop_front();
+	return true;
+}
+
+GroupStatistics CameraGroup::getStatistics() const
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	return Statistics;
+}
+
+void CameraGroup::resetStatistics()
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	Statistics.Sets = 0;
+	Statistics.Dropped = 0;
+	Statistics.Unmatched = 0;
+	Statistics.Late = 0;
+	Statistics.Triggers = 0;
+	Statistics.MaxSpread = 0.0;
+}
+
+void CameraGroup::receive(size_t index, Frame &frame)
+{
+	int64_t host = nanoseconds(frame.info().HostTimestamp);
+	int64_t device = (int64_t)frame.info().DeviceTimestamp * 100;
+	std::lock_guard<std::mutex> lock(Mutex);
+	Member &member = Members[index];
+	if(!member.OffsetValid || host - device < member.Offset)
+	{
+		member.Offset = host - device;
+		member.OffsetValid = true;
+	}
+	int64_t time = device + member.Offset;
+	// the frame is unlocked when the callback returns
+	if(time <= LastMatched)
+	{
+		++Statistics.Late;
+		return;
+	}
+	// callbacks of a camera may complete out of order
+	std::deque<PendingFrame>::iterator position = member.Queue.end();
+	while(position != member.Queue.begin() && (position-1)->Time > time)
+		--position;
+	PendingFrame pending;
+	pending.Time = time;
+	pending.Data = std::move(frame);
+	member.Queue.insert(position, std::move(pending));
+	if(member.Queue.size() > member.MaxPending)
+	{
+		member.Queue.pop_front();
+		++Statistics.Unmatched;
+	}
+	match();
+}
+
+void CameraGroup::match()
+{
+	for(;;)
+	{
+		size_t earliest = 0;
+		int64_t min = std::numeric_limits<int64_t>::max();
+		int64_t max = std::numeric_limits<int64_t>::min();
+		for(size_t i=0; i<Members.size(); ++i)
+		{
+			if(Members[i].Queue.empty())
+				return;
+			int64_t time = Members[i].Queue.front().Time;
+			if(time < min)
+			{
+				min = time;
+				earliest = i;
+			}
+			max = std::max(max, time);
+		}
+		// the earliest frame can not be matched anymore, the frames of the
+		// other cameras coming later
+		if(max - min > Tolerance)
+		{
+			Members[earliest].Queue.pop_front();
+			++Statistics.Unmatched;
+			continue;
+		}
+		FrameSet set;
+		set.Frames.reserve(Members.size());
+		for(size_t i=0; i<Members.size(); ++i)
+		{
+			set.Frames.push_back(std::move(Members[i].Queue.front().Data));
+			Members[i].Queue.pop_front();
+		}
+		set.Timestamp = std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(min)));
+		set.Spread = (max - min) * 1e-9;
+		LastMatched = max;
+		++Statistics.Sets;
+		Statistics.MaxSpread = std::max(Statistics.MaxSpread, set.Spread);
+		Sets.push_back(std::move(set));
+		if(Sets.size() > MaxSets)
+		{
+			Sets.pop_front();
+			++Statistics.Dropped;
+		}
+		SetReady.notify_one();
+	}
+}
+
+void CameraGroup::setTriggerMode(TriggerMode mode)
+{
+	for(size_t i=0; i<Members.size(); ++i)
+		Members[i].Cam->setTriggerMode(mode);
+}
+
+void CameraGroup::resetCameras(std::exception_ptr &error)
+{
+	for(size_t i=0; i<Members.size(); ++i)
+	{
+		Member &member = Members[i];
+		try
+		{
+			if(member.Started)
+			{
+				member.Started = false;
+				member.Cam->videoCaptureStop();
+			}
+		}
+		catch(...)
+		{
+			if(!error)
+				error = std::current_exception();
+		}
+		try
+		{
+			member.Cam->setTriggerMode(TRIGGER_OFF);
+		}
+		catch(...)
+		{
+			if(!error)
+				error = std::current_exception();
+		}
+	}
+}
+
+}
@@ -0,0 +1,106 @@
+#ifndef UEYE_GROUP_HPP
+#define UEYE_GROUP_HPP
+
+#include "ueye_async.hpp"
+#include <exception>
+
+namespace ueye{
+
+// frames of the cameras of a group taken at the same time
+struct FrameSet
+{
+	std::vector<Frame> Frames; // in the order the cameras were added
+	std::chrono::steady_clock::time_point Timestamp; // of the earliest frame, on the host clock
+	double Spread; // seconds between the earliest and the latest frame
+};
+
+struct GroupStatistics
+{
+	uint64_t Sets; // complete sets matched
+	uint64_t Dropped; // sets discarded because the consumer did not keep up
+	uint64_t Unmatched; // frames without a frame of every other camera within the tolerance
+	uint64_t Late; // frames received after a later set had been matched
+	uint64_t Triggers;
+	double MaxSpread; // seconds, over the matched sets
+};
+
+// Captures several cameras together and delivers the frames taken at the same
+// time as sets. Frames are collected with a CaptureDispatcher and matched by
+// device timestamp : the clocks of the cameras are not synchronized, so each
+// camera timestamp is brought to the host clock with the smallest host minus
+// device difference seen, which removes the transfer latency up to its
+// jitter. In free run, cameras drift relative to each other and sets are only
+// matched while their exposures happen to fall within the tolerance ; with a
+// software trigger, trigger() fires every camera in lockstep.
+class CameraGroup
+{
+	public:
+	// tolerance in seconds between the frames of a set ; at most max_sets
+	// matched sets wait for nextSet, the oldest being dropped beyond
+	explicit CameraGroup(WorkerPool &pool, double tolerance=0.002, size_t max_sets=4);
+	// stops the group
+	~CameraGroup();
+	
+	// before start ; the camera must outlive the group
+	void addCamera(Camera &camera);
+	size_t size() const;
+	Camera& camera(size_t index);
+	
+	// The sequences are allocated first, so that the streams are then started
+	// back to back from the memory pools. With software_trigger, the cameras
+	// only expose on trigger().
+	void start(const SequenceSizing &sizing=SequenceSizing(), bool software_trigger=false);
+	// the frames of the sets handed out must have been released ; every
+	// camera started is stopped, the first error being thrown afterwards
+	void stop();
+	bool isRunning() const;
+	bool isTriggered() const;
+	void trigger();
+	
+	// false on timeout
+	bool nextSet(FrameSet &set, uint32_t timeout=1000);
+	GroupStatistics getStatistics() const;
+	void resetStatistics();
+	
+	private:
+	CameraGroup(const CameraGroup&); // non construction-copyable
+	CameraGroup& operator=(const CameraGroup&); // non copyable
+	
+	struct PendingFrame
+	{
+		int64_t Time; // ns, on the host clock
+		Frame Data;
+	};
+	struct Member
+	{
+		Camera *Cam;
+		std::deque<PendingFrame> Queue; // by time
+		int64_t Offset; // ns, host clock minus device clock
+		bool OffsetValid;
+		size_t MaxPending; // frames of Queue, as many as the sequence can spare
+		bool Started; // capture started by start, until stop
+	};
+	
+	void receive(size_t index, Frame &frame);
+	// with Mutex locked
+	void match();
+	void setTriggerMode(TriggerMode mode);
+	// of every member, errors included, keeping the first one in error
+	void resetCameras(std::exception_ptr &error);
+	
+	CaptureDispatcher Dispatcher;
+	std::deque<Member> Members; // never relocated, Member is not copyable
+	int64_t Tolerance;
+	size_t MaxSets;
+	std::deque<FrameSet> Sets;
+	int64_t LastMatched;
+	GroupStatistics Statistics;
+	mutable std::mutex Mutex;
+	std::condition_variable SetReady;
+	bool Running;
+	bool Triggered;
+};
+
+}
+
+#endif
@@ -4,14 +4,17 @@
 #endif
 
 #include "ueye.hpp"
+#include "ueye_async.hpp"
+#include "ueye_convert.hpp"
+#include "ueye_playback.hpp"
 
 #include <wx/notebook.h>
 #include <wx/grid.h>
 #include <wx/glcanvas.h>
 
-#include <thread>
-#include <mutex>
 #include <atomic>
+#include <mutex>
+#include <fstream>
 
 #define MAX_CAMERA_NUMBER 256
 enum
@@ -20,12 +23,17 @@ enum
 	SLIDER_PIXEL_CLOCK,
 	SLIDER_FRAME_TIME,
 	SLIDER_EXPOSURE,
+	CHECKBOX_PREVIEW,
+	MENU_SAVE_STATISTICS,
+	MENU_OPEN_RECORDING,
+	TIMER_STATUS,
 	BUTTON_CONNECT_BEGIN,
 	BUTTON_CONNECT_END = BUTTON_CONNECT_BEGIN + MAX_CAMERA_NUMBER
 };
 
 class MainFrame;
 class CameraManager;
+class PlaybackManager;
 
 class MainApp: public wxApp
 {
@@ -39,9 +47,15 @@ class MainApp: public wxApp
 	bool openCamera(const ueye::CameraInfo &camera);
 	bool closeCamera(const ueye::CameraInfo &camera);
 	bool isOpen(const ueye::CameraInfo &camera);
+	// throws when the file is not a readable recording
+	bool openRecording(const std::string &path);
+	bool closeRecording(const std::string &id);
 	
 	void updateCurrentCamera();
 	CameraManager* getCurrentCamera();
+	PlaybackManager* getCurrentRecording();
+	
+	void dumpStatistics(std::ostream &stream);
 	
 	private:
 	
@@ -49,6 +63,10 @@ class MainApp: public wxApp
 	
 	MainFrame *Frame;
 	std::map<std::string, CameraManager*> Cameras;
+	std::map<std::string, PlaybackManager*> Recordings;
+	// all cameras are served by one dispatcher and a couple of workers
+	ueye::WorkerPool *Workers;
+	ueye::CaptureDispatcher *Dispatcher;
 };
 DECLARE_APP(MainApp)
 
@@ -64,6 +82,11 @@ class MainFrame: public wxFrame
 	private:
 	void OnExit(wxCommandEvent& event);
 	void OnAbout(wxCommandEvent& event);
+	void OnSaveStatistics(wxCommandEvent& event);
+	void OnOpenRecording(wxCommandEvent& event);
+	void OnStatusTimer(wxTimerEvent& event);
+	
+	wxTimer StatusTimer;
 	
 	wxDECLARE_EVENT_TABLE();
 };
@@ -129,9 +152,11 @@ class CameraTimingPanel: public CameraConfigurationBase
 	void OnPixelClockSlider(wxScrollEvent &event);
 	void OnFrameTimeSlider(wxScrollEvent &event);
 	void OnExposureSlider(wxScrollEvent &event);
+	void OnPreviewCheckBox(wxCommandEvent &event);
 	void update();
 	
 	wxSlider *PixelClockSlider, *FrameTimeSlider, *ExposureSlider;
+	wxCheckBox *PreviewCheckBox;
 	
 	wxDECLARE_EVENT_TABLE();
 };
@@ -156,7 +181,8 @@ class CameraDisplay: public wxGLCanvas
 	CameraDisplay(wxWindow *parent);
 	virtual ~CameraDisplay();
 	
-	void setImage(ueye::ImageMemory *image);
+	// the image data must stay valid until the next image is set
+	void setImage(const cv::Mat &image);
 	
 	void start(int interval_ms);
 	void stop();
@@ -170,7 +196,7 @@ class CameraDisplay: public wxGLCanvas
 	void render();
 	
 	wxGLContext* Context;
-	ueye::ImageMemory *Image;
+	cv::Mat Image;
 	std::mutex ImageMutex;
 	DisplayTimer *Timer;
 	
@@ -192,26 +218,62 @@ class DisplayTimer: public wxTimer
 class CameraManager
 {
 	public:
-	CameraManager(ueye::Camera *camera, CameraDisplay *display);
+	CameraManager(ueye::Camera *camera, CameraDisplay *display, ueye::CaptureDispatcher *dispatcher);
 	~CameraManager();
 	
 	void startLiveCapture();
 	void stopLiveCapture();
+	// 2x2 binning, or subsampling when binning is not supported, for a
+	// quarter of the bandwidth ; the capture is restarted around the change
+	bool isPreviewSupported() const;
+	bool isPreview() const;
+	void setPreview(bool preview);
 	
 	ueye::Camera *Camera;
 	
 	private:
-	void liveCaptureLoop();
+	void displayFrame(ueye::Frame &frame);
 	
 	CameraDisplay *Display;
-	std::vector<ueye::ImageMemory> Buffer;
-	std::thread *CaptureThread;
-	std::atomic<bool> CaptureStop;
+	ueye::CaptureDispatcher *Dispatcher;
+	bool Capturing;
+	// the displayed frame stays locked until a newer one replaces it
+	std::mutex DisplayedFrameMutex;
+	ueye::Frame DisplayedFrame;
+};
+
+// plays a recording in a loop, at the rate it was recorded, through the
+// dispatcher of the live cameras
+class PlaybackManager
+{
+	public:
+	// encoded frames are decoded on pool
+	PlaybackManager(const std::string &path, CameraDisplay *display, ueye::WorkerPool *pool, ueye::CaptureDispatcher *dispatcher);
+	~PlaybackManager();
+	
+	size_t position() const;
+	size_t size() const;
+	
+	private:
+	void displayFrame(ueye::Frame &frame);
+	
+	ueye::RecordingReader Reader;
+	ueye::Playback Player;
+	CameraDisplay *Display;
+	ueye::CaptureDispatcher *Dispatcher;
+	std::atomic<size_t> Position;
+	// a frame shown in place is held until a newer one replaces it
+	std::mutex DisplayedFrameMutex;
+	ueye::Frame DisplayedFrame;
+	std::chrono::steady_clock::time_point DisplayedTime;
 };
 
 wxBEGIN_EVENT_TABLE(MainFrame, wxFrame)
 	EVT_MENU(wxID_EXIT,  MainFrame::OnExit)
 	EVT_MENU(wxID_ABOUT, MainFrame::OnAbout)
+	EVT_MENU(MENU_SAVE_STATISTICS, MainFrame::OnSaveStatistics)
+	EVT_MENU(MENU_OPEN_RECORDING, MainFrame::OnOpenRecording)
+	EVT_TIMER(TIMER_STATUS, MainFrame::OnStatusTimer)
 wxEND_EVENT_TABLE()
 
 wxBEGIN_EVENT_TABLE(CameraSelectionPanel, wxPanel)
@@ -231,16 +293,20 @@ BEGIN_EVENT_TABLE(CameraTimingPanel, wxPanel)
 	EVT_COMMAND_SCROLL_CHANGED(SLIDER_PIXEL_CLOCK, CameraTimingPanel::OnPixelClockSlider)
 	EVT_COMMAND_SCROLL(SLIDER_FRAME_TIME, CameraTimingPanel::OnFrameTimeSlider)
 	EVT_COMMAND_SCROLL(SLIDER_EXPOSURE, CameraTimingPanel::OnExposureSlider)
+	EVT_CHECKBOX(CHECKBOX_PREVIEW, CameraTimingPanel::OnPreviewCheckBox)
 END_EVENT_TABLE()
 
 wxIMPLEMENT_APP(MainApp);
 
 MainApp::MainApp():
-	wxApp(), Frame(NULL)
+	wxApp(), Frame(NULL), Workers(NULL), Dispatcher(NULL)
 {}
 
 bool MainApp::OnInit()
 {
+	Workers = new ueye::WorkerPool(2);
+	Dispatcher = new ueye::CaptureDispatcher(*Workers);
+	Dispatcher->start();
 	Frame = new MainFrame( "UEye GUI", wxDefaultPosition, wxDefaultSize);
 	Frame->Maximize(true);
 	Frame->Show(true);
@@ -250,10 +316,19 @@ bool MainApp::OnInit()
 int MainApp::OnExit()
 {
 	Frame = NULL;
-	for(auto it=Cameras.begin(); it!=Cameras.end(); ++it)
+	while(!Cameras.empty())
 	{
-		closeCamera(it->first);
+		closeCamera(Cameras.begin()->first);
 	}
+	while(!Recordings.empty())
+	{
+		closeRecording(Recordings.begin()->first);
+	}
+	delete Dispatcher;
+	Dispatcher = NULL;
+	delete Workers;
+	Workers = NULL;
+	return wxApp::OnExit();
 }
 
 bool MainApp::openCamera(const std::string &id, uint64_t cameraId)
@@ -261,7 +336,7 @@ bool MainApp::openCamera(const std::string &id, uint64_t cameraId)
 	CameraDisplay *display = new CameraDisplay(Frame->Display);
 	ueye::Camera *camera = new ueye::Camera(cameraId);
 	Frame->Display->AddPage(display, id, true);
-	Cameras[id] = new CameraManager(camera, display);
+	Cameras[id] = new CameraManager(camera, display, Dispatcher);
 	Cameras[id]->startLiveCapture();
 	updateCurrentCamera();
 	return true;
@@ -269,6 +344,8 @@ bool MainApp::openCamera(const std::string &id, uint64_t cameraId)
 
 bool MainApp::closeCamera(const std::string &id)
 {
+	// stop the capture first, frame callbacks draw into the display
+	Cameras[id]->stopLiveCapture();
 	if(Frame)
 	{
 		for(size_t i=0; i<Frame->Display->GetPageCount(); ++i)
@@ -281,7 +358,6 @@ bool MainApp::closeCamera(const std::string &id)
 		}
 		Frame->Display->Layout();
 	}
-	Cameras[id]->stopLiveCapture();
 	delete Cameras[id];
 	Cameras.erase(id);
 	updateCurrentCamera();
@@ -304,6 +380,48 @@ bool MainApp::isOpen(const ueye::CameraInfo &camera)
 	return Cameras.count(id);
 }
 
+bool MainApp::openRecording(const std::string &path)
+{
+	std::string id = path.substr(path.find_last_of('/')+1);
+	if(Recordings.count(id))
+		return false;
+	CameraDisplay *display = new CameraDisplay(Frame->Display);
+	PlaybackManager *recording;
+	try
+	{
+		recording = new PlaybackManager(path, display, Workers, Dispatcher);
+	}
+	catch(...)
+	{
+		display->Destroy();
+		throw;
+	}
+	Recordings[id] = recording;
+	Frame->Display->AddPage(display, id, true);
+	return true;
+}
+
+bool MainApp::closeRecording(const std::string &id)
+{
+	// stop the playback first, it draws into the display
+	delete Recordings[id];
+	Recordings.erase(id);
+	if(Frame)
+	{
+		for(size_t i=0; i<Frame->Display->GetPageCount(); ++i)
+		{
+			if(Frame->Display->GetPageText(i) == id)
+			{
+				Frame->Display->DeletePage(i);
+				break;
+			}
+		}
+		Frame->Display->Layout();
+	}
+	updateCurrentCamera();
+	return true;
+}
+
 std::string MainApp::cameraId(const ueye::CameraInfo &camera)
 {
 	return camera.SerialNumber;
@@ -316,11 +434,39 @@ CameraManager* MainApp::getCurrentCamera()
 	int selected = Frame->Display->GetSelection();
 	if(selected != wxNOT_FOUND)
 	{
-		return Cameras[std::string(Frame->Display->GetPageText(selected))];
+		// recordings have pages too
+		auto it = Cameras.find(std::string(Frame->Display->GetPageText(selected)));
+		if(it != Cameras.end())
+			return it->second;
 	}
 	return NULL;
 }
 
+PlaybackManager* MainApp::getCurrentRecording()
+{
+	if(!Frame || !Frame->Display)
+		return NULL;
+	int selected = Frame->Display->GetSelection();
+	if(selected != wxNOT_FOUND)
+	{
+		auto it = Recordings.find(std::string(Frame->Display->GetPageText(selected)));
+		if(it != Recordings.end())
+			return it->second;
+	}
+	return NULL;
+}
+
+void MainApp::dumpStatistics(std::ostream &stream)
+{
+	stream<<"{";
+	for(auto it=Cameras.begin(); it!=Cameras.end(); ++it)
+	{
+		stream<<(it==Cameras.begin() ? "" : ", ")<<"\""<<it->first<<"\": ";
+		it->second->Camera->getStatistics().snapshot().dump(stream);
+	}
+	stream<<"}"<<std::endl;
+}
+
 void MainApp::updateCurrentCamera()
 {
 	if(Frame && Frame->Configuration)
@@ -331,10 +477,12 @@ void MainApp::updateCurrentCamera()
 }
 
 MainFrame::MainFrame(const wxString& title, const wxPoint& pos, const wxSize& size)
-	: wxFrame(NULL, wxID_ANY, title, pos, size), Display(NULL)
+	: wxFrame(NULL, wxID_ANY, title, pos, size), Display(NULL), StatusTimer(this, TIMER_STATUS)
 {
 	// create menu
 	wxMenu *menuFile = new wxMenu;
+	menuFile->Append(MENU_OPEN_RECORDING, "&Open recording...");
+	menuFile->Append(MENU_SAVE_STATISTICS, "&Save statistics...");
 	menuFile->Append(wxID_EXIT);
 	wxMenu *menuHelp = new wxMenu;
 	menuHelp->Append(wxID_ABOUT);
@@ -355,6 +503,8 @@ MainFrame::MainFrame(const wxString& title, const wxPoint& pos, const wxSize& si
 	mainSizer->Add(Configuration, 1, wxEXPAND, 0);
 	mainSizer->Add(Display, 3, wxEXPAND, 0);
 	SetSizer(mainSizer);
+	
+	StatusTimer.Start(500);
 }
 
 void MainFrame::OnExit(wxCommandEvent& event)
@@ -368,6 +518,52 @@ void MainFrame::OnAbout(wxCommandEvent& event)
 		"About UEye GUI", wxOK | wxICON_INFORMATION );
 }
 
+void MainFrame::OnSaveStatistics(wxCommandEvent& event)
+{
+	wxFileDialog dialog(this, "Save statistics", "", "statistics.json", "JSON files (*.json)|*.json", wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+	if(dialog.ShowModal() == wxID_CANCEL)
+		return;
+	std::ofstream file(dialog.GetPath().ToStdString());
+	wxGetApp().dumpStatistics(file);
+}
+
+void MainFrame::OnOpenRecording(wxCommandEvent& event)
+{
+	wxFileDialog dialog(this, "Open recording", "", "", "Recordings (*.rec)|*.rec|All files|*", wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+	if(dialog.ShowModal() == wxID_CANCEL)
+		return;
+	try
+	{
+		wxGetApp().openRecording(dialog.GetPath().ToStdString());
+	}
+	catch(const std::exception &e)
+	{
+		wxMessageBox(e.what(), "Open recording", wxOK | wxICON_ERROR);
+	}
+}
+
+void MainFrame::OnStatusTimer(wxTimerEvent& event)
+{
+	CameraManager *cameraManager = wxGetApp().getCurrentCamera();
+	PlaybackManager *recording = wxGetApp().getCurrentRecording();
+	if(recording)
+	{
+		SetStatusText(wxString::Format("Recording, frame %llu/%llu",
+			(unsigned long long)recording->position(), (unsigned long long)recording->size()));
+		return;
+	}
+	if(!cameraManager)
+	{
+		SetStatusText("No camera");
+		return;
+	}
+	ueye::CaptureStatistics::Snapshot statistics = cameraManager->Camera->getStatistics().snapshot();
+	SetStatusText(wxString::Format("%.1f fps, missed %llu, lost %llu, unlocked late %llu, latency %.2f/%.2f ms, buffers %u/%u (max %u)",
+		statistics.FrameRate, (unsigned long long)statistics.Missed, (unsigned long long)statistics.Lost,
+		(unsigned long long)statistics.UnlockedLate, statistics.MeanLatency*1e3, statistics.MaxLatency*1e3,
+		statistics.BuffersInUse, statistics.BufferCount, statistics.MaxBuffersInUse));
+}
+
 ConfigurationPanel::ConfigurationPanel(wxWindow *parent):
 	wxNotebook(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize, 0, "configuration panel")
 {
@@ -511,11 +707,12 @@ void ConnectionButton::updateState()
 }
 
 CameraTimingPanel::CameraTimingPanel(wxWindow *parent):
-	CameraConfigurationBase(parent), PixelClockSlider(NULL), FrameTimeSlider(NULL), ExposureSlider(NULL)
+	CameraConfigurationBase(parent), PixelClockSlider(NULL), FrameTimeSlider(NULL), ExposureSlider(NULL), PreviewCheckBox(NULL)
 {
 	PixelClockSlider = new wxSlider(this, SLIDER_PIXEL_CLOCK, 0, 0, 0);
 	FrameTimeSlider = new wxSlider(this, SLIDER_FRAME_TIME, 0, 0, 0);
 	ExposureSlider = new wxSlider(this, SLIDER_EXPOSURE, 0, 0, 0);
+	PreviewCheckBox = new wxCheckBox(this, CHECKBOX_PREVIEW, "Fast preview (binning)");
 	
 	wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
 	sizer->Add(new wxStaticText(this, wxID_ANY, "Pixel clock"));
@@ -524,6 +721,7 @@ CameraTimingPanel::CameraTimingPanel(wxWindow *parent):
 	sizer->Add(FrameTimeSlider, 0, wxEXPAND);
 	sizer->Add(new wxStaticText(this, wxID_ANY, "Exposure time"));
 	sizer->Add(ExposureSlider, 0, wxEXPAND);
+	sizer->Add(PreviewCheckBox);
 	SetSizer(sizer);
 	
 	setActiveCamera(wxGetApp().getCurrentCamera());
@@ -566,6 +764,24 @@ void CameraTimingPanel::OnExposureSlider(wxScrollEvent &event)
 	update();
 }
 
+void CameraTimingPanel::OnPreviewCheckBox(wxCommandEvent &event)
+{
+	if(!CurrentCamera)
+		return;
+	try
+	{
+		CurrentCamera->setPreview(event.IsChecked());
+	}
+	catch(const std::exception &e)
+	{
+		// the camera keeps the mode it had
+		ueye::Camera *camera = CurrentCamera->Camera;
+		PreviewCheckBox->SetValue(camera->getDecimationX() > 1 || camera->getDecimationY() > 1);
+		wxMessageBox(e.what(), "Preview", wxOK | wxICON_ERROR);
+	}
+	update();
+}
+
 void CameraTimingPanel::update()
 {
 	if(CurrentCamera)
@@ -605,6 +821,8 @@ void CameraTimingPanel::update()
 		PixelClockSlider->Enable(true);
 		FrameTimeSlider->Enable(true);
 		ExposureSlider->Enable(true);
+		PreviewCheckBox->SetValue(CurrentCamera->isPreview());
+		PreviewCheckBox->Enable(CurrentCamera->isPreviewSupported());
 	}
 	else
 	{
@@ -614,6 +832,8 @@ void CameraTimingPanel::update()
 		PixelClockSlider->Enable(false);
 		FrameTimeSlider->Enable(false);
 		ExposureSlider->Enable(false);
+		PreviewCheckBox->SetValue(false);
+		PreviewCheckBox->Enable(false);
 	}
 }
 
@@ -661,7 +881,7 @@ void DisplayPanel::OnPageChanged(wxBookCtrlEvent& event)
 
 
 CameraDisplay::CameraDisplay(wxWindow *parent):
-	wxGLCanvas(parent, wxID_ANY, NULL), Context(NULL), Image(NULL), Timer(NULL)
+	wxGLCanvas(parent, wxID_ANY, NULL), Context(NULL), Timer(NULL)
 {
 	Context = new wxGLContext(this);
 	init();
@@ -673,7 +893,7 @@ CameraDisplay::~CameraDisplay()
 	delete Context;
 }
 
-void CameraDisplay::setImage(ueye::ImageMemory *image)
+void CameraDisplay::setImage(const cv::Mat &image)
 {
 	ImageMutex.lock();
 	Image = image;
@@ -724,14 +944,15 @@ void CameraDisplay::init()
 
 void CameraDisplay::render()
 {
-	if(!Image)
+	std::lock_guard<std::mutex> lock(ImageMutex);
+	if(Image.empty())
 		return;
 	SetCurrent(*Context);
 	wxPaintDC(this);
 	glClear(GL_COLOR_BUFFER_BIT);
-	ImageMutex.lock();
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, Image->width(), Image->height(), 0, GL_BGR, GL_UNSIGNED_BYTE, Image->ptr());
-	ImageMutex.unlock();
+	// rows are spaced by the buffer capacity, larger than the image after an AOI reduction
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, Image.step[0]/Image.elemSize());
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, Image.cols, Image.rows, 0, GL_BGR, GL_UNSIGNED_BYTE, Image.data);
 	glBegin(GL_QUADS);
 		glTexCoord2f(0, 1); glVertex3f(-1, -1, 0);
 		glTexCoord2f(0, 0); glVertex3f(-1, 1, 0);
@@ -753,13 +974,13 @@ void DisplayTimer::Notify()
 	Display->Refresh(false);
 }
 
-CameraManager::CameraManager(ueye::Camera *camera, CameraDisplay *display):
-	Camera(camera), Display(display), CaptureThread(NULL)
+CameraManager::CameraManager(ueye::Camera *camera, CameraDisplay *display, ueye::CaptureDispatcher *dispatcher):
+	Camera(camera), Display(display), Dispatcher(dispatcher), Capturing(false)
 {}
 
 CameraManager::~CameraManager()
 {
-	if(CaptureThread)
+	if(Capturing)
 	{
 		stopLiveCapture();
 	}
@@ -768,33 +989,144 @@ CameraManager::~CameraManager()
 
 void CameraManager::startLiveCapture()
 {
-	Buffer = std::vector<ueye::ImageMemory>(3, ueye::ImageMemory(*Camera));
-	CaptureStop.store(false);
-	Camera->videoCaptureStart(Buffer);
-	CaptureThread = new std::thread(&CameraManager::liveCaptureLoop, this);
+	// sequence sized from the frame rate, taken from the camera memory pool
+	// so that a capture restart allocates nothing
+	Camera->videoCaptureStart(ueye::SequenceSizing());
+	Dispatcher->addSource(*Camera, [this](ueye::FrameSource&, ueye::Frame &frame){displayFrame(frame);});
+	Capturing = true;
 }
 
 void CameraManager::stopLiveCapture()
 {
-	CaptureStop.store(true);
-	CaptureThread->join();
+	Dispatcher->removeSource(*Camera);
+	{
+		std::lock_guard<std::mutex> lock(DisplayedFrameMutex);
+		Display->setImage(cv::Mat());
+		DisplayedFrame = ueye::Frame();
+	}
 	Camera->videoCaptureStop();
-	Buffer.clear();
-	CaptureThread = NULL;
+	Capturing = false;
+}
+
+bool CameraManager::isPreviewSupported() const
+{
+	return Camera->binningMode(2, 2) >= 0 || Camera->subsamplingMode(2, 2) >= 0;
+}
+
+bool CameraManager::isPreview() const
+{
+	return Camera->getDecimationX() * Camera->getDecimationY() > 1;
 }
 
-void CameraManager::liveCaptureLoop()
+void CameraManager::setPreview(bool preview)
 {
-	ueye::ImageMemory *previous_frame = NULL;
-	while(!CaptureStop.load())
+	// the dispatcher must not fetch frames while the sequence is replaced
+	bool capturing = Capturing;
+	if(capturing)
+	{
+		stopLiveCapture();
+	}
+	try
+	{
+		if(!preview)
+		{
+			Camera->setBinning(IS_BINNING_DISABLE);
+			Camera->setSubsampling(IS_SUBSAMPLING_DISABLE);
+		}
+		else if(Camera->binningMode(2, 2) >= 0)
+		{
+			// binning keeps the light of the skipped pixels
+			Camera->setBinning(Camera->binningMode(2, 2));
+		}
+		else if(Camera->subsamplingMode(2, 2) >= 0)
+		{
+			Camera->setSubsampling(Camera->subsamplingMode(2, 2));
+		}
+	}
+	catch(...)
+	{
+		// live capture goes on in the mode left
+		if(capturing)
+		{
+			startLiveCapture();
+		}
+		throw;
+	}
+	if(capturing)
+	{
+		startLiveCapture();
+	}
+}
+
+void CameraManager::displayFrame(ueye::Frame &frame)
+{
+	// callbacks may run concurrently, never go back to an older frame
+	std::lock_guard<std::mutex> lock(DisplayedFrameMutex);
+	if(DisplayedFrame.valid() && frame.info().FrameNumber < DisplayedFrame.info().FrameNumber)
+		return;
+	Display->setImage(frame.memory()->view());
+	DisplayedFrame = std::move(frame);
+}
+
+PlaybackManager::PlaybackManager(const std::string &path, CameraDisplay *display, ueye::WorkerPool *pool, ueye::CaptureDispatcher *dispatcher):
+	Reader(path), Player(Reader, ueye::PLAYBACK_REAL_TIME, true, pool), Display(display), Dispatcher(dispatcher), Position(0)
+{
+	Dispatcher->addSource(Player, [this](ueye::FrameSource&, ueye::Frame &frame){displayFrame(frame);});
+}
+
+PlaybackManager::~PlaybackManager()
+{
+	Dispatcher->removeSource(Player);
+	std::lock_guard<std::mutex> lock(DisplayedFrameMutex);
+	Display->setImage(cv::Mat());
+	DisplayedFrame = ueye::Frame();
+}
+
+size_t PlaybackManager::position() const
+{
+	return Position;
+}
+
+size_t PlaybackManager::size() const
+{
+	return Reader.size();
+}
+
+void PlaybackManager::displayFrame(ueye::Frame &frame)
+{
+	// callbacks may run concurrently, never go back to an older frame ; the
+	// time served keeps increasing across loops, unlike frame numbers
+	std::lock_guard<std::mutex> lock(DisplayedFrameMutex);
+	if(frame.info().HostTimestamp < DisplayedTime)
+		return;
+	DisplayedTime = frame.info().HostTimestamp;
+	Position = frame.sequenceId();
+	// BGR frames are shown in place, others converted into a new image, the
+	// displayed one may still be read
+	const ueye::ImageMemory &memory = *frame.memory();
+	int32_t color_mode = memory.colorMode();
+	if(color_mode == IS_CM_BGR8_PACKED)
+	{
+		Display->setImage(memory.view());
+		DisplayedFrame = std::move(frame);
+		return;
+	}
+	cv::Mat image;
+	if(ueye::FormatConverter::isSupported(color_mode))
+	{
+		memory.copyToMat(image, ueye::MAT_BGR);
+	}
+	else if(ueye::pixelMatType(color_mode) == CV_16UC1 && ueye::pixelViewRows(color_mode) == 1)
+	{
+		// 10 to 16 bit mono and Bayer, shown as gray from their high bits
+		cv::Mat gray;
+		memory.view().convertTo(gray, CV_8U, 1.0/(1 << (ueye::pixelFormat(color_mode).PackedBits - 8)));
+		ueye::FormatConverter().convert(gray, IS_CM_MONO8, image, ueye::MAT_BGR);
+	}
+	if(!image.empty())
 	{
-		ueye::ImageMemory *frame = Camera->waitNextFrame(4294967295);
-		Display->setImage(frame);
-		if(previous_frame)
-			Camera->unlockFrame(previous_frame);
-		previous_frame = frame;
+		Display->setImage(image);
+		DisplayedFrame = ueye::Frame();
 	}
-	if(previous_frame)
-		Camera->unlockFrame(previous_frame);
 }
 
@@ -0,0 +1,224 @@
+#include "ueye_history.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <system_error>
+
+namespace{
+	// FlushEnd until the end of the event is known
+	const uint64_t UNKNOWN_END = std::numeric_limits<uint64_t>::max();
+	// an event ends this long after its deadline when no later frame came
+	const int64_t STALLED_STREAM = 1000000000;
+	// staging of the event recorder, enough to keep the disk busy
+	const size_t EVENT_STAGING_FRAMES = 8;
+
+	int64_t nanoseconds(const std::chrono::steady_clock::time_point &time)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+	}
+}
+
+namespace ueye{
+
+FrameHistory::FrameHistory(size_t frame_bytes, size_t capacity, double duration, ImageAllocator *allocator):
+	FrameBytes(frame_bytes), Capacity(std::max<size_t>(capacity, 1)), Duration(duration*1e9), Allocator(allocator ? allocator : &DefaultAllocator),
+	SlotBytes((frame_bytes + 63) / 64 * 64), Arena(NULL), Records(Capacity), Head(0), Tail(0), Flushing(false), FlushNext(0), FlushEnd(0),
+	FlushDeadline(0), Stopping(false)
+{
+	std::memset(&Statistics, 0, sizeof(Statistics));
+	Arena = static_cast<char*>(Allocator->allocate(SlotBytes*Capacity));
+	Flusher = std::thread(&FrameHistory::flushLoop, this);
+}
+
+FrameHistory::~FrameHistory()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Stopping = true;
+	}
+	FrameAdded.notify_all();
+	Flusher.join();
+	Allocator->deallocate(Arena, SlotBytes*Capacity);
+}
+
+bool FrameHistory::push(const Frame &frame)
+{
+	// its memory may be gone with the camera
+	if(!frame.valid())
+		return false;
+	return push(*frame.memory(), frame.info());
+}
+
+bool FrameHistory::push(const ImageMemory &memory, const FrameInfo &info)
+{
+	std::lock_guard<std::mutex> push_lock(PushMutex);
+	RecordedFrame record = Recorder::frameRecord(memory, info);
+	uint64_t index;
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		bool full = Head - Tail == Capacity;
+		if(record.Size > FrameBytes || (full && Flushing && FlushNext == Tail))
+		{
+			++Statistics.Dropped;
+			return false;
+		}
+		// the oldest frame leaves before its slot is overwritten
+		if(full)
+			++Tail;
+		index = Head;
+	}
+
+	size_t slot = index % Capacity;
+	std::memcpy(Arena + slot*SlotBytes, memory.view().data, record.Size);
+
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Records[slot] = record;
+		if(Flushing && FlushEnd == UNKNOWN_END && record.HostTimestamp > FlushDeadline)
+			FlushEnd = index;
+		++Head;
+		++Statistics.Frames;
+	}
+	FrameAdded.notify_one();
+	return true;
+}
+
+bool FrameHistory::trigger(const std::string &path, double post_seconds)
+{
+	int64_t now = nanoseconds(std::chrono::steady_clock::now());
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		if(Flushing)
+			return false;
+		uint64_t first = Tail;
+		while(Duration && first < Head && Records[first % Capacity].HostTimestamp < now - Duration)
+			++first;
+		// the recording is opened by the flusher, capture goes on meanwhile
+		EventPath = path;
+		FlushNext = first;
+		FlushDeadline = now + (int64_t)(post_seconds*1e9);
+		FlushEnd = post_seconds > 0 ? UNKNOWN_END : Head;
+		Flushing = true;
+		++Statistics.Events;
+	}
+	FrameAdded.notify_all();
+	return true;
+}
+
+bool FrameHistory::isFlushing() const
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	return Flushing;
+}
+
+bool FrameHistory::waitFlushed(uint32_t timeout)
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	if(!EventFlushed.wait_for(lock, std::chrono::milliseconds(timeout), [this]{return !Flushing;}))
+		return false;
+	if(FlushError)
+	{
+		std::exception_ptr error = FlushError;
+		FlushError = std::exception_ptr();
+		std::rethrow_exception(error);
+	}
+	return true;
+}
+
+size_t FrameHistory::capacity() const
+{
+	return Capacity;
+}
+
+HistoryStatistics FrameHistory::getStatistics() const
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	HistoryStatistics statistics = Statistics;
+	statistics.Retained = Head - Tail;
+	statistics.Backlog = Flushing ? std::min(Head, FlushEnd) - FlushNext : 0;
+	return statistics;
+}
+
+void FrameHistory::flushLoop()
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	for(;;)
+	{
+		if(!Flushing)
+		{
+			if(Stopping)
+				break;
+			FrameAdded.wait(lock);
+			continue;
+		}
+		if(!EventRecorder)
+		{
+			std::string path = EventPath;
+			lock.unlock();
+			std::unique_ptr<Recorder> recorder;
+			std::exception_ptr error;
+			try
+			{
+				recorder.reset(new Recorder(path, FrameBytes, EVENT_STAGING_FRAMES));
+			}
+			catch(const std::system_error&)
+			{
+				error = std::current_exception();
+			}
+			lock.lock();
+			if(error)
+			{
+				FlushError = error;
+				Flushing = false;
+				EventFlushed.notify_all();
+				continue;
+			}
+			EventRecorder = std::move(recorder);
+		}
+		// a stopped stream, or a stopping history, does not wait for more frames
+		if(FlushEnd == UNKNOWN_END && (Stopping || nanoseconds(std::chrono::steady_clock::now()) > FlushDeadline + STALLED_STREAM))
+			FlushEnd = Head;
+
+		if(FlushNext < Head && FlushNext < FlushEnd)
+		{
+			// the slot is not overwritten before FlushNext moves past it
+			size_t slot = FlushNext % Capacity;
+			RecordedFrame record = Records[slot];
+			lock.unlock();
+			bool written = EventRecorder->write(Arena + slot*SlotBytes, record, true);
+			lock.lock();
+			++FlushNext;
+			if(written)
+				++Statistics.Flushed;
+		}
+		else if(FlushNext == FlushEnd)
+		{
+			std::unique_ptr<Recorder> recorder = std::move(EventRecorder);
+			lock.unlock();
+			std::exception_ptr error;
+			try
+			{
+				recorder->close();
+			}
+			catch(const std::system_error&)
+			{
+				error = std::current_exception();
+			}
+			recorder.reset();
+			lock.lock();
+			FlushError = error;
+			Flushing = false;
+			EventFlushed.notify_all();
+		}
+		else if(FlushEnd == UNKNOWN_END)
+		{
+			FrameAdded.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(FlushDeadline + STALLED_STREAM))));
+		}
+		else
+		{
+			FrameAdded.wait(lock);
+		}
+	}
+}
+
+}
@@ -0,0 +1,91 @@
+#ifndef UEYE_HISTORY_HPP
+#define UEYE_HISTORY_HPP
+
+#include "ueye_recorder.hpp"
+#include <exception>
+#include <memory>
+
+namespace ueye{
+
+struct HistoryStatistics
+{
+	uint64_t Frames; // copied into the history
+	uint64_t Dropped; // too large, or the history full of frames not flushed yet
+	uint64_t Events;
+	uint64_t Flushed; // frames written to event recordings
+	size_t Retained; // frames in the history
+	size_t Backlog; // frames of the current event not written yet
+};
+
+// Keeps the last frames of a stream in memory, and writes them to a recording
+// when an event occurs, followed by the frames of the next seconds. The frames
+// live in a ring of slots allocated up front, each new one overwriting the
+// oldest, so that what happened before an event is still there when it is
+// triggered. Events are flushed by a background thread through a Recorder
+// while the history keeps filling ; a frame that would overwrite one not
+// flushed yet is dropped instead. Frames are pushed one at a time, in order.
+class FrameHistory
+{
+	public:
+	// frame_bytes is the largest frame data, see Recorder::frameBytes() ;
+	// capacity frames are kept, up to duration seconds old when duration is
+	// not 0. The ring is taken from allocator, huge pages by default.
+	FrameHistory(size_t frame_bytes, size_t capacity, double duration=0.0, ImageAllocator *allocator=NULL);
+	// finishes the event in progress
+	~FrameHistory();
+
+	// copies the frame into the history, false when it is dropped or not
+	// valid
+	bool push(const Frame &frame);
+	bool push(const ImageMemory &memory, const FrameInfo &info);
+
+	// Writes the frames in the history, then those taken within post_seconds,
+	// to a new recording at path. Returns false while the previous event is
+	// being flushed.
+	bool trigger(const std::string &path, double post_seconds=0.0);
+	bool isFlushing() const;
+	// false on timeout ; throws the std::system_error of a recording that
+	// could not be opened or written
+	bool waitFlushed(uint32_t timeout=10000);
+
+	size_t capacity() const;
+	HistoryStatistics getStatistics() const;
+
+	private:
+	FrameHistory(const FrameHistory&); // non construction-copyable
+	FrameHistory& operator=(const FrameHistory&); // non copyable
+
+	void flushLoop();
+
+	size_t FrameBytes;
+	size_t Capacity;
+	int64_t Duration; // ns, 0 without limit
+	HugePageAllocator DefaultAllocator;
+	ImageAllocator *Allocator;
+	size_t SlotBytes;
+	char *Arena;
+	// frame n is in slot n % Capacity, frames Tail to Head are retained
+	std::vector<RecordedFrame> Records;
+	uint64_t Head;
+	uint64_t Tail;
+	// event in progress : frames FlushNext to FlushEnd, FlushEnd being only
+	// known once FlushDeadline has passed
+	bool Flushing;
+	std::string EventPath;
+	std::unique_ptr<Recorder> EventRecorder; // opened by the flusher
+	uint64_t FlushNext;
+	uint64_t FlushEnd;
+	int64_t FlushDeadline; // ns, on the host clock
+	std::exception_ptr FlushError;
+	bool Stopping;
+	HistoryStatistics Statistics;
+	std::mutex PushMutex; // one push at a time
+	mutable std::mutex Mutex;
+	std::condition_variable FrameAdded;
+	std::condition_variable EventFlushed;
+	std::thread Flusher;
+};
+
+}
+
+#endif
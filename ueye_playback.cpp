@@ -0,0 +1,366 @@
+#include "ueye_playback.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace{
+	size_t roundUp(size_t size, size_t alignment)
+	{
+		return (size + alignment - 1) / alignment * alignment;
+	}
+
+	// ns on the device clock, or on the recording host without device timestamps
+	int64_t recordedTime(const ueye::RecordedFrame &frame)
+	{
+		return frame.DeviceTimestamp ? (int64_t)frame.DeviceTimestamp*100 : frame.HostTimestamp;
+	}
+
+	bool validFrame(const ueye::RecordedFrame &frame, size_t file_bytes)
+	{
+		return frame.Magic == ueye::RECORDED_FRAME_MAGIC && frame.Offset >= sizeof(ueye::RecordedFrame)
+			&& frame.Offset <= file_bytes && frame.Size <= file_bytes - frame.Offset;
+	}
+}
+
+namespace ueye{
+
+RecordingReader::RecordingReader(const std::string &path):
+	Data(NULL), Bytes(0), Index(NULL), Count(0)
+{
+	int file = ::open(path.c_str(), O_RDONLY);
+	if(file < 0)
+		throw std::system_error(errno, std::system_category(), "open " + path);
+	struct stat status;
+	if(::fstat(file, &status) != 0)
+	{
+		int error = errno;
+		::close(file);
+		throw std::system_error(error, std::system_category(), "stat " + path);
+	}
+	Bytes = status.st_size;
+	if(Bytes < RECORDING_ALIGNMENT)
+	{
+		::close(file);
+		throw std::runtime_error(path + " is not a recording");
+	}
+	void *data = ::mmap(NULL, Bytes, PROT_READ, MAP_SHARED, file, 0);
+	int error = errno;
+	// the mapping keeps its own reference to the file
+	::close(file);
+	if(data == MAP_FAILED)
+		throw std::system_error(error, std::system_category(), "mmap " + path);
+	Data = static_cast<char*>(data);
+	::madvise(Data, Bytes, MADV_SEQUENTIAL);
+
+	const RecordingHeader *header = reinterpret_cast<const RecordingHeader*>(Data);
+	if(std::memcmp(header->Magic, "UEYEREC", 8) != 0 || header->Version != RECORDING_VERSION || header->Alignment != RECORDING_ALIGNMENT)
+	{
+		::munmap(Data, Bytes);
+		throw std::runtime_error(path + " is not a recording");
+	}
+	if(header->IndexOffset && header->IndexOffset <= Bytes && header->FrameCount <= (Bytes - header->IndexOffset)/sizeof(RecordedFrame))
+	{
+		Index = reinterpret_cast<const RecordedFrame*>(Data + header->IndexOffset);
+		Count = header->FrameCount;
+		for(size_t i=0; i<Count && Index; ++i)
+		{
+			if(!validFrame(Index[i], Bytes))
+				Index = NULL;
+		}
+	}
+	if(!Index)
+		rebuildIndex();
+}
+
+RecordingReader::~RecordingReader()
+{
+	::munmap(Data, Bytes);
+}
+
+size_t RecordingReader::size() const
+{
+	return Count;
+}
+
+const RecordedFrame& RecordingReader::frame(size_t index) const
+{
+	return Index[index];
+}
+
+cv::Mat RecordingReader::view(size_t index) const
+{
+	const RecordedFrame &frame = Index[index];
+	CV_Assert(frame.Encoding == ENCODING_RAW);
+	cv::Mat view = pixelView(Data + frame.Offset, frame.Width, frame.Height, frame.Pitch, frame.ColorMode);
+	CV_Assert(view.step[0]*view.rows <= frame.Size);
+	return view;
+}
+
+void RecordingReader::decode(size_t index, cv::Mat &mat, WorkerPool *pool) const
+{
+	const RecordedFrame &frame = Index[index];
+	if(frame.Encoding == ENCODING_RAW)
+	{
+		view(index).copyTo(mat);
+		return;
+	}
+	CV_Assert(frame.Encoding == ENCODING_TILES && TileCodec::isSupported(frame.ColorMode));
+	mat.create(frame.Height*pixelViewRows(frame.ColorMode), frame.Width, pixelMatType(frame.ColorMode));
+	TileCodec(pool).decode(Data + frame.Offset, frame.Size, frame.ColorMode, mat);
+}
+
+size_t RecordingReader::find(uint64_t device_timestamp) const
+{
+	const RecordedFrame *frame = std::lower_bound(Index, Index+Count, device_timestamp,
+		[](const RecordedFrame &frame, uint64_t timestamp){return frame.DeviceTimestamp < timestamp;});
+	return frame - Index;
+}
+
+bool RecordingReader::isComplete() const
+{
+	return RebuiltIndex.empty() && Index;
+}
+
+void RecordingReader::prefetch(size_t index) const
+{
+	if(index >= Count)
+		return;
+	// madvise needs a page aligned start
+	size_t begin = (Index[index].Offset - sizeof(RecordedFrame)) / RECORDING_ALIGNMENT * RECORDING_ALIGNMENT;
+	size_t end = std::min(Index[index].Offset + Index[index].Size, Bytes);
+	::madvise(Data + begin, end - begin, MADV_WILLNEED);
+}
+
+void RecordingReader::rebuildIndex()
+{
+	// records follow each other on alignment boundaries, up to the first
+	// one not completely written
+	for(size_t offset = RECORDING_ALIGNMENT; offset + sizeof(RecordedFrame) <= Bytes; )
+	{
+		const RecordedFrame &frame = *reinterpret_cast<const RecordedFrame*>(Data + offset);
+		if(!validFrame(frame, Bytes) || frame.Offset != offset + sizeof(RecordedFrame))
+			break;
+		RebuiltIndex.push_back(frame);
+		offset = roundUp(frame.Offset + frame.Size, RECORDING_ALIGNMENT);
+	}
+	Index = RebuiltIndex.data();
+	Count = RebuiltIndex.size();
+}
+
+
+Playback::Buffer::Buffer():
+	Memory(NULL, 0, 0, 0, 0), Leased(false)
+{}
+
+Playback::Playback(const RecordingReader &reader, PlaybackMode mode, bool loop, WorkerPool *pool, size_t buffers):
+	Reader(reader), Pool(pool), Mode(mode), Loop(loop), Position(0), Anchored(false), AnchorTimestamp(0), LastFrameNumber(0), LastFrameNumberValid(false),
+	Buffers(std::max<size_t>(buffers, 1)), LeaseOwner(std::make_shared<std::atomic<FrameSource*> >(this))
+{}
+
+Playback::~Playback()
+{
+	// leases left are detached, their buffers go with the playback
+	LeaseOwner->store(NULL);
+}
+
+PlaybackMode Playback::mode() const
+{
+	return Mode;
+}
+
+void Playback::setMode(PlaybackMode mode)
+{
+	Mode = mode;
+	Anchored = false;
+}
+
+void Playback::seek(size_t index)
+{
+	Position = std::min(index, Reader.size());
+	Anchored = false;
+	LastFrameNumberValid = false;
+}
+
+size_t Playback::position() const
+{
+	return Position;
+}
+
+INT Playback::tryWaitNextFrame(Frame &frame, uint32_t timeout)
+{
+	// its buffer may be the only one left
+	if(frame.Owner == LeaseOwner)
+		tryUnlock(frame);
+	if(Position >= Reader.size())
+	{
+		if(!Loop || Reader.size() == 0)
+			return IS_NO_SUCCESS;
+		seek(0);
+	}
+	const RecordedFrame &record = Reader.frame(Position);
+	std::chrono::steady_clock::time_point due;
+	if(Mode == PLAYBACK_REAL_TIME)
+	{
+		due = dueTime();
+		if(due - std::chrono::steady_clock::now() > std::chrono::milliseconds(timeout))
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+			return IS_TIMED_OUT;
+		}
+	}
+	else
+	{
+		Reader.prefetch(Position+1);
+	}
+	Buffer *buffer = leaseBuffer(timeout);
+	if(!buffer)
+		return IS_TIMED_OUT;
+	// decoded while waiting for the frame to be due
+	decodeFrame(*buffer);
+	if(Mode == PLAYBACK_REAL_TIME)
+		std::this_thread::sleep_until(due);
+
+	FrameInfo info = FrameInfo();
+	info.DeviceTimestamp = record.DeviceTimestamp;
+	info.FrameNumber = record.FrameNumber;
+	info.Width = record.Width;
+	info.Height = record.Height;
+	info.BufferCount = Buffers.size();
+	info.HostTimestamp = std::chrono::steady_clock::now();
+	if(LastFrameNumberValid && record.FrameNumber > LastFrameNumber+1)
+		info.LostBefore = record.FrameNumber - LastFrameNumber - 1;
+	LastFrameNumber = record.FrameNumber;
+	LastFrameNumberValid = true;
+	frame = Frame(LeaseOwner, &buffer->Memory, Position, info);
+	++Position;
+	return IS_SUCCESS;
+}
+
+INT Playback::tryUnlock(Frame &frame)
+{
+	if(!frame.Owner)
+		return IS_SUCCESS;
+	frame.Owner.reset();
+	{
+		std::lock_guard<std::mutex> lock(BufferMutex);
+		for(size_t i=0; i<Buffers.size(); ++i)
+		{
+			if(&Buffers[i].Memory == frame.Memory)
+				Buffers[i].Leased = false;
+		}
+	}
+	BufferReleased.notify_all();
+	return IS_SUCCESS;
+}
+
+void Playback::unlockFrame(Frame &frame)
+{
+	tryUnlock(frame);
+}
+
+void Playback::enableFrameEvent()
+{}
+
+void Playback::disableFrameEvent()
+{}
+
+INT Playback::tryWaitFrameEvent(uint32_t timeout)
+{
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+	if(Position >= Reader.size() && (!Loop || Reader.size() == 0))
+	{
+		std::this_thread::sleep_until(deadline);
+		return IS_TIMED_OUT;
+	}
+	// a loop restarts the schedule, its first frame being due at once
+	if(Mode == PLAYBACK_REAL_TIME && Position < Reader.size())
+	{
+		std::chrono::steady_clock::time_point due = dueTime();
+		if(due > deadline)
+		{
+			std::this_thread::sleep_until(deadline);
+			return IS_TIMED_OUT;
+		}
+		std::this_thread::sleep_until(due);
+	}
+	std::unique_lock<std::mutex> lock(BufferMutex);
+	bool free = BufferReleased.wait_until(lock, deadline, [this]{
+		for(size_t i=0; i<Buffers.size(); ++i)
+		{
+			if(!Buffers[i].Leased)
+				return true;
+		}
+		return false;
+	});
+	return free ? IS_SUCCESS : IS_TIMED_OUT;
+}
+
+std::chrono::steady_clock::time_point Playback::dueTime()
+{
+	int64_t time = recordedTime(Reader.frame(Position));
+	// restarts the schedule when time goes back, after a seek or a loop
+	if(!Anchored || time < AnchorTimestamp)
+	{
+		Anchored = true;
+		AnchorTime = std::chrono::steady_clock::now();
+		AnchorTimestamp = time;
+	}
+	return AnchorTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(time - AnchorTimestamp));
+}
+
+Playback::Buffer* Playback::leaseBuffer(uint32_t timeout)
+{
+	std::unique_lock<std::mutex> lock(BufferMutex);
+	Buffer *buffer = NULL;
+	BufferReleased.wait_for(lock, std::chrono::milliseconds(timeout), [this, &buffer]{
+		for(size_t i=0; i<Buffers.size() && !buffer; ++i)
+		{
+			if(!Buffers[i].Leased)
+				buffer = &Buffers[i];
+		}
+		return buffer != NULL;
+	});
+	if(buffer)
+		buffer->Leased = true;
+	return buffer;
+}
+
+void Playback::decodeFrame(Buffer &buffer)
+{
+	const RecordedFrame &record = Reader.frame(Position);
+	// the mapping is read only, and so are the frames of a playback
+	if(record.Encoding == ENCODING_RAW)
+	{
+		buffer.Memory = ImageMemory(reinterpret_cast<char*>(Reader.view(Position).data), record.Width, record.Height, record.Pitch, record.ColorMode);
+		return;
+	}
+	Reader.decode(Position, buffer.Decoded, Pool);
+	// the pitch covers the rows of every plane of an image line
+	int32_t pitch = buffer.Decoded.step[0]*pixelViewRows(record.ColorMode);
+	buffer.Memory = ImageMemory(reinterpret_cast<char*>(buffer.Decoded.data), record.Width, record.Height, pitch, record.ColorMode);
+}
+
+Frame Playback::nextFrame(uint32_t timeout)
+{
+	Frame frame;
+	INT err = tryWaitNextFrame(frame, timeout);
+	if(err == IS_TIMED_OUT)
+		throw std::runtime_error("timeout while waiting for the next recorded frame");
+	if(err != IS_SUCCESS)
+		throw std::runtime_error("end of the recording");
+	return frame;
+}
+
+cv::Mat Playback::waitNextView(uint32_t timeout)
+{
+	return leasedView(nextFrame(timeout));
+}
+
+}
@@ -0,0 +1,139 @@
+#ifndef UEYE_PLAYBACK_HPP
+#define UEYE_PLAYBACK_HPP
+
+#include "ueye_recorder.hpp"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace ueye{
+
+// Read-only memory mapping of a recording made by Recorder. Frames are read
+// in place from the mapping, and found in O(1) through the index ; the index
+// of a recording that was not closed is rebuilt from the records.
+class RecordingReader
+{
+	public:
+	// throws std::system_error when the file can not be mapped, and
+	// std::runtime_error when it is not a recording
+	explicit RecordingReader(const std::string &path);
+	~RecordingReader();
+
+	size_t size() const;
+	const RecordedFrame& frame(size_t index) const;
+	// the frame data laid out as by ImageMemory::view(), sharing the mapping ;
+	// only for ENCODING_RAW frames
+	cv::Mat view(size_t index) const;
+	// copy of the frame data laid out as by view(), encoded frames being
+	// decoded with their tiles in parallel on pool
+	void decode(size_t index, cv::Mat &mat, WorkerPool *pool=NULL) const;
+	// first frame with a device timestamp at or after timestamp, size() when
+	// none ; device timestamps only increase within a recording
+	size_t find(uint64_t device_timestamp) const;
+	// false when the index was rebuilt
+	bool isComplete() const;
+	// asks the kernel to read the frame ahead
+	void prefetch(size_t index) const;
+
+	private:
+	RecordingReader(const RecordingReader&); // non construction-copyable
+	RecordingReader& operator=(const RecordingReader&); // non copyable
+
+	void rebuildIndex();
+
+	char *Data;
+	size_t Bytes;
+	const RecordedFrame *Index;
+	size_t Count;
+	std::vector<RecordedFrame> RebuiltIndex;
+};
+
+enum PlaybackMode
+{
+	PLAYBACK_REAL_TIME, // at the intervals of the device timestamps
+	PLAYBACK_MAX_THROUGHPUT // as fast as frames are consumed
+};
+
+// Serves the frames of a recording as a FrameSource : like a capturing Camera,
+// to CaptureDispatcher, and through Frame to Recorder, FrameHistory and
+// SharedFramePublisher. Raw frames are served in place from the mapping,
+// encoded ones decoded into a buffer of the playback ; a frame holds its
+// buffer until it is released, and no frame is served while all are held. In
+// real time, frames are never skipped : a consumer slower than the recording
+// falls behind. Frames may be released on any thread ; the rest is not thread
+// safe, like the capture path of a Camera.
+class Playback: public FrameSource
+{
+	public:
+	// encoded frames are decoded on pool ; at most buffers frames are held at
+	// once
+	explicit Playback(const RecordingReader &reader, PlaybackMode mode=PLAYBACK_REAL_TIME, bool loop=false, WorkerPool *pool=NULL, size_t buffers=4);
+	// leases left are detached
+	~Playback();
+
+	PlaybackMode mode() const;
+	void setMode(PlaybackMode mode);
+	// next frame served, in O(1) ; real time restarts from it
+	void seek(size_t index);
+	size_t position() const;
+
+	// Like Camera::tryWaitNextFrame : IS_SUCCESS, IS_TIMED_OUT when the next
+	// frame is not due or no buffer is free within timeout, or IS_NO_SUCCESS
+	// at the end of a recording played without loop. A frame of the playback
+	// passed in is released first. HostTimestamp is the time the frame was
+	// served, LostBefore counts the frame numbers missing from the recording.
+	virtual INT tryWaitNextFrame(Frame &frame, uint32_t timeout=1000);
+	virtual INT tryUnlock(Frame &frame);
+	virtual void unlockFrame(Frame &frame);
+	// signaled when the next frame is due and a buffer is free, with nothing
+	// to enable
+	virtual void enableFrameEvent();
+	virtual void disableFrameEvent();
+	virtual INT tryWaitFrameEvent(uint32_t timeout);
+	// throw std::runtime_error on timeout or at the end
+	Frame nextFrame(uint32_t timeout=1000);
+	// the Mat holds the frame until its last reference is released
+	cv::Mat waitNextView(uint32_t timeout=1000);
+
+	private:
+	Playback(const Playback&); // non construction-copyable
+	Playback& operator=(const Playback&); // non copyable
+
+	struct Buffer
+	{
+		Buffer();
+
+		ImageMemory Memory; // on the mapping or on Decoded
+		cv::Mat Decoded;
+		bool Leased;
+	};
+
+	// when the frame at Position is due, anchoring the real time schedule
+	std::chrono::steady_clock::time_point dueTime();
+	// a buffer taken for the frame at Position, NULL on timeout
+	Buffer* leaseBuffer(uint32_t timeout);
+	// into buffer, for the frame at Position
+	void decodeFrame(Buffer &buffer);
+
+	const RecordingReader &Reader;
+	WorkerPool *Pool;
+	PlaybackMode Mode;
+	bool Loop;
+	size_t Position;
+	// real time schedule : the frame of AnchorTimestamp is due at AnchorTime
+	bool Anchored;
+	std::chrono::steady_clock::time_point AnchorTime;
+	int64_t AnchorTimestamp;
+	uint64_t LastFrameNumber;
+	bool LastFrameNumberValid;
+	// in a deque for stable addresses, the leases pointing to their memory
+	std::deque<Buffer> Buffers;
+	std::mutex BufferMutex; // Leased, released on any thread
+	std::condition_variable BufferReleased;
+	// shared with the leases, cleared by the destructor
+	std::shared_ptr<std::atomic<FrameSource*> > LeaseOwner;
+};
+
+}
+
+#endif
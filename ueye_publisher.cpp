@@ -0,0 +1,191 @@
+#include "ueye_publisher.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace{
+	size_t roundUp(size_t bytes, size_t alignment)
+	{
+		return (bytes + alignment - 1) / alignment * alignment;
+	}
+}
+
+namespace ueye{
+
+SharedFramePublisher::SharedFramePublisher(const std::string &name, size_t frame_bytes, size_t slots, size_t max_lag):
+	Name(name), Header(NULL), Bytes(0), Published(0), Dropped(0), DroppedSincePublished(0)
+{
+	slots = std::min(std::max<size_t>(slots, 1), MAX_SHARED_SLOTS);
+	size_t slot_bytes = roundUp(std::max<size_t>(frame_bytes, 1), SHARED_RING_ALIGNMENT);
+	size_t data_offset = roundUp(sizeof(SharedRingHeader), SHARED_RING_ALIGNMENT);
+	Bytes = data_offset + slots*slot_bytes;
+
+	// subscribers of a ring left behind keep their mapping of it
+	::shm_unlink(Name.c_str());
+	int file = ::shm_open(Name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+	if(file < 0)
+		throw std::system_error(errno, std::system_category(), "shm_open " + Name);
+	void *data = MAP_FAILED;
+	if(::ftruncate(file, Bytes) == 0)
+		data = ::mmap(NULL, Bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	int error = errno;
+	::close(file);
+	if(data == MAP_FAILED)
+	{
+		::shm_unlink(Name.c_str());
+		throw std::system_error(error, std::system_category(), "map " + Name);
+	}
+	Header = static_cast<SharedRingHeader*>(data);
+	Header->Version = SHARED_RING_VERSION;
+	Header->SlotCount = slots;
+	Header->SlotBytes = slot_bytes;
+	Header->DataOffset = data_offset;
+	Header->MaxLag = max_lag == 0 ? std::max<size_t>(slots/2, 1) : std::min(max_lag, slots);
+
+	pthread_mutexattr_t mutex_attributes;
+	pthread_mutexattr_init(&mutex_attributes);
+	pthread_mutexattr_setpshared(&mutex_attributes, PTHREAD_PROCESS_SHARED);
+	pthread_mutexattr_setrobust(&mutex_attributes, PTHREAD_MUTEX_ROBUST);
+	pthread_mutex_init(&Header->Mutex, &mutex_attributes);
+	pthread_mutexattr_destroy(&mutex_attributes);
+
+	// subscribers only accept the ring once it is initialized
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(Header->Magic, "UEYESHM", 8);
+}
+
+SharedFramePublisher::~SharedFramePublisher()
+{
+	lockSharedRing(*Header);
+	Header->Closed = 1;
+	wakeSubscribers();
+	pthread_mutex_unlock(&Header->Mutex);
+	::munmap(Header, Bytes);
+	::shm_unlink(Name.c_str());
+}
+
+bool SharedFramePublisher::publish(const Frame &frame)
+{
+	// its memory may be gone with the camera
+	if(!frame.valid())
+		return false;
+	return publish(*frame.memory(), frame.info());
+}
+
+bool SharedFramePublisher::publish(const ImageMemory &memory, const FrameInfo &info)
+{
+	std::lock_guard<std::mutex> publish_lock(PublishMutex);
+	// the pitch of planar formats covers all their planes
+	size_t size = (size_t)memory.pitch()*memory.height();
+	cv::Mat view = memory.view();
+	size_t slot = MAX_SHARED_SLOTS;
+	lockSharedRing(*Header);
+	if(size <= Header->SlotBytes)
+	{
+		slot = freeSlot(std::numeric_limits<uint64_t>::max());
+		if(slot == MAX_SHARED_SLOTS)
+		{
+			// a subscriber that died may hold the slots
+			reapSubscribers(*Header);
+			slot = freeSlot(std::numeric_limits<uint64_t>::max());
+		}
+		// a stalled subscriber loses frames rather than the others
+		if(slot == MAX_SHARED_SLOTS)
+			slot = freeSlot(Header->MaxLag);
+	}
+	if(slot == MAX_SHARED_SLOTS)
+	{
+		pthread_mutex_unlock(&Header->Mutex);
+		++Dropped;
+		++DroppedSincePublished;
+		return false;
+	}
+	// not visible to subscribers while written
+	Header->Slots[slot].Sequence = 0;
+	pthread_mutex_unlock(&Header->Mutex);
+
+	char *data = reinterpret_cast<char*>(Header) + Header->DataOffset + slot*Header->SlotBytes;
+	std::memcpy(data, view.data, size);
+
+	lockSharedRing(*Header);
+	SharedSlot &shared = Header->Slots[slot];
+	shared.Size = size;
+	shared.DeviceTimestamp = info.DeviceTimestamp;
+	shared.HostTimestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(info.HostTimestamp.time_since_epoch()).count();
+	shared.FrameNumber = info.FrameNumber;
+	shared.LostBefore = info.LostBefore + DroppedSincePublished;
+	shared.ColorMode = memory.colorMode();
+	shared.Width = memory.width();
+	shared.Height = memory.height();
+	shared.Pitch = memory.pitch();
+	shared.ViewType = view.type();
+	shared.ViewRows = view.rows;
+	shared.ViewCols = view.cols;
+	shared.ViewStep = view.step[0];
+	shared.Sequence = ++Header->Sequence;
+	wakeSubscribers();
+	pthread_mutex_unlock(&Header->Mutex);
+	++Published;
+	DroppedSincePublished = 0;
+	return true;
+}
+
+PublisherStatistics SharedFramePublisher::getStatistics() const
+{
+	PublisherStatistics statistics;
+	{
+		std::lock_guard<std::mutex> publish_lock(PublishMutex);
+		statistics.Published = Published;
+		statistics.Dropped = Dropped;
+	}
+	statistics.Subscribers = 0;
+	lockSharedRing(*Header);
+	for(size_t i=0; i<MAX_SUBSCRIBERS; ++i)
+	{
+		if(Header->Subscribers[i].Pid)
+			++statistics.Subscribers;
+	}
+	pthread_mutex_unlock(&Header->Mutex);
+	return statistics;
+}
+
+void SharedFramePublisher::wakeSubscribers()
+{
+	for(size_t i=0; i<MAX_SUBSCRIBERS; ++i)
+	{
+		SharedSubscriber &subscriber = Header->Subscribers[i];
+		int posted = 0;
+		// one pending post is enough to wake a subscriber
+		if(subscriber.Pid && sem_getvalue(&subscriber.FramePublished, &posted) == 0 && posted <= 0)
+			sem_post(&subscriber.FramePublished);
+	}
+}
+
+size_t SharedFramePublisher::freeSlot(uint64_t max_lag) const
+{
+	// frames before the next one of every subscriber are read
+	uint64_t read = Header->Sequence + 1;
+	for(size_t i=0; i<MAX_SUBSCRIBERS; ++i)
+	{
+		const SharedSubscriber &subscriber = Header->Subscribers[i];
+		if(subscriber.Pid && Header->Sequence + 1 - subscriber.Next < max_lag)
+			read = std::min(read, subscriber.Next);
+	}
+	// the oldest frame is overwritten first
+	size_t found = MAX_SHARED_SLOTS;
+	for(size_t slot=0; slot<Header->SlotCount; ++slot)
+	{
+		const SharedSlot &shared = Header->Slots[slot];
+		if(shared.Readers == 0 && shared.Sequence < read && (found == MAX_SHARED_SLOTS || shared.Sequence < Header->Slots[found].Sequence))
+			found = slot;
+	}
+	return found;
+}
+
+}
@@ -0,0 +1,62 @@
+#ifndef UEYE_PUBLISHER_HPP
+#define UEYE_PUBLISHER_HPP
+
+#include "ueye.hpp"
+#include "ueye_shm.hpp"
+#include <mutex>
+
+namespace ueye{
+
+struct PublisherStatistics
+{
+	uint64_t Published;
+	uint64_t Dropped; // no slot free, or too large
+	size_t Subscribers;
+};
+
+// Publishes frames under a name for SharedFrameSubscriber of other processes.
+// Each frame is copied once into a shared slot, the SDK not being able to
+// capture into a shared object ; subscribers then read the slots in place,
+// each at its own pace, where sharing the sequence buffers would have tied
+// the sensor to the slowest of them.
+class SharedFramePublisher
+{
+	public:
+	// name as for shm_open, "/ueye0" ; slots of frame_bytes, see
+	// Recorder::frameBytes(). When no slot is free, a subscriber with at
+	// least max_lag frames published and not read yet loses its oldest one,
+	// rather than the publisher dropping the new frame ; 0 stands for half
+	// the slots. Replaces a ring left under name by a
+	// publisher that did not exit cleanly. Throws std::system_error.
+	SharedFramePublisher(const std::string &name, size_t frame_bytes, size_t slots=8, size_t max_lag=0);
+	// closes the ring and removes the name, subscribers keep their mapping
+	~SharedFramePublisher();
+
+	// false when the frame is dropped or not valid
+	bool publish(const Frame &frame);
+	bool publish(const ImageMemory &memory, const FrameInfo &info);
+
+	PublisherStatistics getStatistics() const;
+
+	private:
+	SharedFramePublisher(const SharedFramePublisher&); // non construction-copyable
+	SharedFramePublisher& operator=(const SharedFramePublisher&); // non copyable
+
+	// a free slot, written by no one and read by every subscriber with less
+	// than max_lag frames to read ; with the mutex locked
+	size_t freeSlot(uint64_t max_lag) const;
+	// posts the semaphore of every subscriber ; with the mutex locked
+	void wakeSubscribers();
+
+	std::string Name;
+	SharedRingHeader *Header;
+	size_t Bytes;
+	uint64_t Published;
+	uint64_t Dropped;
+	uint64_t DroppedSincePublished; // added to LostBefore of the next frame
+	mutable std::mutex PublishMutex; // one publish at a time
+};
+
+}
+
+#endif
@@ -0,0 +1,362 @@
+#include "ueye_recorder.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace{
+	// staged records gathered into one pwritev
+	const size_t MAX_GATHER = 16;
+
+	size_t roundUp(size_t size, size_t alignment)
+	{
+		return (size + alignment - 1) / alignment * alignment;
+	}
+
+	static_assert(sizeof(ueye::RecordedFrame) == 64, "RecordedFrame is part of the file format");
+	static_assert(sizeof(ueye::RecordingHeader) <= ueye::RECORDING_ALIGNMENT, "RecordingHeader fits its block");
+}
+
+namespace ueye{
+
+Recorder::Recorder(const std::string &path, size_t frame_bytes, size_t staging_frames, bool direct_io, const TileCodec *codec):
+	File(-1), DirectIO(false), Codec(codec), Allocator(RECORDING_ALIGNMENT), SlotBytes(roundUp(sizeof(RecordedFrame) + frame_bytes, RECORDING_ALIGNMENT)),
+	SlotCount(std::max<size_t>(staging_frames, 1)), Arena(NULL), Scratch(NULL), StagedHead(0), StagedCount(0), Copying(0), FileOffset(RECORDING_ALIGNMENT),
+	Error(0), Closing(false), Closed(false), OpenTime(std::chrono::steady_clock::now()), EncodedFrames(0), EncodeTime(0.0)
+{
+	std::memset(&Statistics, 0, sizeof(Statistics));
+	if(direct_io)
+	{
+		File = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+		DirectIO = File >= 0;
+	}
+	// tmpfs and some network file systems refuse O_DIRECT with EINVAL
+	if(File < 0)
+		File = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(File < 0)
+		throw std::system_error(errno, std::system_category(), "open " + path);
+
+	Arena = static_cast<char*>(Allocator.allocate(SlotBytes*SlotCount));
+	// touched now, so that the first frames do not fault the pages in
+	std::memset(Arena, 0, SlotBytes*SlotCount);
+	if(Codec)
+		Scratch = static_cast<char*>(Allocator.allocate(SlotBytes));
+	Free.reserve(SlotCount);
+	for(size_t i=SlotCount; i>0; --i)
+		Free.push_back(i-1);
+	Staged.resize(SlotCount);
+	Index.reserve(1024);
+
+	// the header is rewritten with the index offset when closing
+	RecordingHeader *header = reinterpret_cast<RecordingHeader*>(Arena);
+	std::memcpy(header->Magic, "UEYEREC", 8);
+	header->Version = RECORDING_VERSION;
+	header->Alignment = RECORDING_ALIGNMENT;
+	writeBlock(Arena, RECORDING_ALIGNMENT, 0);
+	if(Error)
+	{
+		::close(File);
+		Allocator.deallocate(Arena, SlotBytes*SlotCount);
+		if(Scratch)
+			Allocator.deallocate(Scratch, SlotBytes);
+		throw std::system_error(Error, std::system_category(), "write " + path);
+	}
+	Writer = std::thread(&Recorder::writerLoop, this);
+}
+
+Recorder::~Recorder()
+{
+	try
+	{
+		close();
+	}
+	catch(const std::system_error&)
+	{
+		// nothing more to do with a failed recording
+	}
+	Allocator.deallocate(Arena, SlotBytes*SlotCount);
+	if(Scratch)
+		Allocator.deallocate(Scratch, SlotBytes);
+}
+
+bool Recorder::write(const Frame &frame, bool block)
+{
+	// its memory may be gone with the camera
+	if(!frame.valid())
+		return false;
+	return write(*frame.memory(), frame.info(), block);
+}
+
+bool Recorder::write(const ImageMemory &memory, const FrameInfo &info, bool block)
+{
+	return write(memory.view().data, frameRecord(memory, info), block);
+}
+
+bool Recorder::write(const void *data, const RecordedFrame &frame, bool block)
+{
+	size_t slot;
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		if(block)
+			SlotFreed.wait(lock, [this]{return !Free.empty() || Error || Closing;});
+		if(Free.empty() || Error || Closing || sizeof(RecordedFrame) + frame.Size > SlotBytes)
+		{
+			++Statistics.Dropped;
+			return false;
+		}
+		slot = Free.back();
+		Free.pop_back();
+		++Copying;
+	}
+
+	// the offset is set by the writer, which also encodes the frame
+	char *record = Arena + slot*SlotBytes;
+	RecordedFrame *header = reinterpret_cast<RecordedFrame*>(record);
+	*header = frame;
+	header->Offset = 0;
+	header->Magic = RECORDED_FRAME_MAGIC;
+	std::memcpy(record + sizeof(RecordedFrame), data, frame.Size);
+
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Staged[(StagedHead + StagedCount) % SlotCount] = slot;
+		++StagedCount;
+		--Copying;
+		Statistics.MaxBacklog = std::max(Statistics.MaxBacklog, StagedCount);
+	}
+	SlotStaged.notify_one();
+	return true;
+}
+
+void Recorder::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		if(Closed)
+			return;
+		Closed = true;
+		Closing = true;
+	}
+	SlotStaged.notify_all();
+	SlotFreed.notify_all();
+	if(Writer.joinable())
+		Writer.join();
+
+	// the writer only left once the frames being copied were written, every
+	// slot is free again and the first one holds the index blocks
+	if(!Error)
+	{
+		uint64_t index_offset = FileOffset;
+		size_t index_bytes = Index.size()*sizeof(RecordedFrame);
+		for(size_t written = 0; written < index_bytes && !Error; )
+		{
+			size_t chunk = std::min(index_bytes - written, SlotBytes);
+			std::memcpy(Arena, reinterpret_cast<const char*>(Index.data()) + written, chunk);
+			std::memset(Arena + chunk, 0, roundUp(chunk, RECORDING_ALIGNMENT) - chunk);
+			writeBlock(Arena, roundUp(chunk, RECORDING_ALIGNMENT), FileOffset);
+			FileOffset += roundUp(chunk, RECORDING_ALIGNMENT);
+			written += chunk;
+		}
+		std::memset(Arena, 0, RECORDING_ALIGNMENT);
+		RecordingHeader *header = reinterpret_cast<RecordingHeader*>(Arena);
+		std::memcpy(header->Magic, "UEYEREC", 8);
+		header->Version = RECORDING_VERSION;
+		header->Alignment = RECORDING_ALIGNMENT;
+		header->IndexOffset = index_offset;
+		header->FrameCount = Index.size();
+		if(!Error)
+			writeBlock(Arena, RECORDING_ALIGNMENT, 0);
+		if(!Error && ::fdatasync(File) != 0)
+			Error = errno;
+	}
+	::close(File);
+	File = -1;
+	if(Error)
+		throw std::system_error(Error, std::system_category(), "recording write");
+}
+
+bool Recorder::isDirectIO() const
+{
+	return DirectIO;
+}
+
+RecorderStatistics Recorder::getStatistics() const
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	RecorderStatistics statistics = Statistics;
+	statistics.Backlog = StagedCount;
+	double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - OpenTime).count();
+	statistics.WriteRate = duration > 0 ? statistics.Bytes/duration : 0.0;
+	statistics.CompressionRatio = statistics.StoredBytes ? (double)statistics.DataBytes/statistics.StoredBytes : 1.0;
+	statistics.MeanEncodeLatency = EncodedFrames ? EncodeTime/EncodedFrames : 0.0;
+	return statistics;
+}
+
+size_t Recorder::frameBytes(const ImageMemory &memory)
+{
+	// the pitch of planar formats covers all their planes
+	return (size_t)memory.pitch()*memory.height();
+}
+
+RecordedFrame Recorder::frameRecord(const ImageMemory &memory, const FrameInfo &info)
+{
+	RecordedFrame frame = RecordedFrame();
+	frame.Size = frameBytes(memory);
+	frame.DeviceTimestamp = info.DeviceTimestamp;
+	frame.HostTimestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(info.HostTimestamp.time_since_epoch()).count();
+	frame.FrameNumber = info.FrameNumber;
+	frame.ColorMode = memory.colorMode();
+	frame.Width = memory.width();
+	frame.Height = memory.height();
+	frame.Pitch = memory.pitch();
+	frame.Encoding = ENCODING_RAW;
+	frame.Magic = RECORDED_FRAME_MAGIC;
+	return frame;
+}
+
+void Recorder::writerLoop()
+{
+	size_t slots[MAX_GATHER];
+	struct iovec iov[MAX_GATHER];
+	std::unique_lock<std::mutex> lock(Mutex);
+	for(;;)
+	{
+		SlotStaged.wait(lock, [this]{return StagedCount > 0 || (Closing && Copying == 0);});
+		if(StagedCount == 0)
+			break;
+		size_t count = std::min(StagedCount, MAX_GATHER);
+		for(size_t i=0; i<count; ++i)
+			slots[i] = Staged[(StagedHead + i) % SlotCount];
+		bool failed = Error != 0;
+		lock.unlock();
+
+		// encoded here rather than in write(), off the capture thread
+		uint64_t data_bytes = 0, stored_bytes = 0, encoded = 0;
+		double encode_time = 0.0, max_encode_time = 0.0;
+		for(size_t i=0; i<count && !failed; ++i)
+		{
+			RecordedFrame *header = reinterpret_cast<RecordedFrame*>(Arena + slots[i]*SlotBytes);
+			data_bytes += header->Size;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			if(encode(header))
+			{
+				double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				encode_time += time;
+				max_encode_time = std::max(max_encode_time, time);
+				++encoded;
+			}
+			stored_bytes += header->Size;
+		}
+
+		uint64_t offset = FileOffset;
+		size_t bytes = 0;
+		for(size_t i=0; i<count; ++i)
+		{
+			RecordedFrame *header = reinterpret_cast<RecordedFrame*>(Arena + slots[i]*SlotBytes);
+			header->Offset = offset + bytes + sizeof(RecordedFrame);
+			iov[i].iov_base = header;
+			iov[i].iov_len = roundUp(sizeof(RecordedFrame) + header->Size, RECORDING_ALIGNMENT);
+			bytes += iov[i].iov_len;
+		}
+		int error = 0;
+		for(size_t done = 0, first = 0; !failed && done < bytes; )
+		{
+			ssize_t written = ::pwritev(File, iov + first, count - first, offset + done);
+			if(written < 0 && errno == EINTR)
+				continue;
+			if(written <= 0)
+			{
+				error = written < 0 ? errno : EIO;
+				break;
+			}
+			// direct I/O resumes at the last whole block written
+			if(DirectIO)
+				written -= written % RECORDING_ALIGNMENT;
+			if(written == 0)
+			{
+				error = EIO;
+				break;
+			}
+			done += written;
+			// short writes resume within the partially written record
+			while(first < count && (size_t)written >= iov[first].iov_len)
+				written -= iov[first++].iov_len;
+			if(first < count)
+			{
+				iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + written;
+				iov[first].iov_len -= written;
+			}
+		}
+
+		lock.lock();
+		StagedHead = (StagedHead + count) % SlotCount;
+		StagedCount -= count;
+		Statistics.DataBytes += data_bytes;
+		Statistics.StoredBytes += stored_bytes;
+		EncodedFrames += encoded;
+		EncodeTime += encode_time;
+		Statistics.MaxEncodeLatency = std::max(Statistics.MaxEncodeLatency, max_encode_time);
+		if(failed || error)
+		{
+			if(!Error)
+				Error = error;
+			Statistics.Dropped += count;
+		}
+		else
+		{
+			FileOffset += bytes;
+			Statistics.Frames += count;
+			Statistics.Bytes += bytes;
+			for(size_t i=0; i<count; ++i)
+				Index.push_back(*reinterpret_cast<const RecordedFrame*>(Arena + slots[i]*SlotBytes));
+		}
+		for(size_t i=0; i<count; ++i)
+			Free.push_back(slots[i]);
+		SlotFreed.notify_all();
+	}
+}
+
+bool Recorder::encode(RecordedFrame *header)
+{
+	if(!Codec || header->Encoding != ENCODING_RAW || !TileCodec::isSupported(header->ColorMode))
+		return false;
+	char *data = reinterpret_cast<char*>(header + 1);
+	cv::Mat view = pixelView(data, header->Width, header->Height, header->Pitch, header->ColorMode);
+	// stored raw when the staging buffer can not hold the encoding
+	size_t bytes = Codec->encode(view, header->ColorMode, Scratch, SlotBytes - sizeof(RecordedFrame));
+	if(!bytes)
+		return false;
+	std::memcpy(data, Scratch, bytes);
+	header->Size = bytes;
+	header->Encoding = ENCODING_TILES;
+	return true;
+}
+
+void Recorder::writeBlock(const void *data, size_t size, uint64_t offset)
+{
+	for(size_t done = 0; done < size; )
+	{
+		ssize_t written = ::pwrite(File, static_cast<const char*>(data) + done, size - done, offset + done);
+		if(written < 0 && errno == EINTR)
+			continue;
+		if(written <= 0)
+		{
+			Error = written < 0 ? errno : EIO;
+			return;
+		}
+		// direct I/O resumes at the last whole block written
+		if(DirectIO)
+			written -= written % RECORDING_ALIGNMENT;
+		if(written == 0)
+		{
+			Error = EIO;
+			return;
+		}
+		done += written;
+	}
+}
+
+}
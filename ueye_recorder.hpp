@@ -0,0 +1,146 @@
+#ifndef UEYE_RECORDER_HPP
+#define UEYE_RECORDER_HPP
+
+#include "ueye.hpp"
+#include "ueye_allocator.hpp"
+#include "ueye_codec.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace ueye{
+
+// Recording file : a RecordingHeader block, then one record per frame, a
+// RecordedFrame followed by the frame data, each record starting on a
+// RECORDING_ALIGNMENT boundary, and at the end the index, the RecordedFrame
+// of every frame. The index offset is only set in the header once the
+// recording is closed ; before that, records can be found by their magic.
+const size_t RECORDING_ALIGNMENT = 4096;
+const uint32_t RECORDING_VERSION = 1;
+const uint32_t RECORDED_FRAME_MAGIC = 0x4d524655; // "UFRM"
+
+enum RecordEncoding
+{
+	ENCODING_RAW, // pitch times height bytes, laid out as by ImageMemory::view()
+	ENCODING_TILES // TileCodec, without the padding at the end of the lines
+};
+
+struct RecordingHeader
+{
+	char Magic[8]; // "UEYEREC"
+	uint32_t Version;
+	uint32_t Alignment;
+	uint64_t IndexOffset; // 0 when the recording was not closed
+	uint64_t FrameCount;
+};
+
+struct RecordedFrame
+{
+	uint64_t Offset; // of the data, in the file
+	uint64_t Size; // bytes of the data
+	uint64_t DeviceTimestamp; // camera clock, in 0.1 us
+	int64_t HostTimestamp; // ns, steady clock of the recording host
+	uint64_t FrameNumber;
+	int32_t ColorMode; // of the ImageMemory, with IS_CM_PREFER_PACKED_SOURCE_FORMAT for packed sources
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t Pitch;
+	uint32_t Encoding;
+	uint32_t Magic;
+};
+
+struct RecorderStatistics
+{
+	uint64_t Frames; // written to the file
+	uint64_t Dropped; // no staging buffer free, too large, or after a write error
+	uint64_t Bytes; // written, with headers and padding
+	size_t Backlog; // frames staged, waiting for the writer
+	size_t MaxBacklog;
+	double WriteRate; // bytes per second since the recorder was opened
+	uint64_t DataBytes; // of the frames taken by the writer, before encoding
+	uint64_t StoredBytes; // of the frames taken by the writer, after encoding
+	double CompressionRatio; // DataBytes over StoredBytes
+	double MeanEncodeLatency; // seconds per encoded frame
+	double MaxEncodeLatency;
+};
+
+// Records frames to a file from a dedicated writer thread. Each frame is
+// copied into a staging buffer aligned for O_DIRECT, and the writer gathers
+// the staged frames into a single pwritev : the disk, slow or stalling, only
+// ever holds up the writer. Direct I/O bypasses the page cache, which would
+// otherwise fill with frames never read again ; on file systems without
+// O_DIRECT support the file is written through the cache. With a codec, the
+// writer encodes the staged frames of the modes it supports on the codec pool
+// before writing them, so that encoding stays off the caller's thread too.
+class Recorder
+{
+	public:
+	// frame_bytes is the largest frame data, see frameBytes() ; the staging
+	// arena holds staging_frames frames, allocated up front ; the codec must
+	// outlive the recorder
+	Recorder(const std::string &path, size_t frame_bytes, size_t staging_frames=16, bool direct_io=true, const TileCodec *codec=NULL);
+	// closes the recording, ignoring errors
+	~Recorder();
+
+	// Stages the frame for the writer. Returns false when the frame is
+	// dropped : without block, when no staging buffer is free ; or when the
+	// frame is larger than frame_bytes, or after a write error. No
+	// allocation is done. A frame not valid anymore is not written either.
+	bool write(const Frame &frame, bool block=false);
+	bool write(const ImageMemory &memory, const FrameInfo &info, bool block=false);
+	// frame data described by frame, Offset and Magic being set here
+	bool write(const void *data, const RecordedFrame &frame, bool block=false);
+	// Writes the staged frames, the index and the header. Throws
+	// std::system_error when a write failed.
+	void close();
+
+	bool isDirectIO() const;
+	RecorderStatistics getStatistics() const;
+
+	// data bytes of the image in memory
+	static size_t frameBytes(const ImageMemory &memory);
+	// description of a raw frame, Offset being left to the recorder
+	static RecordedFrame frameRecord(const ImageMemory &memory, const FrameInfo &info);
+
+	private:
+	Recorder(const Recorder&); // non construction-copyable
+	Recorder& operator=(const Recorder&); // non copyable
+
+	void writerLoop();
+	// encodes the raw frame of the staging slot in place, through Scratch ;
+	// false when it is kept raw
+	bool encode(RecordedFrame *header);
+	void writeBlock(const void *data, size_t size, uint64_t offset);
+
+	int File;
+	bool DirectIO;
+	const TileCodec *Codec;
+	AlignedAllocator Allocator;
+	size_t SlotBytes;
+	size_t SlotCount;
+	char *Arena;
+	char *Scratch; // encoding output of the writer, with a codec
+	// free slots, and staged slots in a ring, sized for every slot
+	std::vector<size_t> Free;
+	std::vector<size_t> Staged;
+	size_t StagedHead;
+	size_t StagedCount;
+	size_t Copying; // slots taken by write() and not staged yet
+	std::vector<RecordedFrame> Index;
+	uint64_t FileOffset;
+	int Error; // errno of the first failed write
+	bool Closing;
+	bool Closed;
+	std::chrono::steady_clock::time_point OpenTime;
+	RecorderStatistics Statistics;
+	uint64_t EncodedFrames;
+	double EncodeTime; // seconds, over the encoded frames
+	mutable std::mutex Mutex;
+	std::condition_variable SlotStaged;
+	std::condition_variable SlotFreed;
+	std::thread Writer;
+};
+
+}
+
+#endif
@@ -0,0 +1,258 @@
+#include "ueye_shm.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace{
+	void recover(ueye::SharedRingHeader &header, int err)
+	{
+		// the owner died in the middle of an update, the ring is used as is
+		if(err == EOWNERDEAD)
+			pthread_mutex_consistent(&header.Mutex);
+	}
+
+	// sem_timedwait only takes deadlines on the realtime clock
+	struct timespec realtimeDeadline(uint32_t timeout)
+	{
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += timeout / 1000;
+		deadline.tv_nsec += (long)(timeout % 1000)*1000000;
+		if(deadline.tv_nsec >= 1000000000)
+		{
+			deadline.tv_sec += 1;
+			deadline.tv_nsec -= 1000000000;
+		}
+		return deadline;
+	}
+}
+
+namespace ueye{
+
+void lockSharedRing(SharedRingHeader &header)
+{
+	recover(header, pthread_mutex_lock(&header.Mutex));
+}
+
+void reapSubscribers(SharedRingHeader &header)
+{
+	for(size_t i=0; i<MAX_SUBSCRIBERS; ++i)
+	{
+		SharedSubscriber &subscriber = header.Subscribers[i];
+		if(subscriber.Pid == 0 || ::kill(subscriber.Pid, 0) == 0 || errno != ESRCH)
+			continue;
+		for(size_t slot=0; slot<header.SlotCount; ++slot)
+		{
+			if(subscriber.Held & (uint64_t(1) << slot))
+				--header.Slots[slot].Readers;
+		}
+		std::memset(&subscriber, 0, sizeof(subscriber));
+	}
+}
+
+
+SharedFrame::SharedFrame():
+	Owner(NULL), Slot(0), ColorMode(0), Info()
+{}
+
+SharedFrame::SharedFrame(SharedFrame &&frame):
+	Owner(frame.Owner), Slot(frame.Slot), ColorMode(frame.ColorMode), Info(frame.Info)
+{
+	frame.Owner = NULL;
+}
+
+SharedFrame::~SharedFrame()
+{
+	release();
+}
+
+SharedFrame& SharedFrame::operator=(SharedFrame &&frame)
+{
+	if(this != &frame)
+	{
+		release();
+		Owner = frame.Owner;
+		Slot = frame.Slot;
+		ColorMode = frame.ColorMode;
+		Info = frame.Info;
+		frame.Owner = NULL;
+	}
+	return *this;
+}
+
+bool SharedFrame::valid() const
+{
+	return Owner != NULL;
+}
+
+const FrameInfo& SharedFrame::info() const
+{
+	return Info;
+}
+
+int32_t SharedFrame::colorMode() const
+{
+	return ColorMode;
+}
+
+cv::Mat SharedFrame::view() const
+{
+	SharedRingHeader *header = Owner->Header;
+	const SharedSlot &slot = header->Slots[Slot];
+	char *data = reinterpret_cast<char*>(header) + header->DataOffset + Slot*header->SlotBytes;
+	return cv::Mat(slot.ViewRows, slot.ViewCols, slot.ViewType, data, slot.ViewStep);
+}
+
+void SharedFrame::release()
+{
+	if(Owner)
+		Owner->release(Slot);
+	Owner = NULL;
+}
+
+
+SharedFrameSubscriber::SharedFrameSubscriber(const std::string &name):
+	Header(NULL), Bytes(0), Index(0)
+{
+	int file = ::shm_open(name.c_str(), O_RDWR, 0);
+	if(file < 0)
+		throw std::system_error(errno, std::system_category(), "shm_open " + name);
+	struct stat status;
+	if(::fstat(file, &status) != 0)
+	{
+		int error = errno;
+		::close(file);
+		throw std::system_error(error, std::system_category(), "stat " + name);
+	}
+	Bytes = status.st_size;
+	if(Bytes < sizeof(SharedRingHeader))
+	{
+		::close(file);
+		throw std::runtime_error(name + " is not a frame ring");
+	}
+	void *data = ::mmap(NULL, Bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	int error = errno;
+	::close(file);
+	if(data == MAP_FAILED)
+		throw std::system_error(error, std::system_category(), "mmap " + name);
+	Header = static_cast<SharedRingHeader*>(data);
+	// the magic is written last by the publisher
+	if(std::memcmp(Header->Magic, "UEYESHM", 8) != 0 || Header->Version != SHARED_RING_VERSION)
+	{
+		::munmap(Header, Bytes);
+		throw std::runtime_error(name + " is not a frame ring");
+	}
+
+	lockSharedRing(*Header);
+	reapSubscribers(*Header);
+	for(Index=0; Index<MAX_SUBSCRIBERS && Header->Subscribers[Index].Pid; ++Index);
+	if(Index == MAX_SUBSCRIBERS)
+	{
+		pthread_mutex_unlock(&Header->Mutex);
+		::munmap(Header, Bytes);
+		throw std::runtime_error("no subscriber left on " + name);
+	}
+	SharedSubscriber &subscriber = Header->Subscribers[Index];
+	subscriber.Pid = ::getpid();
+	subscriber.Next = Header->Sequence + 1;
+	subscriber.Held = 0;
+	sem_init(&subscriber.FramePublished, 1, 0);
+	pthread_mutex_unlock(&Header->Mutex);
+}
+
+SharedFrameSubscriber::~SharedFrameSubscriber()
+{
+	lockSharedRing(*Header);
+	SharedSubscriber &subscriber = Header->Subscribers[Index];
+	for(size_t slot=0; slot<Header->SlotCount; ++slot)
+	{
+		if(subscriber.Held & (uint64_t(1) << slot))
+			--Header->Slots[slot].Readers;
+	}
+	sem_destroy(&subscriber.FramePublished);
+	std::memset(&subscriber, 0, sizeof(subscriber));
+	pthread_mutex_unlock(&Header->Mutex);
+	::munmap(Header, Bytes);
+}
+
+int SharedFrameSubscriber::tryWaitNextFrame(SharedFrame &frame, uint32_t timeout)
+{
+	frame.release();
+	struct timespec deadline = realtimeDeadline(timeout);
+	for(bool timed_out = false; ; )
+	{
+		lockSharedRing(*Header);
+		SharedSubscriber &subscriber = Header->Subscribers[Index];
+		// the next frame, or the oldest one left when it was lost
+		size_t found = MAX_SHARED_SLOTS;
+		for(size_t slot=0; slot<Header->SlotCount; ++slot)
+		{
+			uint64_t sequence = Header->Slots[slot].Sequence;
+			if(sequence >= subscriber.Next && (found == MAX_SHARED_SLOTS || sequence < Header->Slots[found].Sequence))
+				found = slot;
+		}
+		if(found != MAX_SHARED_SLOTS)
+		{
+			SharedSlot &slot = Header->Slots[found];
+			++slot.Readers;
+			subscriber.Held |= uint64_t(1) << found;
+			frame.Owner = this;
+			frame.Slot = found;
+			frame.ColorMode = slot.ColorMode;
+			frame.Info = FrameInfo();
+			frame.Info.DeviceTimestamp = slot.DeviceTimestamp;
+			frame.Info.FrameNumber = slot.FrameNumber;
+			// with the frames overwritten while the subscriber was behind
+			frame.Info.LostBefore = slot.LostBefore + (slot.Sequence - subscriber.Next);
+			subscriber.Next = slot.Sequence + 1;
+			frame.Info.Width = slot.Width;
+			frame.Info.Height = slot.Height;
+			frame.Info.HostTimestamp = std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(slot.HostTimestamp)));
+			pthread_mutex_unlock(&Header->Mutex);
+			return IS_SUCCESS;
+		}
+		bool closed = Header->Closed;
+		pthread_mutex_unlock(&Header->Mutex);
+		if(closed)
+			return IS_NO_SUCCESS;
+		if(timed_out)
+			return IS_TIMED_OUT;
+		// posts of frames already read only cause another look at the slots
+		while(sem_timedwait(&Header->Subscribers[Index].FramePublished, &deadline) != 0)
+		{
+			if(errno != EINTR)
+			{
+				timed_out = true;
+				break;
+			}
+		}
+	}
+}
+
+SharedFrame SharedFrameSubscriber::nextFrame(uint32_t timeout)
+{
+	SharedFrame frame;
+	int err = tryWaitNextFrame(frame, timeout);
+	if(err == IS_TIMED_OUT)
+		throw std::runtime_error("timeout while waiting for the next shared frame");
+	if(err != IS_SUCCESS)
+		throw std::runtime_error("the publisher is gone");
+	return frame;
+}
+
+void SharedFrameSubscriber::release(size_t slot)
+{
+	lockSharedRing(*Header);
+	--Header->Slots[slot].Readers;
+	Header->Subscribers[Index].Held &= ~(uint64_t(1) << slot);
+	pthread_mutex_unlock(&Header->Mutex);
+}
+
+}
@@ -0,0 +1,147 @@
+#ifndef UEYE_SHM_HPP
+#define UEYE_SHM_HPP
+
+#include "ueye_types.hpp"
+#include <string>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include <opencv2/core/core.hpp>
+
+namespace ueye{
+
+// Shared memory ring through which a SharedFramePublisher hands frames to
+// SharedFrameSubscriber of other processes, in a POSIX shared memory object :
+// a SharedRingHeader, the SharedSlot of every slot, then the slot data, each
+// on a SHARED_RING_ALIGNMENT boundary. The header is protected by a process
+// shared robust mutex, so that a process dying with it locked does not block
+// the others. Each subscriber waits on a semaphore of its own, posted by the
+// publisher : a process shared condition variable can no longer be broadcast
+// once one of its waiters died. A slot is reused once every subscriber has
+// read its frame and released it. When none is, the oldest frame of the
+// subscribers at least MaxLag frames behind is overwritten : a stalled
+// subscriber loses frames rather than the others. Otherwise the publisher
+// drops the frame.
+const uint32_t SHARED_RING_VERSION = 2;
+const size_t SHARED_RING_ALIGNMENT = 4096;
+const size_t MAX_SHARED_SLOTS = 64;
+const size_t MAX_SUBSCRIBERS = 16;
+
+struct SharedSlot
+{
+	uint64_t Sequence; // of the frame in the slot, 0 while empty or being written
+	uint32_t Readers; // frames of the slot held by subscribers
+	uint32_t Reserved;
+	uint64_t Size; // bytes of the data
+	uint64_t DeviceTimestamp; // camera clock, in 0.1 us
+	int64_t HostTimestamp; // ns, steady clock, common to the processes of the host
+	uint64_t FrameNumber;
+	uint64_t LostBefore; // by the camera, and dropped by the publisher
+	int32_t ColorMode;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t Pitch;
+	// the view() Mat, laid out by the publisher so that subscribers need no
+	// format table
+	int32_t ViewType;
+	uint32_t ViewRows;
+	uint32_t ViewCols;
+	uint32_t ViewStep;
+};
+
+struct SharedSubscriber
+{
+	int32_t Pid; // 0 for a free entry
+	uint32_t Reserved;
+	uint64_t Next; // sequence of the next frame to read
+	uint64_t Held; // bit per slot held
+	sem_t FramePublished; // posted on each frame published, and on close
+};
+
+struct SharedRingHeader
+{
+	char Magic[8]; // "UEYESHM"
+	uint32_t Version;
+	uint32_t SlotCount;
+	uint64_t SlotBytes;
+	uint64_t DataOffset; // of the first slot data
+	pthread_mutex_t Mutex;
+	uint64_t Sequence; // frames published
+	uint32_t Closed; // by the publisher
+	uint32_t MaxLag; // unread frames beyond which a subscriber's slots are reused when none is free
+	SharedSubscriber Subscribers[MAX_SUBSCRIBERS];
+	SharedSlot Slots[MAX_SHARED_SLOTS];
+};
+
+// locks the mutex of the ring, made consistent again when its owner died
+void lockSharedRing(SharedRingHeader &header);
+// removes the subscribers of processes gone, releasing their slots ; with the
+// mutex locked
+void reapSubscribers(SharedRingHeader &header);
+
+class SharedFrameSubscriber;
+
+// frame read from the ring, the slot staying held until release
+class SharedFrame
+{
+	public:
+	SharedFrame();
+	SharedFrame(SharedFrame &&frame);
+	~SharedFrame();
+	SharedFrame& operator=(SharedFrame &&frame);
+
+	bool valid() const;
+	// HostTimestamp is the time the camera returned the frame to the publisher
+	const FrameInfo& info() const;
+	int32_t colorMode() const;
+	// in the shared slot, laid out as by ImageMemory::view()
+	cv::Mat view() const;
+
+	void release();
+
+	private:
+	friend class SharedFrameSubscriber;
+	SharedFrame(const SharedFrame&); // non construction-copyable
+	SharedFrame& operator=(const SharedFrame&); // non copyable
+
+	SharedFrameSubscriber *Owner;
+	size_t Slot;
+	int32_t ColorMode;
+	FrameInfo Info;
+};
+
+// Reads the frames published under a name, from the next one published on.
+// Only depends on ueye_shm.cpp and ueye_types.hpp, not on the camera code or
+// the SDK, so that processes other than the one capturing can link it. Frames
+// lost by a subscriber that fell behind are counted in LostBefore. Not thread
+// safe.
+class SharedFrameSubscriber
+{
+	public:
+	// throws std::system_error when no ring is published under name, and
+	// std::runtime_error when the ring is full of subscribers
+	explicit SharedFrameSubscriber(const std::string &name);
+	// the frames must have been released
+	~SharedFrameSubscriber();
+
+	// Like Camera::tryWaitNextFrame : IS_SUCCESS, IS_TIMED_OUT, or
+	// IS_NO_SUCCESS once the publisher is gone and every frame was read.
+	int tryWaitNextFrame(SharedFrame &frame, uint32_t timeout=1000);
+	// throws std::runtime_error on timeout, or once the publisher is gone
+	SharedFrame nextFrame(uint32_t timeout=1000);
+
+	private:
+	friend class SharedFrame;
+	SharedFrameSubscriber(const SharedFrameSubscriber&); // non construction-copyable
+	SharedFrameSubscriber& operator=(const SharedFrameSubscriber&); // non copyable
+
+	void release(size_t slot);
+
+	SharedRingHeader *Header;
+	size_t Bytes;
+	size_t Index; // in Header->Subscribers
+};
+
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef UEYE_TYPES_HPP
+#define UEYE_TYPES_HPP
+
+#include <chrono>
+#include <cstdint>
+
+// SDK status codes returned outside of the camera code, for the processes that
+// do not include ueye.h ; the values are those of ueye.h
+#ifndef IS_SUCCESS
+#define IS_NO_SUCCESS -1
+#define IS_SUCCESS 0
+#define IS_TIMED_OUT 122
+#endif
+
+namespace ueye{
+
+struct FrameInfo
+{
+	uint64_t DeviceTimestamp; // camera clock, in 0.1 us
+	uint64_t FrameNumber;
+	uint64_t LostBefore; // frames lost between the previous frame returned and this one
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t BufferCount;
+	uint32_t BuffersInUse;
+	std::chrono::steady_clock::time_point HostTimestamp; // when the frame was returned
+};
+
+}
+
+#endif